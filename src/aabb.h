@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Axis-aligned bounding box
+struct Aabb
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+inline Aabb aabbFromSphere(const glm::vec3& center, float radius)
+{
+    return { center - glm::vec3(radius), center + glm::vec3(radius) };
+}
+
+inline Aabb merge(const Aabb& a, const Aabb& b)
+{
+    return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+inline bool overlaps(const Aabb& a, const Aabb& b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+inline bool contains(const Aabb& outer, const Aabb& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+inline float surfaceArea(const Aabb& a)
+{
+    glm::vec3 d = a.max - a.min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// Squared distance from a point to the box, 0 inside
+inline float distanceSquared(const Aabb& a, const glm::vec3& p)
+{
+    glm::vec3 d = glm::max(glm::max(a.min - p, p - a.max), glm::vec3(0.0f));
+    return glm::dot(d, d);
+}
+
+// Slab test of the segment origin + t * direction for t in [0, 1], given 1 / direction per axis
+// (use a huge value for zero components)
+inline bool segmentOverlaps(const Aabb& a, const glm::vec3& origin, const glm::vec3& invDirection)
+{
+    glm::vec3 t1 = (a.min - origin) * invDirection;
+    glm::vec3 t2 = (a.max - origin) * invDirection;
+    glm::vec3 tNear = glm::min(t1, t2);
+    glm::vec3 tFar = glm::max(t1, t2);
+    float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+    float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, 1.0f));
+    return enter <= exit;
+}
@@ -0,0 +1,227 @@
+#include "allocation_tracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+namespace {
+
+struct TagCounters
+{
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> deallocations{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+    std::atomic<uint64_t> liveBytes{ 0 };
+    std::atomic<uint64_t> peakBytes{ 0 };
+};
+
+// Index AllocationTag_Count holds the totals over every tag
+TagCounters counters[AllocationTag_Count + 1];
+thread_local AllocationTag currentTag = AllocationTag_Untagged;
+
+const char* tagNames[AllocationTag_Count] = { "untagged", "loading", "meshes", "textures", "world", "rendering" };
+
+// Sits right in front of the returned pointer; 16 bytes keeps the default alignment
+struct alignas(16) AllocationHeader
+{
+    uint64_t size;
+    uint32_t tag;
+    uint32_t unused;
+};
+static_assert(sizeof(AllocationHeader) == 16, "header must keep 16-byte alignment");
+
+void raisePeak(std::atomic<uint64_t>& peak, uint64_t value)
+{
+    uint64_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void countAllocation(TagCounters& c, uint64_t size)
+{
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.totalBytes.fetch_add(size, std::memory_order_relaxed);
+    raisePeak(c.peakBytes, c.liveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+void countDeallocation(TagCounters& c, uint64_t size)
+{
+    c.deallocations.fetch_add(1, std::memory_order_relaxed);
+    c.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// offset is where the user block starts in the raw block: the header size, or the alignment
+// for over-aligned requests so the user pointer keeps it
+void* track(void* raw, size_t offset, size_t size)
+{
+    if (!raw)
+        return nullptr;
+    uint8_t* user = static_cast<uint8_t*>(raw) + offset;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(user) - 1;
+    header->size = size;
+    header->tag = currentTag;
+    countAllocation(counters[currentTag], size);
+    countAllocation(counters[AllocationTag_Count], size);
+    return user;
+}
+
+void untrack(void* pointer)
+{
+    const AllocationHeader* header = static_cast<const AllocationHeader*>(pointer) - 1;
+    countDeallocation(counters[header->tag], header->size);
+    countDeallocation(counters[AllocationTag_Count], header->size);
+}
+
+void* trackedAllocate(size_t size)
+{
+    return track(std::malloc(sizeof(AllocationHeader) + size), sizeof(AllocationHeader), size);
+}
+
+void* trackedAllocateAligned(size_t size, size_t alignment)
+{
+    // The header goes in the padding in front of the aligned block
+    size_t offset = alignment > sizeof(AllocationHeader) ? alignment : sizeof(AllocationHeader);
+    size_t rawSize = (offset + size + alignment - 1) & ~(alignment - 1);
+#ifdef _WIN32
+    void* raw = _aligned_malloc(rawSize, alignment);
+#else
+    void* raw = std::aligned_alloc(alignment, rawSize);
+#endif
+    return track(raw, offset, size);
+}
+
+void trackedFree(void* pointer)
+{
+    if (!pointer)
+        return;
+    untrack(pointer);
+    std::free(static_cast<uint8_t*>(pointer) - sizeof(AllocationHeader));
+}
+
+void trackedFreeAligned(void* pointer, size_t alignment)
+{
+    if (!pointer)
+        return;
+    untrack(pointer);
+    size_t offset = alignment > sizeof(AllocationHeader) ? alignment : sizeof(AllocationHeader);
+#ifdef _WIN32
+    _aligned_free(static_cast<uint8_t*>(pointer) - offset);
+#else
+    std::free(static_cast<uint8_t*>(pointer) - offset);
+#endif
+}
+
+void* allocateOrThrow(size_t size)
+{
+    void* pointer = trackedAllocate(size);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* allocateAlignedOrThrow(size_t size, std::align_val_t alignment)
+{
+    void* pointer = trackedAllocateAligned(size, (size_t)alignment);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+AllocationStats snapshot(const TagCounters& c)
+{
+    AllocationStats stats;
+    stats.allocations = c.allocations.load(std::memory_order_relaxed);
+    stats.deallocations = c.deallocations.load(std::memory_order_relaxed);
+    stats.totalBytes = c.totalBytes.load(std::memory_order_relaxed);
+    stats.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = c.peakBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void writeStatsJson(std::ostream& out, const AllocationStats& stats)
+{
+    out << "{ \"allocations\": " << stats.allocations << ", \"deallocations\": " << stats.deallocations
+        << ", \"totalBytes\": " << stats.totalBytes << ", \"liveBytes\": " << stats.liveBytes
+        << ", \"peakBytes\": " << stats.peakBytes << " }";
+}
+
+}
+
+AllocationStats allocationStats()
+{
+    return snapshot(counters[AllocationTag_Count]);
+}
+
+AllocationStats allocationStats(AllocationTag tag)
+{
+    return snapshot(counters[tag]);
+}
+
+const char* allocationTagName(AllocationTag tag)
+{
+    return tag < AllocationTag_Count ? tagNames[tag] : "total";
+}
+
+uint64_t allocationCount()
+{
+    return counters[AllocationTag_Count].allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t deallocationCount()
+{
+    return counters[AllocationTag_Count].deallocations.load(std::memory_order_relaxed);
+}
+
+AllocationScope::AllocationScope(AllocationTag tag) : previous(currentTag)
+{
+    currentTag = tag;
+}
+
+AllocationScope::~AllocationScope()
+{
+    currentTag = previous;
+}
+
+void writeAllocationJson(std::ostream& out)
+{
+    out << "{\n  \"total\": ";
+    writeStatsJson(out, allocationStats());
+    out << ",\n  \"tags\": {\n";
+    for (int t = 0; t < AllocationTag_Count; t++) {
+        out << "    \"" << tagNames[t] << "\": ";
+        writeStatsJson(out, allocationStats((AllocationTag)t));
+        out << (t + 1 < AllocationTag_Count ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+}
+
+bool writeAllocationJson(const char* path)
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Failed to write allocation report " << path << std::endl;
+        return false;
+    }
+    writeAllocationJson(file);
+    return true;
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment); }
+
+void operator delete(void* pointer) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment) noexcept { trackedFreeAligned(pointer, (size_t)alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { trackedFreeAligned(pointer, (size_t)alignment); }
+void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept { trackedFreeAligned(pointer, (size_t)alignment); }
+void operator delete[](void* pointer, size_t, std::align_val_t alignment) noexcept { trackedFreeAligned(pointer, (size_t)alignment); }
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// What an allocation was made for. The tag comes from the innermost AllocationScope on the
+// allocating thread; worker threads outside any scope count as untagged.
+enum AllocationTag
+{
+    AllocationTag_Untagged,
+    AllocationTag_Loading,
+    AllocationTag_Meshes,
+    AllocationTag_Textures,
+    AllocationTag_World,
+    AllocationTag_Rendering,
+    AllocationTag_Count
+};
+
+struct AllocationStats
+{
+    uint64_t allocations;   // Since startup
+    uint64_t deallocations;
+    uint64_t totalBytes;    // Ever allocated
+    uint64_t liveBytes;
+    uint64_t peakBytes;     // Highest liveBytes seen
+};
+
+// Global operator new/delete are replaced to track every heap allocation: a small header in
+// front of each block records its size and tag, so frees are charged back to the right tag.
+// Counters are relaxed atomics; peaks are updated with a compare-exchange loop.
+AllocationStats allocationStats();
+AllocationStats allocationStats(AllocationTag tag);
+const char* allocationTagName(AllocationTag tag);
+
+// Diff these around code that is meant to be allocation free, such as steady-state frames
+uint64_t allocationCount();
+uint64_t deallocationCount();
+
+// Tags allocations made on this thread until the scope ends; scopes nest
+class AllocationScope
+{
+public:
+    explicit AllocationScope(AllocationTag tag);
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    AllocationTag previous;
+};
+
+// Totals and per-tag stats as a JSON object
+void writeAllocationJson(std::ostream& out);
+bool writeAllocationJson(const char* path);
@@ -0,0 +1,279 @@
+#include "asteroids.h"
+#include "allocation_tracker.h"
+#include "job_system.h"
+#include "mesh_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <map>
+#include <random>
+
+static uint32_t hashUint(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+static float latticeValue(int x, int y, int z, uint32_t seed)
+{
+    uint32_t h = hashUint((uint32_t)x * 73856093U ^ (uint32_t)y * 19349663U ^ (uint32_t)z * 83492791U ^ seed);
+    return (float)(h & 0xffffff) / (float)0xffffff * 2.0f - 1.0f;
+}
+
+// Smoothly interpolated lattice noise in [-1, 1]
+static float valueNoise(const glm::vec3& p, uint32_t seed)
+{
+    glm::vec3 cell = glm::floor(p);
+    glm::vec3 f = p - cell;
+    glm::vec3 u = f * f * (3.0f - 2.0f * f);
+    int x = (int)cell.x, y = (int)cell.y, z = (int)cell.z;
+
+    float result = 0.0f;
+    for (int corner = 0; corner < 8; corner++) {
+        int dx = corner & 1, dy = (corner >> 1) & 1, dz = (corner >> 2) & 1;
+        float weight = (dx ? u.x : 1.0f - u.x) * (dy ? u.y : 1.0f - u.y) * (dz ? u.z : 1.0f - u.z);
+        result += weight * latticeValue(x + dx, y + dy, z + dz, seed);
+    }
+    return result;
+}
+
+// Unit icosphere, subdivided: 162 vertices at two levels
+static void buildIcosphere(int subdivisions, std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices)
+{
+    const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+    positions = {
+        { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+        { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+        { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+    };
+    for (glm::vec3& p : positions)
+        p = glm::normalize(p);
+    indices = {
+        0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+        1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+        3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+        4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1
+    };
+
+    for (int level = 0; level < subdivisions; level++) {
+        std::map<std::pair<unsigned int, unsigned int>, unsigned int> midpoints;
+        auto midpoint = [&](unsigned int a, unsigned int b) {
+            auto key = std::make_pair(std::min(a, b), std::max(a, b));
+            auto it = midpoints.find(key);
+            if (it != midpoints.end())
+                return it->second;
+            positions.push_back(glm::normalize(positions[a] + positions[b]));
+            unsigned int index = (unsigned int)positions.size() - 1;
+            midpoints[key] = index;
+            return index;
+        };
+
+        std::vector<unsigned int> refined;
+        refined.reserve(indices.size() * 4);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            refined.insert(refined.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+        }
+        indices.swap(refined);
+    }
+}
+
+void AsteroidField::init(uint32_t fieldSeed, MeshPool& pool, JobSystem& jobs, int variantCount)
+{
+    AllocationScope allocationScope(AllocationTag_World);
+    seed = fieldSeed;
+
+    std::vector<glm::vec3> sphere;
+    std::vector<unsigned int> indices;
+    buildIcosphere(2, sphere, indices);
+
+    // Displace the sphere with a few octaves of noise per variant, then rebuild smooth normals
+    std::vector<std::vector<float>> variantVertices(variantCount);
+    variantRadii.assign(variantCount, 0.0f);
+    jobs.parallelFor((uint32_t)variantCount, 1, [&](uint32_t begin, uint32_t end) {
+        AllocationScope workerScope(AllocationTag_World);
+        for (uint32_t v = begin; v < end; v++) {
+            uint32_t variantSeed = hashUint(seed + v * 7919U);
+            std::vector<glm::vec3> positions(sphere.size());
+            float radius = 0.0f;
+            for (size_t i = 0; i < sphere.size(); i++) {
+                float displacement = 0.0f, amplitude = 0.35f, frequency = 1.5f;
+                for (int octave = 0; octave < 3; octave++) {
+                    displacement += amplitude * valueNoise(sphere[i] * frequency, variantSeed + octave);
+                    amplitude *= 0.5f;
+                    frequency *= 2.0f;
+                }
+                positions[i] = sphere[i] * (1.0f + displacement);
+                radius = std::max(radius, glm::length(positions[i]));
+            }
+
+            std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                glm::vec3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+                glm::vec3 faceNormal = glm::cross(b - a, c - a); // Area weighted
+                normals[indices[i]] += faceNormal;
+                normals[indices[i + 1]] += faceNormal;
+                normals[indices[i + 2]] += faceNormal;
+            }
+
+            std::vector<float>& vertices = variantVertices[v];
+            vertices.reserve(positions.size() * meshVertexFloats);
+            for (size_t i = 0; i < positions.size(); i++) {
+                glm::vec3 n = glm::normalize(normals[i]);
+                // Spherical mapping of the undisplaced direction
+                float u = 0.5f + std::atan2(sphere[i].y, sphere[i].x) * 0.15915494f;
+                float v = 0.5f + std::asin(glm::clamp(sphere[i].z, -1.0f, 1.0f)) * 0.31830989f;
+                vertices.insert(vertices.end(), { positions[i].x, positions[i].y, positions[i].z, n.x, n.y, n.z, u, v });
+            }
+            variantRadii[v] = radius;
+        }
+    });
+
+    variantMeshes.clear();
+    for (int v = 0; v < variantCount; v++)
+        variantMeshes.push_back(pool.addMesh(variantVertices[v], indices));
+    pool.upload();
+
+    // Enough slots for everything inside the unload radius; nothing is allocated after this
+    const int span = 2 * (loadRadius + 1) + 1;
+    const size_t slotCount = (size_t)span * span * span;
+    chunks.assign(slotCount, Chunk());
+    freeChunks.clear();
+    for (size_t i = 0; i < slotCount; i++) {
+        chunks[i].asteroids.reserve(maxPerChunk);
+        freeChunks.push_back((int32_t)(slotCount - 1 - i));
+    }
+    chunkSlots.clear();
+    chunkSlots.reserve(slotCount);
+    chunkSlotNodes.reserve(slotCount);
+    transforms.reserve(slotCount * maxPerChunk);
+    centers.reserve(slotCount * maxPerChunk);
+    radii.reserve(slotCount * maxPerChunk);
+    meshes.reserve(slotCount * maxPerChunk);
+}
+
+uint64_t AsteroidField::chunkKey(const glm::ivec3& coord)
+{
+    // 21 bits per axis covers +-1M chunks
+    const uint64_t mask = (1u << 21) - 1;
+    return ((uint64_t)(coord.x & mask) << 42) | ((uint64_t)(coord.y & mask) << 21) | (uint64_t)(coord.z & mask);
+}
+
+void AsteroidField::generateChunk(Chunk& chunk) const
+{
+    const glm::ivec3& c = chunk.coord;
+    std::mt19937 rng(hashUint(seed ^ hashUint((uint32_t)c.x * 73856093U ^ (uint32_t)c.y * 19349663U ^ (uint32_t)c.z * 83492791U)));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    chunk.asteroids.clear();
+    uint32_t count = rng() % (maxPerChunk + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        // Draw every value even for skipped rocks so the sequence doesn't depend on clearRadius
+        Asteroid a;
+        glm::vec3 inChunk(unit(rng), unit(rng), unit(rng));
+        glm::vec3 absolute = (glm::vec3(c) + inChunk) * chunkSize;
+        a.position = (glm::vec3(c - originChunk) + inChunk) * chunkSize;
+        a.axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f + glm::vec3(0.0f, 0.0f, 1e-3f));
+        a.angle = unit(rng) * 6.2831853f;
+        a.spin = (unit(rng) - 0.5f) * 0.6f;
+        a.scale = 0.5f + 2.5f * unit(rng) * unit(rng); // Mostly small
+        a.variant = (uint16_t)(rng() % variantMeshes.size());
+
+        if (glm::length(absolute) >= clearRadius)
+            chunk.asteroids.push_back(a);
+    }
+}
+
+void AsteroidField::update(const glm::vec3& center, float time, JobSystem& jobs)
+{
+    if (chunks.empty())
+        return;
+
+    const glm::ivec3 centerChunk = glm::ivec3(glm::floor(center / chunkSize)) + originChunk;
+
+    // Release chunks beyond the unload radius; the extra ring stops thrashing at chunk borders
+    evictions.clear();
+    for (const auto& entry : chunkSlots) {
+        glm::ivec3 d = glm::abs(chunks[entry.second].coord - centerChunk);
+        if (std::max(d.x, std::max(d.y, d.z)) > loadRadius + 1)
+            evictions.push_back(entry.first);
+    }
+    for (uint64_t key : evictions) {
+        auto it = chunkSlots.find(key);
+        chunks[it->second].asteroids.clear();
+        freeChunks.push_back(it->second);
+        chunkSlots.erase(it);
+    }
+
+    // Claim missing chunks nearest first, up to the per-frame budget
+    pendingChunks.clear();
+    for (int ring = 0; ring <= loadRadius && (int)pendingChunks.size() < maxChunksPerFrame; ring++) {
+        for (int z = -ring; z <= ring; z++) {
+            for (int y = -ring; y <= ring; y++) {
+                for (int x = -ring; x <= ring; x++) {
+                    if (std::max(std::abs(x), std::max(std::abs(y), std::abs(z))) != ring)
+                        continue;
+                    if ((int)pendingChunks.size() >= maxChunksPerFrame || freeChunks.empty())
+                        break;
+
+                    glm::ivec3 coord = centerChunk + glm::ivec3(x, y, z);
+                    uint64_t key = chunkKey(coord);
+                    if (chunkSlots.count(key))
+                        continue;
+
+                    int32_t slot = freeChunks.back();
+                    freeChunks.pop_back();
+                    chunks[slot].coord = coord;
+                    chunkSlots[key] = slot;
+                    pendingChunks.push_back(slot);
+                }
+            }
+        }
+    }
+
+    jobs.parallelFor((uint32_t)pendingChunks.size(), 1, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            generateChunk(chunks[pendingChunks[i]]);
+    });
+
+    // Flatten in slot order so the result doesn't depend on hash map iteration
+    chunkOffsets.assign(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); i++)
+        chunkOffsets[i + 1] = chunkOffsets[i] + chunks[i].asteroids.size();
+    const size_t total = chunkOffsets.back();
+    transforms.resize(total);
+    centers.resize(total);
+    radii.resize(total);
+    meshes.resize(total);
+
+    jobs.parallelFor((uint32_t)chunks.size(), 16, [this, time](uint32_t begin, uint32_t end) {
+        for (uint32_t c = begin; c < end; c++) {
+            size_t out = chunkOffsets[c];
+            for (const Asteroid& a : chunks[c].asteroids) {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), a.position);
+                model = glm::rotate(model, a.angle + a.spin * time, a.axis);
+                model = glm::scale(model, glm::vec3(a.scale));
+                transforms[out] = model;
+                centers[out] = a.position;
+                radii[out] = variantRadii[a.variant] * a.scale;
+                meshes[out] = variantMeshes[a.variant];
+                out++;
+            }
+        }
+    });
+}
+
+void AsteroidField::rebase(const glm::vec3& shift)
+{
+    originChunk += glm::ivec3(glm::floor(shift / chunkSize + 0.5f));
+    for (Chunk& chunk : chunks) {
+        for (Asteroid& a : chunk.asteroids)
+            a.position -= shift;
+    }
+}
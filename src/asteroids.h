@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "pool_allocator.h"
+
+class JobSystem;
+class MeshPool;
+
+// One rock; position is relative to the current floating origin
+struct Asteroid
+{
+    glm::vec3 position;
+    glm::vec3 axis;
+    float angle;
+    float spin;   // Radians per second about axis
+    float scale;
+    uint16_t variant;
+};
+
+// Infinite asteroid field streamed in cubic chunks around a point.
+//
+// Every chunk's rocks come from a generator seeded by the field seed and the chunk coordinates,
+// so a chunk that is unloaded and later reloaded looks exactly the same. Chunks entering the load
+// radius are generated on the job system; chunks leaving radius + 1 go back to a fixed pool of
+// slots, so memory is bounded by the radius however far the player flies.
+//
+// Rocks share a handful of mesh variants, each a sphere displaced by seeded noise.
+class AsteroidField
+{
+public:
+    float chunkSize = 64.0f;
+    int loadRadius = 2;            // In chunks, per axis
+    int maxChunksPerFrame = 16;    // Generation budget, to spread a fast fly-through over frames
+    float clearRadius = 70.0f;     // No rocks around the absolute origin, where the fleet orbits
+    uint32_t maxPerChunk = 12;
+
+    // Builds the mesh variants on the job system and adds them to the pool
+    void init(uint32_t seed, MeshPool& pool, JobSystem& jobs, int variantCount = 8);
+
+    // Streams chunks around center and rebuilds the flat per-rock arrays for time (seconds)
+    void update(const glm::vec3& center, float time, JobSystem& jobs);
+
+    // Floating-origin rebase; shift must be a whole number of chunks. Loaded rocks move by -shift
+    // and chunk coordinates stay absolute, so generation is unaffected.
+    void rebase(const glm::vec3& shift);
+
+    // Flat arrays over every loaded rock, written by update
+    std::vector<glm::mat4> transforms;
+    std::vector<glm::vec3> centers;
+    std::vector<float> radii;
+    std::vector<uint16_t> meshes;
+
+    size_t size() const { return transforms.size(); }
+    size_t loadedChunks() const { return chunkSlots.size(); }
+
+private:
+    struct Chunk
+    {
+        glm::ivec3 coord; // Absolute
+        std::vector<Asteroid> asteroids; // Reserved to maxPerChunk once, then reused
+    };
+
+    void generateChunk(Chunk& chunk) const;
+    static uint64_t chunkKey(const glm::ivec3& coord);
+
+    uint32_t seed = 0;
+    glm::ivec3 originChunk = glm::ivec3(0); // Absolute chunk coordinates of the world origin
+    std::vector<uint16_t> variantMeshes;
+    std::vector<float> variantRadii;
+
+    std::vector<Chunk> chunks;
+    std::vector<int32_t> freeChunks;
+    // Map nodes come from a pool sized with the slots, so streaming chunks in and out never
+    // reaches the heap; the pool must outlive the map
+    typedef std::pair<const uint64_t, int32_t> ChunkSlotEntry;
+    typedef std::unordered_map<uint64_t, int32_t, std::hash<uint64_t>, std::equal_to<uint64_t>, PoolAllocator<ChunkSlotEntry>> ChunkSlotMap;
+    BlockPool chunkSlotNodes{ 64 };
+    ChunkSlotMap chunkSlots{ 0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), PoolAllocator<ChunkSlotEntry>(&chunkSlotNodes) };
+
+    // Scratch for update
+    std::vector<int32_t> pendingChunks;
+    std::vector<uint64_t> evictions;
+    std::vector<size_t> chunkOffsets;
+};
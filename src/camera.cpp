@@ -0,0 +1,139 @@
+#include "camera.h"
+#include "depth.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+glm::mat4 Camera::view() const
+{
+    if (mode == CameraMode_Free) {
+        glm::vec3 forward(std::cos(freePitch) * std::cos(freeYaw), std::cos(freePitch) * std::sin(freeYaw), std::sin(freePitch));
+        return glm::lookAt(position, position + forward, up);
+    }
+    return glm::lookAt(position, focus, up);
+}
+
+glm::mat4 Camera::projection(float aspect) const
+{
+    if (reversedZ)
+        return infiniteReversedPerspective(fovY, aspect, nearPlane);
+    return glm::perspective(fovY, aspect, nearPlane, farPlane);
+}
+
+glm::vec3 smoothDamp(const glm::vec3& current, const glm::vec3& target, glm::vec3& velocity, float smoothTime, float dt)
+{
+    float omega = 2.0f / std::max(smoothTime, 1e-4f);
+    float x = omega * dt;
+    float decay = 1.0f / (1.0f + x + 0.48f * x * x + 0.235f * x * x * x); // Approximates exp(-x)
+    glm::vec3 change = current - target;
+    glm::vec3 temp = (velocity + omega * change) * dt;
+    velocity = (velocity - omega * temp) * decay;
+    return target + (change + temp) * decay;
+}
+
+namespace {
+
+const float pitchLimit = 1.5f;
+
+glm::vec3 directionFromAngles(float yaw, float pitch)
+{
+    return glm::vec3(std::cos(pitch) * std::cos(yaw), std::cos(pitch) * std::sin(yaw), std::sin(pitch));
+}
+
+}
+
+void updateCamera(Camera& camera, const glm::vec3& targetPosition, const glm::vec3& targetForward,
+                  const CameraInput& input, float dt)
+{
+    switch (camera.mode) {
+        case CameraMode_Chase: {
+            // Heading flattened to the horizontal plane so pitching the ship doesn't swing the camera
+            glm::vec3 heading = targetForward - camera.up * glm::dot(targetForward, camera.up);
+            heading = glm::dot(heading, heading) > 1e-6f ? glm::normalize(heading) : glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 desired = targetPosition - heading * camera.chaseDistance + camera.up * camera.chaseHeight;
+            camera.position = smoothDamp(camera.position, desired, camera.positionVelocity, camera.positionSmoothTime, dt);
+            camera.focus = smoothDamp(camera.focus, targetPosition, camera.focusVelocity, camera.focusSmoothTime, dt);
+            break;
+        }
+        case CameraMode_Orbit: {
+            camera.orbitYaw += input.yaw;
+            camera.orbitPitch = glm::clamp(camera.orbitPitch + input.pitch, -pitchLimit, pitchLimit);
+            camera.orbitDistance = std::max(camera.orbitDistance + input.zoom, 2.0f);
+            glm::vec3 offset = directionFromAngles(camera.orbitYaw, camera.orbitPitch);
+            camera.focus = smoothDamp(camera.focus, targetPosition, camera.focusVelocity, camera.focusSmoothTime, dt);
+            glm::vec3 desired = camera.focus + offset * camera.orbitDistance;
+            camera.position = smoothDamp(camera.position, desired, camera.positionVelocity, camera.positionSmoothTime * 0.5f, dt);
+            break;
+        }
+        case CameraMode_Free: {
+            camera.freeYaw += input.yaw;
+            camera.freePitch = glm::clamp(camera.freePitch + input.pitch, -pitchLimit, pitchLimit);
+            glm::vec3 forward = directionFromAngles(camera.freeYaw, camera.freePitch);
+            glm::vec3 right = glm::normalize(glm::cross(forward, camera.up));
+            glm::vec3 velocity = (right * input.move.x + camera.up * input.move.y + forward * input.move.z) * camera.freeSpeed;
+            camera.position += velocity * dt;
+            camera.focus = camera.position + forward;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void latchCameraLook(Camera& camera, float yaw, float pitch)
+{
+    if (yaw == 0.0f && pitch == 0.0f)
+        return;
+
+    if (camera.mode == CameraMode_Orbit) {
+        camera.orbitYaw += yaw;
+        camera.orbitPitch = glm::clamp(camera.orbitPitch + pitch, -pitchLimit, pitchLimit);
+
+        // Turn the current eye offset by the same amount so the change shows this frame;
+        // the smoothing target moved with it, so the next update does not pull it back
+        glm::vec3 offset = camera.position - camera.focus;
+        float distance = glm::length(offset);
+        if (distance < 1e-4f)
+            return;
+        float offsetYaw = std::atan2(offset.y, offset.x) + yaw;
+        float offsetPitch = glm::clamp(std::asin(glm::clamp(offset.z / distance, -1.0f, 1.0f)) + pitch, -pitchLimit, pitchLimit);
+        camera.position = camera.focus + directionFromAngles(offsetYaw, offsetPitch) * distance;
+    } else if (camera.mode == CameraMode_Free) {
+        camera.freeYaw += yaw;
+        camera.freePitch = glm::clamp(camera.freePitch + pitch, -pitchLimit, pitchLimit);
+        camera.focus = camera.position + directionFromAngles(camera.freeYaw, camera.freePitch);
+    }
+}
+
+void setCameraMode(Camera& camera, CameraMode mode)
+{
+    if (mode == CameraMode_Free) {
+        glm::vec3 forward = camera.focus - camera.position;
+        if (glm::dot(forward, forward) > 1e-6f) {
+            forward = glm::normalize(forward);
+            camera.freeYaw = std::atan2(forward.y, forward.x);
+            camera.freePitch = std::asin(glm::clamp(forward.z, -1.0f, 1.0f));
+        }
+    }
+    camera.mode = mode;
+    camera.positionVelocity = glm::vec3(0.0f);
+    camera.focusVelocity = glm::vec3(0.0f);
+}
+
+bool FloatingOrigin::update(const glm::vec3& focus, glm::vec3& shift)
+{
+    if (std::abs(focus.x) < threshold && std::abs(focus.y) < threshold && std::abs(focus.z) < threshold)
+        return false;
+
+    glm::ivec3 cells = glm::ivec3(glm::floor(focus / cellSize + 0.5f));
+    cell += cells;
+    shift = glm::vec3(cells) * cellSize;
+    return true;
+}
+
+void rebaseCamera(Camera& camera, const glm::vec3& shift)
+{
+    camera.position -= shift;
+    camera.focus -= shift;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+enum CameraMode
+{
+    CameraMode_Chase, // Behind and above the target, following its heading
+    CameraMode_Orbit, // Around the target at a yaw/pitch/distance set by input
+    CameraMode_Free,  // Flies on its own, detached from the target
+    CameraMode_Count
+};
+
+// Per-frame camera controls, already scaled to this frame (radians, units)
+struct CameraInput
+{
+    glm::vec3 move = glm::vec3(0.0f); // Free mode: right, up, forward
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+    float zoom = 0.0f;                // Orbit mode: change in distance
+};
+
+// Camera that follows a target with critically damped smoothing: it settles as fast as possible
+// without overshoot, and the result doesn't depend on the frame rate.
+struct Camera
+{
+    CameraMode mode = CameraMode_Chase;
+
+    glm::vec3 position = glm::vec3(30.0f, 30.0f, 30.0f);
+    glm::vec3 focus = glm::vec3(0.0f); // Smoothed look-at point
+    glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
+
+    float positionSmoothTime = 0.3f; // Seconds to roughly close the gap
+    float focusSmoothTime = 0.1f;
+
+    float chaseDistance = 14.0f;
+    float chaseHeight = 5.0f;
+
+    float orbitYaw = 0.785f;
+    float orbitPitch = 0.6f;
+    float orbitDistance = 50.0f;
+
+    float freeYaw = 0.0f;
+    float freePitch = 0.0f;
+    float freeSpeed = 30.0f; // Units per second at full input
+
+    float fovY = glm::radians(45.0f);
+    float nearPlane = 0.1f;
+    float farPlane = 1000.0f; // Ignored with reversedZ: the far plane is at infinity
+    bool reversedZ = false;
+
+    // Smoothing state
+    glm::vec3 positionVelocity = glm::vec3(0.0f);
+    glm::vec3 focusVelocity = glm::vec3(0.0f);
+
+    glm::mat4 view() const;
+    glm::mat4 projection(float aspect) const;
+};
+
+// Critically damped spring towards target (Game Programming Gems 4, 1.10); velocity is the state
+glm::vec3 smoothDamp(const glm::vec3& current, const glm::vec3& target, glm::vec3& velocity, float smoothTime, float dt);
+
+// Moves the camera for this frame. targetForward is the followed ship's heading in world space.
+void updateCamera(Camera& camera, const glm::vec3& targetPosition, const glm::vec3& targetForward,
+                  const CameraInput& input, float dt);
+
+// Late latch: turns the camera by look input that arrived after updateCamera, right before the
+// frame is submitted. Orbit swings the eye around the focus, free turns in place, chase ignores it.
+// The angles are kept, so the next update continues from the latched orientation.
+void latchCameraLook(Camera& camera, float yaw, float pitch);
+
+// Switches mode, starting the free camera from the current view so there is no jump
+void setCameraMode(Camera& camera, CameraMode mode);
+
+// Floating origin: when the focus gets far from the origin, the whole world is moved back by a
+// whole number of cells. Keeping coordinates small keeps float precision (and the view matrix)
+// stable however far the player flies; cell tells where the current origin is in absolute terms.
+struct FloatingOrigin
+{
+    float cellSize = 1024.0f;  // Multiple of every grid that must stay aligned (asteroid chunks)
+    float threshold = 2048.0f; // Distance from the origin that triggers a rebase
+    glm::ivec3 cell = glm::ivec3(0);
+
+    // If focus is past the threshold, advances cell and returns true with the world-space offset
+    // that every position must have subtracted from it
+    bool update(const glm::vec3& focus, glm::vec3& shift);
+};
+
+// Applies a rebase shift to the camera and its smoothing state
+void rebaseCamera(Camera& camera, const glm::vec3& shift);
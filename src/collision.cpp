@@ -0,0 +1,644 @@
+#include "collision.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_set>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Convex hull
+
+namespace
+{
+    struct HullFace
+    {
+        uint32_t v[3];
+        glm::vec3 normal;
+        float offset; // dot(normal, point on face)
+        bool alive;
+    };
+
+    HullFace makeFace(const std::vector<glm::vec3>& points, uint32_t a, uint32_t b, uint32_t c)
+    {
+        HullFace face;
+        face.v[0] = a;
+        face.v[1] = b;
+        face.v[2] = c;
+        glm::vec3 n = glm::cross(points[b] - points[a], points[c] - points[a]);
+        float length = glm::length(n);
+        face.normal = length > 0.0f ? n / length : glm::vec3(0.0f);
+        face.offset = glm::dot(face.normal, points[a]);
+        face.alive = true;
+        return face;
+    }
+
+    uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+        return ((uint64_t)a << 32) | b;
+    }
+}
+
+ConvexHull buildConvexHull(const float* vertexData, size_t vertexCount, size_t stride)
+{
+    ConvexHull hull;
+
+    // Unique positions; OBJ data repeats every vertex per face
+    std::vector<glm::vec3> points;
+    points.reserve(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float* v = vertexData + i * stride;
+        points.push_back(glm::vec3(v[0], v[1], v[2]));
+    }
+    auto less = [](const glm::vec3& a, const glm::vec3& b) {
+        if (a.x != b.x) return a.x < b.x;
+        if (a.y != b.y) return a.y < b.y;
+        return a.z < b.z;
+    };
+    std::sort(points.begin(), points.end(), less);
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    if (points.size() < 4) {
+        hull.vertices = points;
+        return hull;
+    }
+
+    Aabb extent = { points[0], points[0] };
+    for (const glm::vec3& p : points) {
+        extent.min = glm::min(extent.min, p);
+        extent.max = glm::max(extent.max, p);
+    }
+    const float epsilon = 1e-5f * glm::length(extent.max - extent.min);
+
+    // Initial tetrahedron from extreme points
+    uint32_t i0 = 0, i1 = 0, i2 = 0, i3 = 0;
+    float best = 0.0f;
+    for (uint32_t i = 1; i < points.size(); i++) {
+        float d = glm::length(points[i] - points[i0]);
+        if (d > best) { best = d; i1 = i; }
+    }
+    best = 0.0f;
+    glm::vec3 lineDir = glm::normalize(points[i1] - points[i0]);
+    for (uint32_t i = 0; i < points.size(); i++) {
+        glm::vec3 offset = points[i] - points[i0];
+        float d = glm::length(offset - lineDir * glm::dot(offset, lineDir));
+        if (d > best) { best = d; i2 = i; }
+    }
+    best = 0.0f;
+    glm::vec3 planeNormal = glm::normalize(glm::cross(points[i1] - points[i0], points[i2] - points[i0]));
+    for (uint32_t i = 0; i < points.size(); i++) {
+        float d = std::abs(glm::dot(points[i] - points[i0], planeNormal));
+        if (d > best) { best = d; i3 = i; }
+    }
+    if (best <= epsilon) {
+        // Flat mesh: the point cloud still gives a valid support function
+        hull.vertices = points;
+        return hull;
+    }
+
+    std::vector<HullFace> faces;
+    glm::vec3 centroid = (points[i0] + points[i1] + points[i2] + points[i3]) * 0.25f;
+    const uint32_t tetra[4][3] = { { i0, i1, i2 }, { i0, i3, i1 }, { i0, i2, i3 }, { i1, i3, i2 } };
+    for (const auto& t : tetra) {
+        HullFace face = makeFace(points, t[0], t[1], t[2]);
+        if (glm::dot(face.normal, centroid) - face.offset > 0.0f)
+            face = makeFace(points, t[0], t[2], t[1]); // Point outward
+        faces.push_back(face);
+    }
+
+    // Add points one by one: remove the faces they can see and fan the horizon to them
+    std::unordered_set<uint64_t> visibleEdges;
+    std::vector<size_t> visible;
+    for (uint32_t p = 0; p < points.size(); p++) {
+        if (p == i0 || p == i1 || p == i2 || p == i3)
+            continue;
+
+        visible.clear();
+        for (size_t f = 0; f < faces.size(); f++) {
+            if (faces[f].alive && glm::dot(faces[f].normal, points[p]) - faces[f].offset > epsilon)
+                visible.push_back(f);
+        }
+        if (visible.empty())
+            continue; // Inside
+
+        visibleEdges.clear();
+        for (size_t f : visible) {
+            const HullFace& face = faces[f];
+            for (int e = 0; e < 3; e++)
+                visibleEdges.insert(edgeKey(face.v[e], face.v[(e + 1) % 3]));
+        }
+
+        for (size_t f : visible) {
+            faces[f].alive = false;
+            uint32_t v[3] = { faces[f].v[0], faces[f].v[1], faces[f].v[2] };
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = v[e];
+                uint32_t b = v[(e + 1) % 3];
+                // Horizon edge: the face on the other side stays
+                if (visibleEdges.find(edgeKey(b, a)) == visibleEdges.end())
+                    faces.push_back(makeFace(points, a, b, p));
+            }
+        }
+
+        // Drop dead faces now and then so the visibility scan stays short
+        if (faces.size() > 64 && visible.size() * 4 > faces.size() / 8) {
+            faces.erase(std::remove_if(faces.begin(), faces.end(), [](const HullFace& f) { return !f.alive; }), faces.end());
+        }
+    }
+
+    // Compact to the vertices actually on the hull
+    std::vector<int32_t> remap(points.size(), -1);
+    for (const HullFace& face : faces) {
+        if (!face.alive)
+            continue;
+        for (uint32_t v : face.v) {
+            if (remap[v] < 0) {
+                remap[v] = (int32_t)hull.vertices.size();
+                hull.vertices.push_back(points[v]);
+            }
+            hull.indices.push_back((uint32_t)remap[v]);
+        }
+    }
+    return hull;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// GJK / EPA
+
+namespace
+{
+    // Point of the Minkowski difference A - B, with the point on A it came from (for contact points)
+    struct SupportPoint
+    {
+        glm::vec3 p;
+        glm::vec3 a;
+    };
+
+    glm::vec3 shapeSupport(const CollisionShape& shape, const glm::vec3& direction)
+    {
+        glm::vec3 localDirection = glm::transpose(glm::mat3(shape.transform)) * direction;
+
+        const std::vector<glm::vec3>& vertices = shape.hull->vertices;
+        size_t best = 0;
+        float bestDot = -FLT_MAX;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            float d = glm::dot(vertices[i], localDirection);
+            if (d > bestDot) {
+                bestDot = d;
+                best = i;
+            }
+        }
+        return glm::vec3(shape.transform * glm::vec4(vertices[best], 1.0f));
+    }
+
+    SupportPoint support(const CollisionShape& a, const CollisionShape& b, const glm::vec3& direction)
+    {
+        glm::vec3 pointA = shapeSupport(a, direction);
+        glm::vec3 pointB = shapeSupport(b, -direction);
+        return { pointA - pointB, pointA };
+    }
+
+    bool sameDirection(const glm::vec3& direction, const glm::vec3& ao)
+    {
+        return glm::dot(direction, ao) > 0.0f;
+    }
+
+    // Any vector perpendicular to v
+    glm::vec3 perpendicular(const glm::vec3& v)
+    {
+        glm::vec3 axis = std::abs(v.x) < 0.57f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::cross(v, axis);
+    }
+
+    // Simplex, newest point first
+    struct Simplex
+    {
+        SupportPoint points[4];
+        int size = 0;
+
+        void pushFront(const SupportPoint& point)
+        {
+            for (int i = std::min(size, 3); i > 0; i--)
+                points[i] = points[i - 1];
+            points[0] = point;
+            size = std::min(size + 1, 4);
+        }
+
+        void set(const SupportPoint& a)
+        {
+            points[0] = a;
+            size = 1;
+        }
+
+        void set(const SupportPoint& a, const SupportPoint& b)
+        {
+            points[0] = a;
+            points[1] = b;
+            size = 2;
+        }
+
+        void set(const SupportPoint& a, const SupportPoint& b, const SupportPoint& c)
+        {
+            points[0] = a;
+            points[1] = b;
+            points[2] = c;
+            size = 3;
+        }
+    };
+
+    bool lineCase(Simplex& simplex, glm::vec3& direction)
+    {
+        SupportPoint a = simplex.points[0];
+        SupportPoint b = simplex.points[1];
+        glm::vec3 ab = b.p - a.p;
+        glm::vec3 ao = -a.p;
+
+        if (sameDirection(ab, ao)) {
+            direction = glm::cross(glm::cross(ab, ao), ab);
+            if (glm::dot(direction, direction) < 1e-12f)
+                direction = perpendicular(ab); // Origin on the segment
+        } else {
+            simplex.set(a);
+            direction = ao;
+        }
+        return false;
+    }
+
+    bool triangleCase(Simplex& simplex, glm::vec3& direction)
+    {
+        SupportPoint a = simplex.points[0];
+        SupportPoint b = simplex.points[1];
+        SupportPoint c = simplex.points[2];
+        glm::vec3 ab = b.p - a.p;
+        glm::vec3 ac = c.p - a.p;
+        glm::vec3 ao = -a.p;
+        glm::vec3 abc = glm::cross(ab, ac);
+
+        if (sameDirection(glm::cross(abc, ac), ao)) {
+            if (sameDirection(ac, ao)) {
+                simplex.set(a, c);
+                direction = glm::cross(glm::cross(ac, ao), ac);
+            } else {
+                simplex.set(a, b);
+                return lineCase(simplex, direction);
+            }
+        } else if (sameDirection(glm::cross(ab, abc), ao)) {
+            simplex.set(a, b);
+            return lineCase(simplex, direction);
+        } else if (sameDirection(abc, ao)) {
+            direction = abc;
+        } else {
+            simplex.set(a, c, b);
+            direction = -abc;
+        }
+        return false;
+    }
+
+    bool tetrahedronCase(Simplex& simplex, glm::vec3& direction)
+    {
+        SupportPoint a = simplex.points[0];
+        SupportPoint b = simplex.points[1];
+        SupportPoint c = simplex.points[2];
+        SupportPoint d = simplex.points[3];
+        glm::vec3 ab = b.p - a.p;
+        glm::vec3 ac = c.p - a.p;
+        glm::vec3 ad = d.p - a.p;
+        glm::vec3 ao = -a.p;
+
+        glm::vec3 abc = glm::cross(ab, ac);
+        glm::vec3 acd = glm::cross(ac, ad);
+        glm::vec3 adb = glm::cross(ad, ab);
+
+        if (sameDirection(abc, ao)) {
+            simplex.set(a, b, c);
+            return triangleCase(simplex, direction);
+        }
+        if (sameDirection(acd, ao)) {
+            simplex.set(a, c, d);
+            return triangleCase(simplex, direction);
+        }
+        if (sameDirection(adb, ao)) {
+            simplex.set(a, d, b);
+            return triangleCase(simplex, direction);
+        }
+        return true;
+    }
+
+    bool nextSimplex(Simplex& simplex, glm::vec3& direction)
+    {
+        switch (simplex.size) {
+            case 2: return lineCase(simplex, direction);
+            case 3: return triangleCase(simplex, direction);
+            case 4: return tetrahedronCase(simplex, direction);
+        }
+        return false;
+    }
+
+    struct EpaFace
+    {
+        uint32_t v[3];
+        glm::vec3 normal;
+        float distance;
+    };
+
+    EpaFace makeEpaFace(const std::vector<SupportPoint>& polytope, uint32_t a, uint32_t b, uint32_t c)
+    {
+        EpaFace face = { { a, b, c }, glm::vec3(0.0f), 0.0f };
+        glm::vec3 n = glm::cross(polytope[b].p - polytope[a].p, polytope[c].p - polytope[a].p);
+        float length = glm::length(n);
+        if (length > 0.0f)
+            n /= length;
+        face.distance = glm::dot(n, polytope[a].p);
+        // The origin is inside, so a negative distance means the normal points in
+        if (face.distance < 0.0f) {
+            n = -n;
+            face.distance = -face.distance;
+        }
+        face.normal = n;
+        return face;
+    }
+
+    void addUniqueEdge(std::vector<std::pair<uint32_t, uint32_t>>& edges, uint32_t a, uint32_t b)
+    {
+        // An edge shared by two removed faces appears once in each direction and is not on the horizon
+        auto reverse = std::find(edges.begin(), edges.end(), std::make_pair(b, a));
+        if (reverse != edges.end())
+            edges.erase(reverse);
+        else
+            edges.emplace_back(a, b);
+    }
+
+    // False if the polytope degenerates (no faces left) and there is no contact to report
+    bool epa(const Simplex& simplex, const CollisionShape& shapeA, const CollisionShape& shapeB, Contact& contact)
+    {
+        const float tolerance = 1e-4f;
+        const int maxIterations = 64;
+
+        std::vector<SupportPoint> polytope(simplex.points, simplex.points + 4);
+        std::vector<EpaFace> faces = {
+            makeEpaFace(polytope, 0, 1, 2), makeEpaFace(polytope, 0, 3, 1),
+            makeEpaFace(polytope, 0, 2, 3), makeEpaFace(polytope, 1, 3, 2)
+        };
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+
+        for (int iteration = 0; iteration < maxIterations; iteration++) {
+            size_t closest = 0;
+            for (size_t i = 1; i < faces.size(); i++) {
+                if (faces[i].distance < faces[closest].distance)
+                    closest = i;
+            }
+
+            glm::vec3 normal = faces[closest].normal;
+            SupportPoint s = support(shapeA, shapeB, normal);
+            if (glm::dot(normal, s.p) - faces[closest].distance < tolerance)
+                break; // Closest face is on the boundary of A - B
+
+            // Remove every face that sees the new point and patch the hole
+            edges.clear();
+            for (size_t i = 0; i < faces.size(); ) {
+                if (sameDirection(faces[i].normal, s.p - polytope[faces[i].v[0]].p)) {
+                    addUniqueEdge(edges, faces[i].v[0], faces[i].v[1]);
+                    addUniqueEdge(edges, faces[i].v[1], faces[i].v[2]);
+                    addUniqueEdge(edges, faces[i].v[2], faces[i].v[0]);
+                    faces[i] = faces.back();
+                    faces.pop_back();
+                } else {
+                    i++;
+                }
+            }
+
+            uint32_t newIndex = (uint32_t)polytope.size();
+            polytope.push_back(s);
+            for (const auto& edge : edges)
+                faces.push_back(makeEpaFace(polytope, edge.first, edge.second, newIndex));
+
+            if (faces.empty())
+                break;
+        }
+
+        // The last iteration may have removed or replaced the face it picked, so pick again from
+        // the faces that are left
+        if (faces.empty())
+            return false;
+        size_t closest = 0;
+        for (size_t i = 1; i < faces.size(); i++) {
+            if (faces[i].distance < faces[closest].distance)
+                closest = i;
+        }
+
+        const EpaFace& face = faces[closest];
+        contact.normal = face.normal;
+        contact.depth = face.distance;
+
+        // Barycentric coordinates of the origin's projection on the closest face give the point on A
+        glm::vec3 a = polytope[face.v[0]].p;
+        glm::vec3 b = polytope[face.v[1]].p;
+        glm::vec3 c = polytope[face.v[2]].p;
+        glm::vec3 projected = face.normal * face.distance;
+        glm::vec3 v0 = b - a, v1 = c - a, v2 = projected - a;
+        float d00 = glm::dot(v0, v0), d01 = glm::dot(v0, v1), d11 = glm::dot(v1, v1);
+        float d20 = glm::dot(v2, v0), d21 = glm::dot(v2, v1);
+        float denominator = d00 * d11 - d01 * d01;
+        float v = 0.0f, w = 0.0f;
+        if (std::abs(denominator) > 1e-12f) {
+            v = (d11 * d20 - d01 * d21) / denominator;
+            w = (d00 * d21 - d01 * d20) / denominator;
+        }
+        float u = 1.0f - v - w;
+        contact.point = polytope[face.v[0]].a * u + polytope[face.v[1]].a * v + polytope[face.v[2]].a * w;
+        return true;
+    }
+}
+
+bool collide(const CollisionShape& shapeA, const CollisionShape& shapeB, Contact* contact)
+{
+    const int maxIterations = 64;
+
+    glm::vec3 direction = glm::vec3(shapeB.transform[3]) - glm::vec3(shapeA.transform[3]);
+    if (glm::dot(direction, direction) < 1e-12f)
+        direction = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    Simplex simplex;
+    simplex.pushFront(support(shapeA, shapeB, direction));
+    direction = -simplex.points[0].p;
+
+    for (int iteration = 0; iteration < maxIterations; iteration++) {
+        if (glm::dot(direction, direction) < 1e-12f)
+            direction = glm::vec3(1.0f, 0.0f, 0.0f); // Origin on a vertex of the simplex
+
+        SupportPoint s = support(shapeA, shapeB, direction);
+        if (glm::dot(s.p, direction) < 0.0f)
+            return false; // Origin is past the furthest point: separated
+
+        simplex.pushFront(s);
+        if (nextSimplex(simplex, direction)) {
+            // A degenerate EPA is treated like a GJK that did not converge
+            return !contact || epa(simplex, shapeA, shapeB, *contact);
+        }
+    }
+
+    // No convergence (touching, degenerate); treat as not intersecting
+    return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Broadphase
+
+void SweepAndPrune::update(const Aabb* bounds, size_t count)
+{
+    pairList.clear();
+
+    bool fullSort = false;
+    if (order.size() != count) {
+        order.resize(count);
+        for (size_t i = 0; i < count; i++)
+            order[i] = (uint32_t)i;
+        fullSort = true;
+    }
+    if (count < 2)
+        return;
+
+    // Sweep along the axis where the bodies are most spread out
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    float sumSquared[3] = { 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < 3; k++) {
+            float center = (bounds[i].min[k] + bounds[i].max[k]) * 0.5f;
+            sum[k] += center;
+            sumSquared[k] += center * center;
+        }
+    }
+    int bestAxis = 0;
+    float bestVariance = -1.0f;
+    for (int k = 0; k < 3; k++) {
+        float variance = sumSquared[k] - sum[k] * sum[k] / (float)count;
+        if (variance > bestVariance) {
+            bestVariance = variance;
+            bestAxis = k;
+        }
+    }
+    if (bestAxis != axis) {
+        axis = bestAxis;
+        fullSort = true;
+    }
+
+    sweepMin.resize(count);
+    for (size_t k = 0; k < count; k++)
+        sweepMin[k] = bounds[order[k]].min[axis];
+
+    if (fullSort) {
+        std::sort(order.begin(), order.end(), [bounds, this](uint32_t a, uint32_t b) {
+            return bounds[a].min[axis] < bounds[b].min[axis];
+        });
+        for (size_t k = 0; k < count; k++)
+            sweepMin[k] = bounds[order[k]].min[axis];
+    } else {
+        // Last frame's order is nearly sorted, so this is close to linear
+        for (size_t k = 1; k < count; k++) {
+            float key = sweepMin[k];
+            uint32_t id = order[k];
+            size_t j = k;
+            while (j > 0 && sweepMin[j - 1] > key) {
+                sweepMin[j] = sweepMin[j - 1];
+                order[j] = order[j - 1];
+                j--;
+            }
+            sweepMin[j] = key;
+            order[j] = id;
+        }
+    }
+
+    const int axisA = (axis + 1) % 3;
+    const int axisB = (axis + 2) % 3;
+    sweepMax.resize(count);
+    minA.resize(count);
+    maxA.resize(count);
+    minB.resize(count);
+    maxB.resize(count);
+    for (size_t k = 0; k < count; k++) {
+        const Aabb& box = bounds[order[k]];
+        sweepMax[k] = box.max[axis];
+        minA[k] = box.min[axisA];
+        maxA[k] = box.max[axisA];
+        minB[k] = box.min[axisB];
+        maxB[k] = box.max[axisB];
+    }
+
+    auto addPair = [this](uint32_t a, uint32_t b) {
+        pairList.push_back(a < b ? BodyPair{ a, b } : BodyPair{ b, a });
+    };
+
+    for (size_t i = 0; i < count; i++) {
+        const float maxI = sweepMax[i];
+        size_t j = i + 1;
+
+#ifdef COLLISION_SSE
+        const __m128 sweepLimit = _mm_set1_ps(maxI);
+        const __m128 lowA = _mm_set1_ps(minA[i]);
+        const __m128 highA = _mm_set1_ps(maxA[i]);
+        const __m128 lowB = _mm_set1_ps(minB[i]);
+        const __m128 highB = _mm_set1_ps(maxB[i]);
+
+        auto overlapMask = [&](size_t k) {
+            __m128 inSweep = _mm_cmple_ps(_mm_loadu_ps(&sweepMin[k]), sweepLimit);
+            __m128 inA = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&minA[k]), highA), _mm_cmpge_ps(_mm_loadu_ps(&maxA[k]), lowA));
+            __m128 inB = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&minB[k]), highB), _mm_cmpge_ps(_mm_loadu_ps(&maxB[k]), lowB));
+            return _mm_movemask_ps(_mm_and_ps(inSweep, _mm_and_ps(inA, inB)));
+        };
+
+        // Eight candidates per step; hits are rare, so only the combined mask is branched on
+        while (j + 8 <= count && sweepMin[j] <= maxI) {
+            int mask = overlapMask(j) | (overlapMask(j + 4) << 4);
+            for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+                if (mask & 1)
+                    addPair(order[i], order[j + lane]);
+            }
+            j += 8;
+        }
+#endif
+
+        for (; j < count && sweepMin[j] <= maxI; j++) {
+            if (minA[j] <= maxA[i] && maxA[j] >= minA[i] && minB[j] <= maxB[i] && maxB[j] >= minB[i])
+                addPair(order[i], order[j]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Pipeline
+
+void CollisionWorld::update(const Aabb* bounds, const CollisionShape* shapes, size_t count, JobSystem& jobs)
+{
+    broadphase.update(bounds, count);
+    const std::vector<BodyPair>& candidates = broadphase.pairs();
+
+    threadContacts.resize(jobs.threadCount());
+    for (std::vector<Contact>& contacts : threadContacts)
+        contacts.clear();
+
+    jobs.parallelFor((uint32_t)candidates.size(), 32, [&](uint32_t begin, uint32_t end) {
+        std::vector<Contact>& out = threadContacts[JobSystem::threadIndex()];
+        for (uint32_t i = begin; i < end; i++) {
+            const BodyPair& pair = candidates[i];
+            Contact contact;
+            if (collide(shapes[pair.a], shapes[pair.b], &contact)) {
+                contact.a = pair.a;
+                contact.b = pair.b;
+                out.push_back(contact);
+            }
+        }
+    });
+
+    // Merge in a fixed order so the game sees the same contacts regardless of thread timing
+    contactList.clear();
+    for (const std::vector<Contact>& contacts : threadContacts)
+        contactList.insert(contactList.end(), contacts.begin(), contacts.end());
+    std::sort(contactList.begin(), contactList.end(), [](const Contact& x, const Contact& y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+}
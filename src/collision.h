@@ -0,0 +1,90 @@
+#pragma once
+
+#include "aabb.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Convex hull of a mesh in model space. Vertices are all a support function needs; the
+// triangles (outward, counter-clockwise) are kept for debugging and mass properties.
+struct ConvexHull
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Incremental 3D hull of the positions in an interleaved vertex array (stride in floats,
+// position first, like the mesh pool's 8-float layout)
+ConvexHull buildConvexHull(const float* vertexData, size_t vertexCount, size_t stride);
+
+// A convex shape placed in the world; the transform may rotate, translate and scale uniformly
+struct CollisionShape
+{
+    const ConvexHull* hull;
+    glm::mat4 transform;
+};
+
+struct BodyPair
+{
+    uint32_t a;
+    uint32_t b; // a < b
+};
+
+// Generated by the narrowphase for the game to consume.
+// normal points from body a to body b; moving b by normal * depth separates them.
+struct Contact
+{
+    uint32_t a;
+    uint32_t b;
+    glm::vec3 normal;
+    float depth;
+    glm::vec3 point; // World-space contact point on body a
+};
+
+// GJK overlap test; if the shapes intersect and contact is non-null, EPA fills in the
+// penetration normal, depth and point (a and b ids are left to the caller)
+bool collide(const CollisionShape& shapeA, const CollisionShape& shapeB, Contact* contact);
+
+// Sort-and-sweep broadphase. Bodies keep their order between frames, so with coherent motion
+// re-sorting is a near-linear insertion sort. The sweep axis follows the largest spread of
+// the bodies and the other two axes are tested with SSE, eight candidates per step as two
+// 4-wide masks.
+class SweepAndPrune
+{
+public:
+    void update(const Aabb* bounds, size_t count);
+    const std::vector<BodyPair>& pairs() const { return pairList; }
+
+private:
+    std::vector<uint32_t> order; // Body ids sorted by min on the sweep axis
+    int axis = 0;
+
+    // Bounds in sorted order, structure of arrays for the SIMD sweep
+    std::vector<float> sweepMin, sweepMax;
+    std::vector<float> minA, maxA, minB, maxB;
+
+    std::vector<BodyPair> pairList;
+};
+
+// Broadphase + narrowphase over a set of bodies, one shape per body
+class CollisionWorld
+{
+public:
+    // bounds[i] must enclose shapes[i]
+    void update(const Aabb* bounds, const CollisionShape* shapes, size_t count, JobSystem& jobs);
+
+    const std::vector<BodyPair>& pairs() const { return broadphase.pairs(); }
+    const std::vector<Contact>& contacts() const { return contactList; }
+
+private:
+    SweepAndPrune broadphase;
+    std::vector<std::vector<Contact>> threadContacts;
+    std::vector<Contact> contactList;
+};
+
+// Times the broadphase with 10k moving bodies and the GJK/EPA narrowphase (run with --bench-collision)
+void runCollisionBenchmark();
@@ -0,0 +1,149 @@
+#include "collision.h"
+#include "job_system.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Rough sphere point cloud in the 6-float vertex layout, to give the hull builder some interior points
+static std::vector<float> makeRockVertices(unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.2f, 1.0f);
+
+    std::vector<float> vertices;
+    for (int i = 0; i < 500; i++) {
+        glm::vec3 p = glm::normalize(glm::vec3(gaussian(rng), gaussian(rng), gaussian(rng))) * scale(rng);
+        vertices.insert(vertices.end(), { p.x, p.y, p.z, 0.0f, 0.0f, 1.0f });
+    }
+    return vertices;
+}
+
+static void checkKnownCases()
+{
+    // Two unit cubes overlapping by 0.25 along x
+    const float cube[] = {
+        -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  -0.5f, 0.5f, -0.5f,  0.5f, 0.5f, -0.5f,
+        -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  -0.5f, 0.5f,  0.5f,  0.5f, 0.5f,  0.5f
+    };
+    ConvexHull hull = buildConvexHull(cube, 8, 3);
+
+    CollisionShape a = { &hull, glm::mat4(1.0f) };
+    CollisionShape b = { &hull, glm::translate(glm::mat4(1.0f), glm::vec3(0.75f, 0.1f, 0.0f)) };
+    Contact contact = {};
+    bool hit = collide(a, b, &contact);
+    std::printf("  cubes overlapping 0.25: %s, depth %.4f, normal (%.2f %.2f %.2f)\n",
+                hit ? "hit" : "MISS", contact.depth, contact.normal.x, contact.normal.y, contact.normal.z);
+
+    CollisionShape c = { &hull, glm::translate(glm::mat4(1.0f), glm::vec3(1.1f, 0.0f, 0.0f)) };
+    std::printf("  cubes 0.1 apart: %s\n", collide(a, c, nullptr) ? "HIT" : "separated");
+    std::printf("  cube hull: %zu vertices, %zu triangles\n", hull.vertices.size(), hull.indices.size() / 3);
+}
+
+void runCollisionBenchmark()
+{
+    std::printf("Collision benchmark: sort-and-sweep broadphase, GJK/EPA narrowphase\n");
+    checkKnownCases();
+
+    std::vector<float> rockVertices = makeRockVertices(7);
+    auto start = std::chrono::steady_clock::now();
+    ConvexHull rock = buildConvexHull(rockVertices.data(), rockVertices.size() / 6, 6);
+    std::printf("  rock hull: %zu points -> %zu vertices, %zu triangles in %.3f ms\n",
+                rockVertices.size() / 6, rock.vertices.size(), rock.indices.size() / 3, elapsedMs(start));
+
+    // 10k bodies at roughly one per 8^3 units, drifting like ships between frames
+    const size_t count = 10000;
+    const int frames = 60;
+    const float halfExtent = 4.0f * std::cbrt((float)count);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+    std::uniform_real_distribution<float> velocity(-0.1f, 0.1f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+    std::vector<glm::vec3> centers(count), velocities(count);
+    std::vector<float> yaws(count);
+    for (size_t i = 0; i < count; i++) {
+        centers[i] = glm::vec3(position(rng), position(rng), position(rng));
+        velocities[i] = glm::vec3(velocity(rng), velocity(rng), velocity(rng));
+        yaws[i] = angle(rng);
+    }
+
+    std::vector<Aabb> bounds(count);
+    std::vector<CollisionShape> shapes(count);
+    auto place = [&]() {
+        for (size_t i = 0; i < count; i++) {
+            shapes[i].hull = &rock;
+            shapes[i].transform = glm::rotate(glm::translate(glm::mat4(1.0f), centers[i]), yaws[i], glm::vec3(0.0f, 0.0f, 1.0f));
+            bounds[i] = aabbFromSphere(centers[i], 1.0f);
+        }
+    };
+    place();
+
+    JobSystem jobs;
+    jobs.init();
+
+    SweepAndPrune sap;
+    sap.update(bounds.data(), count); // Initial full sort, not timed
+
+    double broadphaseMs = 0.0;
+    size_t pairCount = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        for (size_t i = 0; i < count; i++)
+            centers[i] += velocities[i];
+        place();
+        start = std::chrono::steady_clock::now();
+        sap.update(bounds.data(), count);
+        broadphaseMs += elapsedMs(start);
+        pairCount += sap.pairs().size();
+    }
+
+    // Brute force on the last frame to check the sweep finds every pair
+    size_t brutePairs = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = i + 1; j < count; j++) {
+            if (overlaps(bounds[i], bounds[j]))
+                brutePairs++;
+        }
+    }
+
+    CollisionWorld world;
+    world.update(bounds.data(), shapes.data(), count, jobs);
+    double worldMs = 0.0;
+    for (int frame = 0; frame < frames; frame++) {
+        for (size_t i = 0; i < count; i++)
+            centers[i] += velocities[i];
+        place();
+        start = std::chrono::steady_clock::now();
+        world.update(bounds.data(), shapes.data(), count, jobs);
+        worldMs += elapsedMs(start);
+    }
+
+    // Narrowphase cost per pair on its own, single threaded
+    const std::vector<BodyPair>& pairs = world.pairs();
+    size_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (const BodyPair& pair : pairs) {
+        Contact contact;
+        if (collide(shapes[pair.a], shapes[pair.b], &contact))
+            hits++;
+    }
+    double narrowMs = elapsedMs(start);
+
+    std::printf("%7zu bodies  broadphase %.3f ms/frame (%.0f pairs avg, last frame %zu / %zu brute force)\n",
+                count, broadphaseMs / frames, (double)pairCount / frames, sap.pairs().size(), brutePairs);
+    std::printf("          full pipeline %.3f ms/frame on %u threads (%zu contacts)\n",
+                worldMs / frames, jobs.threadCount(), world.contacts().size());
+    std::printf("          GJK/EPA %.2f us/pair single threaded (%zu pairs, %zu hits)\n",
+                pairs.empty() ? 0.0 : narrowMs * 1000.0 / pairs.size(), pairs.size(), hits);
+
+    jobs.shutdown();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cmath>
+
+// Depth conventions. With reversed-Z the near plane maps to depth 1 and infinity to 0; in a
+// 32-bit float depth buffer the float's extra precision near 0 then cancels the perspective
+// divide's loss of precision with distance, so depth stays accurate from the cockpit to
+// planet-scale distances in one pass. Needs glClipControl for a [0, 1] clip-space depth range.
+
+inline bool reversedZSupported()
+{
+    return GLEW_VERSION_4_5 || GLEW_ARB_clip_control;
+}
+
+// Comparison that passes for fragments closer than the stored depth
+inline GLenum depthLess(bool reversedZ)
+{
+    return reversedZ ? GL_GREATER : GL_LESS;
+}
+
+inline GLenum depthLessEqual(bool reversedZ)
+{
+    return reversedZ ? GL_GEQUAL : GL_LEQUAL;
+}
+
+// Depth buffer clear value, and the depth of anything at the far plane / infinity
+inline float depthFar(bool reversedZ)
+{
+    return reversedZ ? 0.0f : 1.0f;
+}
+
+// Perspective projection with the far plane at infinity for reversed-Z with [0, 1] clip depth:
+// depth = near / viewDistance
+inline glm::mat4 infiniteReversedPerspective(float fovY, float aspect, float nearPlane)
+{
+    float f = 1.0f / std::tan(fovY * 0.5f);
+    glm::mat4 projection(0.0f);
+    projection[0][0] = f / aspect;
+    projection[1][1] = f;
+    projection[2][3] = -1.0f;
+    projection[3][2] = nearPlane;
+    return projection;
+}
@@ -0,0 +1,37 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool DynamicResolution::update(double gpuSeconds)
+{
+    if (gpuSeconds <= 0.0)
+        return false;
+
+    // Rise fast so a spike is acted on next frame, fall slowly so one quick frame does not
+    smoothed = smoothed == 0.0 ? gpuSeconds : gpuSeconds > smoothed ? smoothed * 0.5 + gpuSeconds * 0.5 : smoothed * 0.9 + gpuSeconds * 0.1;
+    framesSinceChange++;
+
+    float target = current;
+    if (smoothed > budget && framesSinceChange >= settleFrames) {
+        float wanted = current * (float)std::sqrt(budget / smoothed);
+        target = std::floor(wanted / stepSize) * stepSize;
+    } else if (smoothed < budget * 0.8 && framesSinceChange >= raiseFrames) {
+        target = std::round((current + stepSize) / stepSize) * stepSize;
+    }
+    target = std::min(std::max(target, minScale), maxScale);
+    if (std::fabs(target - current) < stepSize * 0.5f)
+        return false;
+
+    // The history was measured at the old size; rescale it so the next decision starts right
+    smoothed *= (target * target) / (current * current);
+    current = target;
+    framesSinceChange = 0;
+    return true;
+}
+
+void DynamicResolution::renderSize(int width, int height, int& renderWidth, int& renderHeight) const
+{
+    renderWidth = std::max(1, (int)std::lround(width * current));
+    renderHeight = std::max(1, (int)std::lround(height * current));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Picks the scene's render scale from measured GPU frame time. Pixel cost is roughly
+// proportional to area, so the scale moves by the square root of budget / time. A spike over
+// budget drops the scale at once; headroom raises it one step at a time after a quiet spell.
+// Scales snap to steps so the render size changes rarely and never oscillates by a few pixels.
+class DynamicResolution
+{
+public:
+    double budget = 1.0 / 60.0; // Seconds of GPU time per frame
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float stepSize = 0.05f;
+
+    // Feeds one GPU frame time; returns true when the scale changed
+    bool update(double gpuSeconds);
+
+    float scale() const { return current; }
+    double smoothedTime() const { return smoothed; }
+
+    // Render size for a window of width x height at the current scale
+    void renderSize(int width, int height, int& renderWidth, int& renderHeight) const;
+
+private:
+    // Measurements arrive a few frames late; ignore drops until they reflect the last change
+    static const int settleFrames = 4;
+    static const int raiseFrames = 30;
+
+    float current = 1.0f;
+    double smoothed = 0.0;
+    int framesSinceChange = 0;
+};
@@ -0,0 +1,109 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+
+namespace {
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+LinearArena::~LinearArena()
+{
+    destroy();
+}
+
+void LinearArena::init(size_t capacity)
+{
+    destroy();
+    size = alignUp(capacity, alignof(std::max_align_t));
+    memory = static_cast<uint8_t*>(::operator new(size, std::nothrow));
+    if (!memory) {
+        std::cerr << "Linear arena: failed to allocate " << size << " bytes" << std::endl;
+        size = 0;
+    }
+}
+
+void LinearArena::destroy()
+{
+    for (void* block : overflowBlocks)
+        ::operator delete(block);
+    overflowBlocks.clear();
+    ::operator delete(memory);
+    memory = nullptr;
+    size = offset = overflowBytes = 0;
+}
+
+void* LinearArena::allocate(size_t bytes, size_t alignment)
+{
+    size_t start = alignUp(offset, alignment);
+    if (start + bytes <= size) {
+        offset = start + bytes;
+        peakBytes = std::max(peakBytes, used());
+        return memory + start;
+    }
+
+    // Out of room this frame: take it from the heap and remember to grow on reset.
+    // Heap alignment covers everything but over-aligned types, which get padding. Going through
+    // operator new keeps overflows visible to the allocation counter.
+    size_t padded = bytes + (alignment > alignof(std::max_align_t) ? alignment : 0);
+    void* block = ::operator new(padded, std::nothrow);
+    if (!block) {
+        std::cerr << "Linear arena: out of memory (" << bytes << " bytes)" << std::endl;
+        std::abort();
+    }
+    overflowBlocks.push_back(block);
+    overflowBytes += bytes;
+    overflows++;
+    peakBytes = std::max(peakBytes, used());
+    return reinterpret_cast<void*>(alignUp(reinterpret_cast<uintptr_t>(block), alignment));
+}
+
+void LinearArena::reset()
+{
+    if (!overflowBlocks.empty()) {
+        for (void* block : overflowBlocks)
+            ::operator delete(block);
+        overflowBlocks.clear();
+
+        // Room for the peak plus a margin for alignment padding
+        size_t grown = alignUp(peakBytes + peakBytes / 4, alignof(std::max_align_t));
+        ::operator delete(memory);
+        memory = static_cast<uint8_t*>(::operator new(grown, std::nothrow));
+        size = memory ? grown : 0;
+        if (!memory)
+            std::cerr << "Linear arena: failed to grow to " << grown << " bytes" << std::endl;
+    }
+    offset = 0;
+    overflowBytes = 0;
+}
+
+void FrameArena::init(size_t capacityPerFrame)
+{
+    arenas[0].init(capacityPerFrame);
+    arenas[1].init(capacityPerFrame);
+    index = 0;
+}
+
+void FrameArena::destroy()
+{
+    arenas[0].destroy();
+    arenas[1].destroy();
+}
+
+void FrameArena::beginFrame()
+{
+    index ^= 1;
+    arenas[index].reset();
+}
+
+size_t FrameArena::peak() const
+{
+    return std::max(arenas[0].peak(), arenas[1].peak());
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator: allocation moves a pointer forward, reset() frees everything at once.
+//
+// When a frame needs more than the capacity, the extra comes from overflow blocks on the heap
+// and the next reset() grows the main block to the peak, so a steady workload stops touching
+// the heap after its first frames.
+class LinearArena
+{
+public:
+    LinearArena() = default;
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+    ~LinearArena();
+
+    void init(size_t capacity);
+    void destroy();
+
+    // Never returns nullptr; the memory is uninitialised
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    // Uninitialised storage for count Ts; only for trivially destructible types, nothing is destroyed
+    template <typename T>
+    T* allocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    void reset();
+
+    size_t used() const { return offset + overflowBytes; }
+    size_t peak() const { return peakBytes; }
+    size_t capacity() const { return size; }
+    uint32_t overflowCount() const { return overflows; } // Since init, heap blocks taken
+
+private:
+    uint8_t* memory = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    size_t peakBytes = 0;
+    size_t overflowBytes = 0;
+    uint32_t overflows = 0;
+    std::vector<void*> overflowBlocks;
+};
+
+// Two arenas used on alternate frames. beginFrame() resets the older one, so whatever was
+// allocated last frame is still valid for the whole of this frame - render data recorded in
+// one frame can be consumed in the next.
+class FrameArena
+{
+public:
+    void init(size_t capacityPerFrame);
+    void destroy();
+
+    void beginFrame();
+
+    LinearArena& current() { return arenas[index]; }
+    LinearArena& previous() { return arenas[index ^ 1]; }
+
+    template <typename T>
+    T* allocateArray(size_t count) { return current().template allocateArray<T>(count); }
+
+    size_t peak() const;
+
+private:
+    LinearArena arenas[2];
+    unsigned int index = 0;
+};
+
+// STL allocator over a LinearArena, for containers that live no longer than the arena's frame.
+// Deallocation does nothing; the memory comes back on reset.
+template <typename T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+
+    LinearArena* arena;
+
+    explicit ArenaAllocator(LinearArena& linearArena) : arena(&linearArena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->allocate(sizeof(T) * count, alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
@@ -0,0 +1,102 @@
+#include "frame_pacing.h"
+
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+const char* swapModeName(SwapMode mode)
+{
+    switch (mode) {
+    case SwapMode_Off: return "off";
+    case SwapMode_On: return "on";
+    case SwapMode_Adaptive: return "adaptive";
+    default: return "unknown";
+    }
+}
+
+SwapMode applySwapMode(SwapMode mode)
+{
+    if (mode == SwapMode_Adaptive && !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+        !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        std::cerr << "Adaptive vsync is not supported, using vsync" << std::endl;
+        mode = SwapMode_On;
+    }
+
+    // A negative interval is the swap_control_tear late swap
+    glfwSwapInterval(mode == SwapMode_Off ? 0 : mode == SwapMode_On ? 1 : -1);
+    return mode;
+}
+
+void FrameLimiter::setTargetRate(double framesPerSecond)
+{
+    period = framesPerSecond > 0.0 ? 1.0 / framesPerSecond : 0.0;
+    nextFrame = 0.0;
+}
+
+void FrameLimiter::wait()
+{
+    if (period <= 0.0)
+        return;
+
+    double now = glfwGetTime();
+    if (nextFrame == 0.0 || now - nextFrame > period) {
+        // First frame, or a whole period behind: start over from now rather than rushing to catch up
+        nextFrame = now + period;
+        return;
+    }
+
+    double sleepUntil = nextFrame - spinMargin;
+    if (now < sleepUntil) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(sleepUntil - now));
+        // Widen the margin straight away when a sleep overshoots, narrow it slowly otherwise
+        double overshoot = glfwGetTime() - sleepUntil;
+        spinMargin = std::min(std::max({ overshoot * 1.5, spinMargin * 0.99, 0.0002 }), period * 0.5);
+    }
+    while (glfwGetTime() < nextFrame)
+        std::this_thread::yield();
+
+    nextFrame += period;
+}
+
+void FrameTimeHistogram::record(double seconds)
+{
+    int bin = std::min((int)(seconds / binWidth), binCount - 1);
+    bins[std::max(bin, 0)]++;
+    count++;
+    longest = std::max(longest, seconds);
+}
+
+void FrameTimeHistogram::reset()
+{
+    std::memset(bins, 0, sizeof(bins));
+    count = 0;
+    longest = 0.0;
+}
+
+double FrameTimeHistogram::percentile(double fraction) const
+{
+    if (count == 0)
+        return 0.0;
+    uint32_t rank = (uint32_t)std::ceil(fraction * count);
+    uint32_t seen = 0;
+    for (int i = 0; i < binCount; i++) {
+        seen += bins[i];
+        if (seen >= rank)
+            return std::min((i + 1) * binWidth, longest);
+    }
+    return longest;
+}
+
+FrameTimeStats FrameTimeHistogram::stats() const
+{
+    FrameTimeStats result;
+    result.p50 = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.max = longest;
+    result.frames = count;
+    return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+// How the swap waits for vertical blank. Adaptive syncs when the frame is on time and swaps
+// immediately (tearing) when it is late, instead of dropping to the next blank.
+enum SwapMode
+{
+    SwapMode_Off,
+    SwapMode_On,
+    SwapMode_Adaptive,
+    SwapMode_Count
+};
+
+const char* swapModeName(SwapMode mode);
+
+// Sets the swap interval of the current context and returns the mode in effect; adaptive falls
+// back to on without the swap_control_tear extension
+SwapMode applySwapMode(SwapMode mode);
+
+// Caps the frame rate. wait() sleeps most of the way to the next frame start and spins the rest,
+// so frames start within a few microseconds of the deadline even with coarse OS sleep. The spin
+// margin follows how late sleeps have actually woken up.
+class FrameLimiter
+{
+public:
+    // Frames per second; 0 disables the limiter
+    void setTargetRate(double framesPerSecond);
+    double targetRate() const { return period > 0.0 ? 1.0 / period : 0.0; }
+
+    // Blocks until the next frame may start
+    void wait();
+
+private:
+    double period = 0.0;
+    double nextFrame = 0.0;
+    double spinMargin = 0.002; // Seconds before the deadline to stop sleeping
+};
+
+struct FrameTimeStats
+{
+    double p50 = 0.0; // Seconds
+    double p99 = 0.0;
+    double max = 0.0;
+    uint32_t frames = 0;
+};
+
+// Frame times binned at 0.1 ms up to 100 ms (longer frames share the last bin, max stays
+// exact). Fixed size, so recording every frame costs nothing.
+class FrameTimeHistogram
+{
+public:
+    static const int binCount = 1000;
+    static constexpr double binWidth = 0.0001;
+
+    void record(double seconds);
+    void reset();
+
+    // Upper edge of the bin holding the given fraction of frames, e.g. 0.99
+    double percentile(double fraction) const;
+    FrameTimeStats stats() const;
+
+private:
+    uint32_t bins[binCount] = {};
+    uint32_t count = 0;
+    double longest = 0.0;
+};
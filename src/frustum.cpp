@@ -0,0 +1,47 @@
+#include "frustum.h"
+
+Frustum extractFrustum(const glm::mat4& m)
+{
+    // Rows of the matrix; glm is column-major so m[column][row]
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0; // Left
+    frustum.planes[1] = row3 - row0; // Right
+    frustum.planes[2] = row3 + row1; // Bottom
+    frustum.planes[3] = row3 - row1; // Top
+    frustum.planes[4] = row3 + row2; // Near
+    frustum.planes[5] = row3 - row2; // Far
+
+    for (glm::vec4& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+    return frustum;
+}
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius)
+{
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool aabbInFrustum(const Frustum& frustum, const glm::vec3& minCorner, const glm::vec3& maxCorner)
+{
+    for (const glm::vec4& plane : frustum.planes) {
+        // Corner furthest along the plane normal
+        glm::vec3 positive(plane.x >= 0.0f ? maxCorner.x : minCorner.x,
+                           plane.y >= 0.0f ? maxCorner.y : minCorner.y,
+                           plane.z >= 0.0f ? maxCorner.z : minCorner.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as six planes (ax + by + cz + d >= 0 inside), normalized so that
+// plane distances are in world units.
+struct Frustum
+{
+    glm::vec4 planes[6]; // left, right, bottom, top, near, far
+};
+
+// Gribb/Hartmann plane extraction from a combined projection * view matrix
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius);
+bool aabbInFrustum(const Frustum& frustum, const glm::vec3& minCorner, const glm::vec3& maxCorner);
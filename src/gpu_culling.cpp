@@ -0,0 +1,354 @@
+#include "gpu_culling.h"
+#include "frustum.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+
+static const char* cullComputeShaderSource = R"glsl(
+    #version 430 core
+    layout(local_size_x = 64) in;
+
+    struct Candidate {
+        mat4 model;
+        uint drawIndex;
+        float radius;
+        uint data;
+        float pad;
+    };
+
+    layout(std430, binding = 0) readonly buffer Candidates { Candidate candidates[]; };
+    // DrawElementsIndirectCommand: count, instanceCount, firstIndex, baseVertex, baseInstance
+    layout(std430, binding = 1) buffer Commands { uint commands[]; };
+    layout(std430, binding = 2) writeonly buffer Instances { mat4 instances[]; };
+    layout(std430, binding = 3) writeonly buffer InstanceData { uint instanceData[]; };
+
+    uniform uint candidateCount;
+    uniform vec4 frustumPlanes[6];
+
+    uniform bool occlusionEnabled;
+    uniform mat4 hiZViewProjection;
+    uniform sampler2D hiZ;
+    uniform ivec2 hiZSize; // Captured region at level 0; the storage may be larger
+    uniform int hiZLevels;
+    uniform bool reversedZ;
+
+    // True when the sphere's screen rectangle lies behind everything in last frame's depth
+    bool occluded(vec3 center, float radius) {
+        vec3 ndcMin = vec3(1.0);
+        vec3 ndcMax = vec3(-1.0);
+        for (int i = 0; i < 8; i++) {
+            vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                                 (i & 2) != 0 ? 1.0 : -1.0,
+                                                 (i & 4) != 0 ? 1.0 : -1.0);
+            vec4 clip = hiZViewProjection * vec4(corner, 1.0);
+            if (clip.w <= 0.0)
+                return false; // Crosses the camera plane, can't tell
+            vec3 ndc = clip.xyz / clip.w;
+            ndcMin = min(ndcMin, ndc);
+            ndcMax = max(ndcMax, ndc);
+        }
+
+        vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+        vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+        // Reversed-Z: clip depth is already [0, 1] and larger means nearer
+        float nearestDepth = reversedZ ? ndcMax.z : ndcMin.z * 0.5 + 0.5;
+
+        // Mip where the rectangle spans at most 2x2 texels, so four taps cover it. Taps stay
+        // inside the captured region; texels beyond it are stale.
+        vec2 extent = (uvMax - uvMin) * vec2(hiZSize);
+        int level = int(clamp(ceil(log2(max(max(extent.x, extent.y), 1.0))), 0.0, float(hiZLevels - 1)));
+        ivec2 size = max(hiZSize >> level, ivec2(1));
+        ivec2 texelMin = min(ivec2(uvMin * vec2(size)), size - 1);
+        ivec2 texelMax = min(ivec2(uvMax * vec2(size)), size - 1);
+
+        vec4 taps = vec4(texelFetch(hiZ, texelMin, level).r, texelFetch(hiZ, ivec2(texelMax.x, texelMin.y), level).r,
+                         texelFetch(hiZ, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(hiZ, texelMax, level).r);
+        if (reversedZ)
+            return nearestDepth < min(min(taps.x, taps.y), min(taps.z, taps.w));
+        return nearestDepth > max(max(taps.x, taps.y), max(taps.z, taps.w));
+    }
+
+    void main() {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= candidateCount)
+            return;
+
+        mat4 model = candidates[i].model;
+        vec3 center = model[3].xyz;
+        float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+        float radius = candidates[i].radius * scale;
+
+        for (int p = 0; p < 6; p++) {
+            if (dot(frustumPlanes[p].xyz, center) + frustumPlanes[p].w < -radius)
+                return;
+        }
+
+        if (occlusionEnabled && occluded(center, radius))
+            return;
+
+        uint command = candidates[i].drawIndex * 5u;
+        uint slot = atomicAdd(commands[command + 1u], 1u);
+        uint instance = commands[command + 4u] + slot;
+        instances[instance] = model;
+        instanceData[instance] = candidates[i].data;
+    }
+)glsl";
+
+// Level 0 of the pyramid: straight copy of the depth texture
+static const char* hiZCopyComputeShaderSource = R"glsl(
+    #version 430 core
+    layout(local_size_x = 8, local_size_y = 8) in;
+
+    uniform sampler2D depthTexture;
+    layout(r32f, binding = 0) writeonly uniform image2D dstLevel;
+    uniform ivec2 size;
+
+    void main() {
+        ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+        if (any(greaterThanEqual(p, size)))
+            return;
+        imageStore(dstLevel, p, vec4(texelFetch(depthTexture, p, 0).r));
+    }
+)glsl";
+
+// Each texel keeps the farthest depth of the texels it covers in the level above: the max, or
+// the min with reversed-Z
+static const char* hiZReduceComputeShaderSource = R"glsl(
+    #version 430 core
+    layout(local_size_x = 8, local_size_y = 8) in;
+
+    layout(r32f, binding = 0) readonly uniform image2D srcLevel;
+    layout(r32f, binding = 1) writeonly uniform image2D dstLevel;
+    uniform ivec2 srcSize;
+    uniform ivec2 dstSize;
+    uniform bool reversedZ;
+
+    float fetch(ivec2 p) {
+        return imageLoad(srcLevel, min(p, srcSize - 1)).r;
+    }
+
+    float farthest(float a, float b) {
+        return reversedZ ? min(a, b) : max(a, b);
+    }
+
+    void main() {
+        ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+        if (any(greaterThanEqual(p, dstSize)))
+            return;
+
+        ivec2 s = p * 2;
+        float d = farthest(farthest(fetch(s), fetch(s + ivec2(1, 0))), farthest(fetch(s + ivec2(0, 1)), fetch(s + ivec2(1, 1))));
+
+        // Odd sizes: the last row/column also folds in the texels that didn't fit a 2x2 block
+        bool oddX = (srcSize.x & 1) != 0 && p.x == dstSize.x - 1;
+        bool oddY = (srcSize.y & 1) != 0 && p.y == dstSize.y - 1;
+        if (oddX)
+            d = farthest(d, farthest(fetch(s + ivec2(2, 0)), fetch(s + ivec2(2, 1))));
+        if (oddY)
+            d = farthest(d, farthest(fetch(s + ivec2(0, 2)), fetch(s + ivec2(1, 2))));
+        if (oddX && oddY)
+            d = farthest(d, fetch(s + ivec2(2, 2)));
+
+        imageStore(dstLevel, p, vec4(d));
+    }
+)glsl";
+
+bool GpuCuller::init()
+{
+    if (!(GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object))) {
+        std::cout << "GPU culling: compute shaders not available, using CPU culling" << std::endl;
+        return false;
+    }
+
+    cullProgram = createComputeProgram(cullComputeShaderSource, "Cull");
+    hiZCopyProgram = createComputeProgram(hiZCopyComputeShaderSource, "Hi-Z copy");
+    hiZReduceProgram = createComputeProgram(hiZReduceComputeShaderSource, "Hi-Z reduce");
+    if (!cullProgram || !hiZCopyProgram || !hiZReduceProgram) {
+        destroy();
+        return false;
+    }
+
+    glGenBuffers(1, &candidateBuffer);
+    if (resources)
+        candidateHandle = resources->adopt<GpuResource_Buffer>(candidateBuffer, GpuMemory_Other, "Cull candidates");
+    std::cout << "GPU culling: enabled" << std::endl;
+    return true;
+}
+
+void GpuCuller::destroy()
+{
+    glDeleteProgram(cullProgram);
+    glDeleteProgram(hiZCopyProgram);
+    glDeleteProgram(hiZReduceProgram);
+    cullProgram = hiZCopyProgram = hiZReduceProgram = 0;
+
+    if (resources && candidateHandle.valid())
+        resources->release(candidateHandle);
+    else if (candidateBuffer)
+        glDeleteBuffers(1, &candidateBuffer);
+    deleteDepthTextures();
+    candidateBuffer = 0;
+    candidateCapacity = 0;
+    depthWidth = depthHeight = hiZWidth = hiZHeight = hiZLevels = 0;
+    hiZValid = false;
+}
+
+void GpuCuller::beginFrame(const glm::mat4& viewProjection)
+{
+    Frustum frustum = extractFrustum(viewProjection);
+    for (int i = 0; i < 6; i++)
+        frustumPlanes[i] = frustum.planes[i];
+}
+
+void GpuCuller::deleteDepthTextures()
+{
+    if (resources && depthHandle.valid())
+        resources->release(depthHandle);
+    else if (depthTexture)
+        glDeleteTextures(1, &depthTexture);
+    if (resources && hiZHandle.valid())
+        resources->release(hiZHandle);
+    else if (hiZTexture)
+        glDeleteTextures(1, &hiZTexture);
+    depthTexture = hiZTexture = 0;
+}
+
+void GpuCuller::resizeDepth(int width, int height)
+{
+    deleteDepthTextures();
+
+    depthWidth = width;
+    depthHeight = height;
+    depthReversed = reversedZ;
+    const int levels = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    // Must match the scene depth format for the copy: 32F with reversed-Z, 24-bit otherwise
+    if (reversedZ)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glGenTextures(1, &hiZTexture);
+    glBindTexture(GL_TEXTURE_2D, hiZTexture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (resources) {
+        depthHandle = resources->adopt<GpuResource_Texture>(depthTexture, GpuMemory_Other, "Hi-Z depth copy");
+        resources->setMemory(depthHandle, (size_t)width * height * 4);
+        size_t pyramidBytes = 0;
+        for (int level = 0; level < levels; level++)
+            pyramidBytes += (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * 4;
+        hiZHandle = resources->adopt<GpuResource_Texture>(hiZTexture, GpuMemory_Other, "Hi-Z pyramid");
+        resources->setMemory(hiZHandle, pyramidBytes);
+    }
+    hiZValid = false;
+    checkGLError("Hi-Z texture setup error");
+}
+
+void GpuCuller::captureDepth(int width, int height, int targetWidth, int targetHeight, const glm::mat4& viewProjection)
+{
+    if (!active() || !occlusionEnabled || width <= 0 || height <= 0)
+        return;
+
+    width = std::min(width, targetWidth);
+    height = std::min(height, targetHeight);
+    if (targetWidth != depthWidth || targetHeight != depthHeight || reversedZ != depthReversed)
+        resizeDepth(targetWidth, targetHeight);
+    hiZWidth = width;
+    hiZHeight = height;
+    hiZLevels = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+
+    // Depth of the bound read framebuffer into our texture (no readback to the CPU)
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    glUseProgram(hiZCopyProgram);
+    glUniform1i(glGetUniformLocation(hiZCopyProgram, "depthTexture"), 0);
+    glUniform2i(glGetUniformLocation(hiZCopyProgram, "size"), width, height);
+    glBindImageTexture(0, hiZTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+
+    glUseProgram(hiZReduceProgram);
+    glUniform1i(glGetUniformLocation(hiZReduceProgram, "reversedZ"), reversedZ ? 1 : 0);
+    int srcLoc = glGetUniformLocation(hiZReduceProgram, "srcSize");
+    int dstLoc = glGetUniformLocation(hiZReduceProgram, "dstSize");
+    for (int level = 1; level < hiZLevels; level++) {
+        int srcWidth = std::max(1, width >> (level - 1));
+        int srcHeight = std::max(1, height >> (level - 1));
+        int dstWidth = std::max(1, width >> level);
+        int dstHeight = std::max(1, height >> level);
+
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        glBindImageTexture(0, hiZTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glUniform2i(srcLoc, srcWidth, srcHeight);
+        glUniform2i(dstLoc, dstWidth, dstHeight);
+        glDispatchCompute((dstWidth + 7) / 8, (dstHeight + 7) / 8, 1);
+    }
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    hiZViewProjection = viewProjection;
+    hiZValid = true;
+}
+
+void GpuCuller::cull(const std::vector<CullCandidate>& candidates, unsigned int indirectBuffer,
+                     unsigned int instanceBuffer, unsigned int instanceDataBuffer)
+{
+    if (candidates.empty())
+        return;
+
+    size_t bytes = candidates.size() * sizeof(CullCandidate);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, candidateBuffer);
+    if (bytes > candidateCapacity)
+        candidateCapacity = std::max(bytes, candidateCapacity * 2);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, candidateCapacity, NULL, GL_STREAM_DRAW);
+    if (resources)
+        resources->setMemory(candidateHandle, candidateCapacity);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, candidates.data());
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, candidateBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, indirectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, instanceDataBuffer);
+
+    glUseProgram(cullProgram);
+    glUniform1ui(glGetUniformLocation(cullProgram, "candidateCount"), (GLuint)candidates.size());
+    glUniform4fv(glGetUniformLocation(cullProgram, "frustumPlanes"), 6, glm::value_ptr(frustumPlanes[0]));
+
+    bool occlusion = occlusionEnabled && hiZValid;
+    glUniform1i(glGetUniformLocation(cullProgram, "occlusionEnabled"), occlusion ? 1 : 0);
+    if (occlusion) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hiZTexture);
+        glUniform1i(glGetUniformLocation(cullProgram, "hiZ"), 0);
+        glUniformMatrix4fv(glGetUniformLocation(cullProgram, "hiZViewProjection"), 1, GL_FALSE, glm::value_ptr(hiZViewProjection));
+        glUniform2i(glGetUniformLocation(cullProgram, "hiZSize"), hiZWidth, hiZHeight);
+        glUniform1i(glGetUniformLocation(cullProgram, "hiZLevels"), hiZLevels);
+        glUniform1i(glGetUniformLocation(cullProgram, "reversedZ"), reversedZ ? 1 : 0);
+    }
+
+    glDispatchCompute((GLuint)((candidates.size() + 63) / 64), 1, 1);
+
+    // The indirect draw and the vertex fetch consume what the compute pass wrote
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "gpu_resources.h"
+
+// Per-instance input of the culling pass, std430 layout
+struct CullCandidate
+{
+    glm::mat4 model;
+    uint32_t drawIndex; // Indirect command this instance belongs to
+    float radius;       // Mesh bounding sphere radius, scaled by the shader
+    uint32_t data;      // Per-instance value copied along with the model (texture layer)
+    float pad;
+};
+
+// GPU-driven culling for MeshPool batches (needs GL 4.3 compute and SSBOs).
+//
+// A compute pass tests every candidate instance against the frustum and against a Hi-Z depth
+// pyramid built from the previous frame, then compacts the survivors into the pool's instance
+// stream and bumps instanceCount of their DrawElementsIndirectCommand with an atomic. The
+// indirect draw then only sees visible instances. Without compute the CPU frustum test is used.
+class GpuCuller
+{
+public:
+    bool enabled = true;
+    bool occlusionEnabled = true;
+    bool reversedZ = false; // Depth 1 is near and clip depth is [0, 1]; see depth.h
+
+    // With a registry set the candidate buffer and the depth copies are accounted there
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    bool init();
+    void destroy();
+    bool supported() const { return cullProgram != 0; }
+    bool active() const { return enabled && supported(); }
+
+    // Frustum of the frame being culled
+    void beginFrame(const glm::mat4& viewProjection);
+
+    // Copies the depth of the frame just rendered from the read framebuffer and reduces it into
+    // the Hi-Z pyramid used to cull the next frame. viewProjection is the matrix it was drawn with.
+    // The frame covers the bottom-left width x height of a targetWidth x targetHeight framebuffer;
+    // storage follows the framebuffer, so a change of render size reallocates nothing.
+    void captureDepth(int width, int height, int targetWidth, int targetHeight, const glm::mat4& viewProjection);
+
+    // Forgets the pyramid so the next frame is culled by frustum only, e.g. after a rebase moved
+    // everything relative to the depth that was captured
+    void invalidateDepth() { hiZValid = false; }
+
+    // Culls candidates into instanceBuffer and their data into instanceDataBuffer, using the
+    // commands already uploaded to indirectBuffer (instanceCount 0, baseInstance set to each
+    // draw's reserved range)
+    void cull(const std::vector<CullCandidate>& candidates, unsigned int indirectBuffer,
+              unsigned int instanceBuffer, unsigned int instanceDataBuffer);
+
+private:
+    void resizeDepth(int width, int height);
+    void deleteDepthTextures();
+
+    unsigned int cullProgram = 0;
+    unsigned int hiZCopyProgram = 0;
+    unsigned int hiZReduceProgram = 0;
+
+    GpuResources* resources = nullptr;
+    BufferHandle candidateHandle;
+    TextureHandle depthHandle;
+    TextureHandle hiZHandle;
+
+    unsigned int candidateBuffer = 0;
+    size_t candidateCapacity = 0; // Bytes
+
+    unsigned int depthTexture = 0; // Copy of last frame's depth buffer
+    unsigned int hiZTexture = 0;   // R32F farthest-depth pyramid (max, or min with reversed-Z)
+    int depthWidth = 0;            // Storage size
+    int depthHeight = 0;
+    int hiZWidth = 0;              // Region of the last capture
+    int hiZHeight = 0;
+    int hiZLevels = 0;             // Levels of the last capture
+    bool depthReversed = false; // Convention the depth texture was created for
+    bool hiZValid = false;
+
+    glm::vec4 frustumPlanes[6];
+    glm::mat4 hiZViewProjection = glm::mat4(1.0f);
+};
@@ -0,0 +1,217 @@
+#include "gpu_resources.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const char* typeNames[GpuResource_TypeCount] = { "buffer", "vertex array", "texture", "framebuffer", "program" };
+const char* categoryNames[GpuMemory_CategoryCount] = { "geometry", "textures", "render targets", "text", "other" };
+
+}
+
+BufferHandle GpuResources::createBuffer(GpuMemoryCategory category, const char* name)
+{
+    unsigned int buffer = 0;
+    glGenBuffers(1, &buffer);
+    return adopt<GpuResource_Buffer>(buffer, category, name);
+}
+
+VertexArrayHandle GpuResources::createVertexArray(const char* name)
+{
+    unsigned int vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+    return adopt<GpuResource_VertexArray>(vertexArray, GpuMemory_Other, name);
+}
+
+TextureHandle GpuResources::createTexture(GpuMemoryCategory category, const char* name)
+{
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    return adopt<GpuResource_Texture>(texture, category, name);
+}
+
+FramebufferHandle GpuResources::createFramebuffer(const char* name)
+{
+    unsigned int framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    return adopt<GpuResource_Framebuffer>(framebuffer, GpuMemory_RenderTargets, name);
+}
+
+uint32_t GpuResources::insert(GpuResourceType type, unsigned int glName, GpuMemoryCategory category, const char* name)
+{
+    if (!glName) {
+        std::cerr << "GPU resources: failed to create " << typeNames[type] << " '" << name << "'" << std::endl;
+        return UINT32_MAX;
+    }
+
+    uint32_t index;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        index = (uint32_t)slots.size();
+        slots.emplace_back();
+    }
+
+    Slot& slot = slots[index];
+    slot.glName = glName;
+    slot.refCount = 1;
+    slot.type = type;
+    slot.category = category;
+    slot.bytes = 0;
+    slot.name = name;
+    liveCounts[type]++;
+    return index;
+}
+
+const GpuResources::Slot* GpuResources::resolve(GpuResourceType type, uint32_t index, uint32_t generation) const
+{
+    if (generation == 0 || index >= slots.size())
+        return nullptr;
+    const Slot& slot = slots[index];
+    if (slot.generation != generation || slot.refCount <= 0 || slot.type != type)
+        return nullptr;
+    return &slot;
+}
+
+unsigned int GpuResources::lookup(GpuResourceType type, uint32_t index, uint32_t generation) const
+{
+    const Slot* slot = resolve(type, index, generation);
+    return slot ? slot->glName : 0;
+}
+
+void GpuResources::changeRefs(GpuResourceType type, uint32_t index, uint32_t generation, int delta)
+{
+    if (generation == 0)
+        return;
+    if (!resolve(type, index, generation)) {
+        std::cerr << "GPU resources: stale " << typeNames[type] << " handle " << index << "/" << generation << std::endl;
+        return;
+    }
+
+    Slot& slot = slots[index];
+    slot.refCount += delta;
+    if (slot.refCount > 0)
+        return;
+
+    // Last reference: the name dies once the GPU is past this frame, the slot is reusable now
+    releasedThisFrame.push_back(PendingDelete{ slot.type, slot.category, slot.glName, slot.bytes });
+    liveCounts[slot.type]--;
+    slot.glName = 0;
+    slot.refCount = 0;
+    slot.bytes = 0;
+    slot.name.clear();
+    if (++slot.generation == 0)
+        slot.generation = 1;
+    freeSlots.push_back(index);
+}
+
+void GpuResources::recordMemory(GpuResourceType type, uint32_t index, uint32_t generation, size_t bytes)
+{
+    if (!resolve(type, index, generation))
+        return;
+    Slot& slot = slots[index];
+    size_t& used = categoryBytes[slot.category];
+    used = used - slot.bytes + bytes;
+    categoryPeak[slot.category] = std::max(categoryPeak[slot.category], used);
+    slot.bytes = bytes;
+}
+
+void GpuResources::bufferData(BufferHandle handle, GLenum target, size_t bytes, const void* data, GLenum usage)
+{
+    glBindBuffer(target, get(handle));
+    glBufferData(target, (GLsizeiptr)bytes, data, usage);
+    setMemory(handle, bytes);
+}
+
+void GpuResources::deleteNow(const PendingDelete& pending)
+{
+    switch (pending.type) {
+    case GpuResource_Buffer:      glDeleteBuffers(1, &pending.glName); break;
+    case GpuResource_VertexArray: glDeleteVertexArrays(1, &pending.glName); break;
+    case GpuResource_Texture:     glDeleteTextures(1, &pending.glName); break;
+    case GpuResource_Framebuffer: glDeleteFramebuffers(1, &pending.glName); break;
+    case GpuResource_Program:     glDeleteProgram(pending.glName); break;
+    default: break;
+    }
+    categoryBytes[pending.category] -= pending.bytes;
+}
+
+void GpuResources::endFrame()
+{
+    if (!releasedThisFrame.empty()) {
+        RetireBatch batch;
+        batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        batch.deletes.swap(releasedThisFrame);
+        retiring.push_back(std::move(batch));
+    }
+
+    // Poll without waiting; a batch that is not done yet blocks the newer ones behind it
+    while (!retiring.empty()) {
+        RetireBatch& batch = retiring.front();
+        GLenum status = glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        for (const PendingDelete& pending : batch.deletes)
+            deleteNow(pending);
+        glDeleteSync(batch.fence);
+        retiring.pop_front();
+    }
+}
+
+void GpuResources::destroy()
+{
+    glFinish();
+    for (RetireBatch& batch : retiring) {
+        for (const PendingDelete& pending : batch.deletes)
+            deleteNow(pending);
+        glDeleteSync(batch.fence);
+    }
+    retiring.clear();
+    for (const PendingDelete& pending : releasedThisFrame)
+        deleteNow(pending);
+    releasedThisFrame.clear();
+
+    for (Slot& slot : slots) {
+        if (slot.refCount <= 0)
+            continue;
+        std::cerr << "GPU resource leak: " << typeNames[slot.type] << " '" << slot.name << "' (" << slot.refCount
+                  << (slot.refCount == 1 ? " reference, " : " references, ") << slot.bytes << " bytes)" << std::endl;
+        deleteNow(PendingDelete{ slot.type, slot.category, slot.glName, slot.bytes });
+        liveCounts[slot.type]--;
+    }
+    slots.clear();
+    freeSlots.clear();
+}
+
+size_t GpuResources::totalMemory() const
+{
+    size_t total = 0;
+    for (size_t bytes : categoryBytes)
+        total += bytes;
+    return total;
+}
+
+size_t GpuResources::pendingDeletes() const
+{
+    size_t count = releasedThisFrame.size();
+    for (const RetireBatch& batch : retiring)
+        count += batch.deletes.size();
+    return count;
+}
+
+void GpuResources::printReport(std::ostream& out) const
+{
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    out << "GPU memory: " << totalMemory() * mb << " MB";
+    for (int c = 0; c < GpuMemory_CategoryCount; c++) {
+        if (categoryPeak[c] == 0)
+            continue;
+        out << ", " << categoryNames[c] << " " << categoryBytes[c] * mb << " MB (peak " << categoryPeak[c] * mb << ")";
+    }
+    out << "; live:";
+    for (int t = 0; t < GpuResource_TypeCount; t++)
+        out << (t ? ", " : " ") << liveCounts[t] << " " << typeNames[t] << (liveCounts[t] == 1 ? "" : "s");
+    out << "; " << pendingDeletes() << " awaiting deletion" << std::endl;
+}
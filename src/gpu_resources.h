@@ -0,0 +1,161 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum GpuResourceType
+{
+    GpuResource_Buffer,
+    GpuResource_VertexArray,
+    GpuResource_Texture,
+    GpuResource_Framebuffer,
+    GpuResource_Program,
+    GpuResource_TypeCount
+};
+
+// What the memory of a resource is spent on, for the usage report
+enum GpuMemoryCategory
+{
+    GpuMemory_Geometry,
+    GpuMemory_Textures,
+    GpuMemory_RenderTargets,
+    GpuMemory_Text,
+    GpuMemory_Other,
+    GpuMemory_CategoryCount
+};
+
+// Slot index plus the generation the slot had when the handle was made. A released slot bumps
+// its generation, so old handles to it resolve to 0 instead of whatever reuses the slot.
+// Generation 0 is the null handle.
+template <GpuResourceType Type>
+struct GpuHandle
+{
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    bool valid() const { return generation != 0; }
+};
+
+typedef GpuHandle<GpuResource_Buffer> BufferHandle;
+typedef GpuHandle<GpuResource_VertexArray> VertexArrayHandle;
+typedef GpuHandle<GpuResource_Texture> TextureHandle;
+typedef GpuHandle<GpuResource_Framebuffer> FramebufferHandle;
+typedef GpuHandle<GpuResource_Program> ProgramHandle;
+
+// Owns GL object names behind typed, generational handles.
+//
+// Each resource starts with one reference; addRef/release share it, and the last release
+// queues the GL name for deletion. Deletion waits for a fence placed at the end of the frame
+// the release happened in, so nothing the GPU may still read is deleted under it, and the
+// memory stays counted until then. Whatever is still alive in destroy() is reported as a leak.
+class GpuResources
+{
+public:
+    BufferHandle createBuffer(GpuMemoryCategory category, const char* name);
+    VertexArrayHandle createVertexArray(const char* name);
+    TextureHandle createTexture(GpuMemoryCategory category, const char* name);
+    FramebufferHandle createFramebuffer(const char* name);
+
+    // Takes ownership of a name created elsewhere (programs, textures made by a loader)
+    template <GpuResourceType Type>
+    GpuHandle<Type> adopt(unsigned int glName, GpuMemoryCategory category, const char* name)
+    {
+        return toHandle<Type>(insert(Type, glName, category, name));
+    }
+
+    // The GL name, or 0 for a null or stale handle
+    template <GpuResourceType Type>
+    unsigned int get(GpuHandle<Type> handle) const { return lookup(Type, handle.index, handle.generation); }
+
+    template <GpuResourceType Type>
+    void addRef(GpuHandle<Type> handle) { changeRefs(Type, handle.index, handle.generation, 1); }
+
+    // Drops a reference; the handle must not be used afterwards
+    template <GpuResourceType Type>
+    void release(GpuHandle<Type>& handle)
+    {
+        changeRefs(Type, handle.index, handle.generation, -1);
+        handle = GpuHandle<Type>();
+    }
+
+    // Records how many bytes of GPU memory the resource holds now
+    template <GpuResourceType Type>
+    void setMemory(GpuHandle<Type> handle, size_t bytes) { recordMemory(Type, handle.index, handle.generation, bytes); }
+
+    // glBufferData on the handle's buffer, with its size recorded
+    void bufferData(BufferHandle handle, GLenum target, size_t bytes, const void* data, GLenum usage);
+
+    // Call once per frame after the last draw: fences this frame's releases and deletes the
+    // objects whose fences have passed
+    void endFrame();
+
+    // Waits for the GPU, deletes everything and reports what was never released
+    void destroy();
+
+    size_t memoryUsed(GpuMemoryCategory category) const { return categoryBytes[category]; }
+    size_t memoryPeak(GpuMemoryCategory category) const { return categoryPeak[category]; }
+    size_t totalMemory() const;
+    uint32_t liveCount(GpuResourceType type) const { return liveCounts[type]; }
+    size_t pendingDeletes() const;
+
+    void printReport(std::ostream& out) const;
+
+private:
+    struct Slot
+    {
+        unsigned int glName = 0;
+        uint32_t generation = 1;
+        int32_t refCount = 0; // 0 while the slot is free
+        GpuResourceType type = GpuResource_Buffer;
+        GpuMemoryCategory category = GpuMemory_Other;
+        size_t bytes = 0;
+        std::string name;
+    };
+
+    struct PendingDelete
+    {
+        GpuResourceType type;
+        GpuMemoryCategory category;
+        unsigned int glName;
+        size_t bytes;
+    };
+
+    struct RetireBatch
+    {
+        GLsync fence;
+        std::vector<PendingDelete> deletes;
+    };
+
+    // Handle to a live slot; null for an out-of-range index (a failed insert)
+    template <GpuResourceType Type>
+    GpuHandle<Type> toHandle(uint32_t index) const
+    {
+        GpuHandle<Type> handle;
+        if (index < slots.size()) {
+            handle.index = index;
+            handle.generation = slots[index].generation;
+        }
+        return handle;
+    }
+
+    uint32_t insert(GpuResourceType type, unsigned int glName, GpuMemoryCategory category, const char* name);
+    const Slot* resolve(GpuResourceType type, uint32_t index, uint32_t generation) const;
+    unsigned int lookup(GpuResourceType type, uint32_t index, uint32_t generation) const;
+    void changeRefs(GpuResourceType type, uint32_t index, uint32_t generation, int delta);
+    void recordMemory(GpuResourceType type, uint32_t index, uint32_t generation, size_t bytes);
+    void deleteNow(const PendingDelete& pending);
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<PendingDelete> releasedThisFrame;
+    std::deque<RetireBatch> retiring; // Oldest first; fences signal in order
+
+    size_t categoryBytes[GpuMemory_CategoryCount] = {};
+    size_t categoryPeak[GpuMemory_CategoryCount] = {};
+    uint32_t liveCounts[GpuResource_TypeCount] = {};
+};
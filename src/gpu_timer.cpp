@@ -0,0 +1,58 @@
+#include "gpu_timer.h"
+
+#include <GL/glew.h>
+
+void GpuTimer::init()
+{
+    glGenQueries(latency, queries);
+}
+
+void GpuTimer::destroy()
+{
+    glDeleteQueries(latency, queries);
+    for (int i = 0; i < latency; i++) {
+        queries[i] = 0;
+        pending[i] = false;
+    }
+}
+
+void GpuTimer::begin()
+{
+    // Every query is still in flight (the GPU is more than latency frames behind): skip this
+    // frame rather than wait
+    if (!queries[next] || pending[next])
+        return;
+    glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+    active = true;
+}
+
+void GpuTimer::end()
+{
+    if (!active)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[next] = true;
+    next = (next + 1) % latency;
+    active = false;
+}
+
+bool GpuTimer::read(double& seconds)
+{
+    // Collect finished queries oldest first; they finish in submission order
+    while (pending[oldest]) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &nanoseconds);
+        lastResult = nanoseconds * 1e-9;
+        pending[oldest] = false;
+        oldest = (oldest + 1) % latency;
+    }
+
+    if (lastResult < 0.0)
+        return false;
+    seconds = lastResult;
+    return true;
+}
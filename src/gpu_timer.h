@@ -0,0 +1,27 @@
+#pragma once
+
+// GPU time of a span of commands, measured with GL_TIME_ELAPSED queries. Results are read a few
+// frames later, when the GPU has finished them, so measuring never stalls the CPU. Elapsed-time
+// queries cannot overlap, so timed spans must not nest.
+class GpuTimer
+{
+public:
+    static const int latency = 4; // Frames of queries in flight
+
+    void init();
+    void destroy();
+
+    void begin();
+    void end();
+
+    // Newest finished measurement in seconds; false until the first one arrives
+    bool read(double& seconds);
+
+private:
+    unsigned int queries[latency] = {};
+    bool pending[latency] = {};
+    int next = 0;       // Query the next begin() uses
+    int oldest = 0;     // Oldest query that may still be pending
+    bool active = false;
+    double lastResult = -1.0;
+};
@@ -0,0 +1,375 @@
+#include "image.h"
+
+#include <cstring>
+#include <fstream>
+
+bool readFile(const std::string& path, std::vector<uint8_t>& bytes)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::streamsize size = file.tellg();
+    file.seekg(0);
+    bytes.resize((size_t)size);
+    return size == 0 || (bool)file.read((char*)bytes.data(), size);
+}
+
+namespace {
+
+// LSB-first bit stream as used by deflate
+struct BitReader
+{
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+    bool overrun = false;
+
+    uint32_t bits(int count)
+    {
+        while (bitCount < count) {
+            uint32_t byte = 0;
+            if (pos < size)
+                byte = data[pos++];
+            else
+                overrun = true;
+            bitBuffer |= byte << bitCount;
+            bitCount += 8;
+        }
+        uint32_t value = bitBuffer & ((1u << count) - 1u);
+        bitBuffer >>= count;
+        bitCount -= count;
+        return value;
+    }
+
+    void alignToByte()
+    {
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+};
+
+// Canonical Huffman code: number of codes per length and the symbols in code order
+struct Huffman
+{
+    uint16_t counts[16];
+    uint16_t symbols[288];
+};
+
+bool buildHuffman(Huffman& huffman, const uint8_t* lengths, int symbolCount)
+{
+    std::memset(huffman.counts, 0, sizeof(huffman.counts));
+    for (int i = 0; i < symbolCount; i++)
+        huffman.counts[lengths[i]]++;
+    huffman.counts[0] = 0;
+
+    int left = 1;
+    for (int length = 1; length < 16; length++) {
+        left = (left << 1) - huffman.counts[length];
+        if (left < 0)
+            return false; // Over-subscribed
+    }
+
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (int length = 1; length < 15; length++)
+        offsets[length + 1] = offsets[length] + huffman.counts[length];
+    for (int i = 0; i < symbolCount; i++) {
+        if (lengths[i])
+            huffman.symbols[offsets[lengths[i]]++] = (uint16_t)i;
+    }
+    return true;
+}
+
+int decodeSymbol(BitReader& reader, const Huffman& huffman)
+{
+    int code = 0, first = 0, index = 0;
+    for (int length = 1; length < 16; length++) {
+        code |= (int)reader.bits(1);
+        int count = huffman.counts[length];
+        if (code - first < count)
+            return huffman.symbols[index + (code - first)];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+bool inflateBlock(BitReader& reader, const Huffman& lengthCodes, const Huffman& distanceCodes, std::vector<uint8_t>& out)
+{
+    for (;;) {
+        int symbol = decodeSymbol(reader, lengthCodes);
+        if (symbol < 0 || reader.overrun)
+            return false;
+        if (symbol < 256) {
+            out.push_back((uint8_t)symbol);
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+        size_t length = lengthBase[symbol] + reader.bits(lengthExtra[symbol]);
+
+        int distanceSymbol = decodeSymbol(reader, distanceCodes);
+        if (distanceSymbol < 0 || distanceSymbol >= 30)
+            return false;
+        size_t distance = distanceBase[distanceSymbol] + reader.bits(distanceExtra[distanceSymbol]);
+        if (distance > out.size())
+            return false;
+
+        // Byte by byte: the copy may overlap what it is writing
+        size_t from = out.size() - distance;
+        for (size_t i = 0; i < length; i++)
+            out.push_back(out[from + i]);
+    }
+}
+
+// zlib stream (RFC 1950 wrapper around RFC 1951 deflate); the Adler-32 trailer is not checked
+bool zlibInflate(const std::vector<uint8_t>& in, std::vector<uint8_t>& out, size_t expectedSize)
+{
+    if (in.size() < 2 || (in[0] & 0x0F) != 8 || ((in[0] << 8) | in[1]) % 31 != 0 || (in[1] & 0x20))
+        return false;
+
+    BitReader reader = { in.data() + 2, in.size() - 2 };
+    out.clear();
+    out.reserve(expectedSize);
+
+    bool last = false;
+    while (!last) {
+        last = reader.bits(1) != 0;
+        uint32_t type = reader.bits(2);
+
+        if (type == 0) {
+            // Stored: byte aligned length, its complement, raw bytes
+            reader.alignToByte();
+            if (reader.pos + 4 > reader.size)
+                return false;
+            uint32_t length = reader.data[reader.pos] | (reader.data[reader.pos + 1] << 8);
+            uint32_t complement = reader.data[reader.pos + 2] | (reader.data[reader.pos + 3] << 8);
+            reader.pos += 4;
+            if ((length ^ 0xFFFFu) != complement || reader.pos + length > reader.size)
+                return false;
+            out.insert(out.end(), reader.data + reader.pos, reader.data + reader.pos + length);
+            reader.pos += length;
+            continue;
+        }
+
+        Huffman lengthCodes, distanceCodes;
+        uint8_t lengths[320];
+        if (type == 1) {
+            // Fixed codes
+            int i = 0;
+            for (; i < 144; i++) lengths[i] = 8;
+            for (; i < 256; i++) lengths[i] = 9;
+            for (; i < 280; i++) lengths[i] = 7;
+            for (; i < 288; i++) lengths[i] = 8;
+            buildHuffman(lengthCodes, lengths, 288);
+            for (i = 0; i < 30; i++) lengths[i] = 5;
+            buildHuffman(distanceCodes, lengths, 30);
+        } else if (type == 2) {
+            // Dynamic codes, themselves Huffman coded
+            static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+            int lengthCount = (int)reader.bits(5) + 257;
+            int distanceCount = (int)reader.bits(5) + 1;
+            int codeLengthCount = (int)reader.bits(4) + 4;
+            if (lengthCount > 286 || distanceCount > 30)
+                return false;
+
+            uint8_t codeLengths[19] = {};
+            for (int i = 0; i < codeLengthCount; i++)
+                codeLengths[order[i]] = (uint8_t)reader.bits(3);
+            Huffman codeLengthCodes;
+            if (!buildHuffman(codeLengthCodes, codeLengths, 19))
+                return false;
+
+            int total = lengthCount + distanceCount;
+            for (int i = 0; i < total; ) {
+                int symbol = decodeSymbol(reader, codeLengthCodes);
+                if (symbol < 0)
+                    return false;
+                if (symbol < 16) {
+                    lengths[i++] = (uint8_t)symbol;
+                    continue;
+                }
+                uint8_t value = 0;
+                int repeat;
+                if (symbol == 16) {
+                    if (i == 0)
+                        return false;
+                    value = lengths[i - 1];
+                    repeat = 3 + (int)reader.bits(2);
+                } else if (symbol == 17) {
+                    repeat = 3 + (int)reader.bits(3);
+                } else {
+                    repeat = 11 + (int)reader.bits(7);
+                }
+                if (i + repeat > total)
+                    return false;
+                while (repeat--)
+                    lengths[i++] = value;
+            }
+
+            if (!buildHuffman(lengthCodes, lengths, lengthCount) ||
+                !buildHuffman(distanceCodes, lengths + lengthCount, distanceCount))
+                return false;
+        } else {
+            return false;
+        }
+
+        if (!inflateBlock(reader, lengthCodes, distanceCodes, out))
+            return false;
+    }
+    return !reader.overrun;
+}
+
+uint32_t readBigEndian(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint8_t paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = p > a ? p - a : a - p;
+    int pb = p > b ? p - b : b - p;
+    int pc = p > c ? p - c : c - p;
+    if (pa <= pb && pa <= pc)
+        return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+}
+
+bool decodePng(const std::vector<uint8_t>& file, std::vector<uint8_t>& rgba, int& width, int& height, std::string& error)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (file.size() < 8 || std::memcmp(file.data(), signature, 8) != 0) {
+        error = "not a PNG file";
+        return false;
+    }
+
+    uint32_t w = 0, h = 0;
+    int colorType = -1;
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> palette; // RGBA entries
+
+    size_t pos = 8;
+    while (pos + 8 <= file.size()) {
+        uint32_t length = readBigEndian(&file[pos]);
+        const uint8_t* type = &file[pos + 4];
+        const uint8_t* data = &file[pos + 8];
+        if (pos + 12 + (size_t)length > file.size()) {
+            error = "truncated chunk";
+            return false;
+        }
+
+        // IHDR comes first and holds 13 bytes; PLTE and tRNS are read against its colour type
+        const bool isHeader = std::memcmp(type, "IHDR", 4) == 0;
+        if ((isHeader && length < 13) || (!isHeader && colorType < 0)) {
+            error = "missing or invalid IHDR";
+            return false;
+        }
+
+        if (isHeader) {
+            w = readBigEndian(data);
+            h = readBigEndian(data + 4);
+            int bitDepth = data[8];
+            colorType = data[9];
+            int interlace = data[12];
+            if (bitDepth != 8 || interlace != 0 || (colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6)) {
+                error = "unsupported PNG (needs 8 bits per channel, no interlacing)";
+                return false;
+            }
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(256 * 4, 255);
+            for (uint32_t i = 0; i < length / 3 && i < 256; i++) {
+                palette[i * 4 + 0] = data[i * 3 + 0];
+                palette[i * 4 + 1] = data[i * 3 + 1];
+                palette[i * 4 + 2] = data[i * 3 + 2];
+            }
+        } else if (std::memcmp(type, "tRNS", 4) == 0 && colorType == 3 && !palette.empty()) {
+            // Palette alpha; a colour key on grey/RGB images is ignored
+            for (uint32_t i = 0; i < length && i < 256; i++)
+                palette[i * 4 + 3] = data[i];
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), data, data + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        pos += 12 + length;
+    }
+
+    if (colorType < 0 || w == 0 || h == 0 || w > 16384 || h > 16384) {
+        error = "missing or invalid IHDR";
+        return false;
+    }
+    if (colorType == 3 && palette.empty()) {
+        error = "palette image without PLTE";
+        return false;
+    }
+
+    static const int channelsOf[7] = { 1, 0, 3, 1, 2, 0, 4 };
+    const int channels = channelsOf[colorType];
+    const size_t stride = (size_t)w * channels;
+
+    std::vector<uint8_t> raw;
+    if (!zlibInflate(compressed, raw, (stride + 1) * h) || raw.size() < (stride + 1) * h) {
+        error = "corrupt image data";
+        return false;
+    }
+
+    // Undo the per-row filters in place; the previous row is already unfiltered
+    for (uint32_t y = 0; y < h; y++) {
+        uint8_t filter = raw[y * (stride + 1)];
+        uint8_t* row = &raw[y * (stride + 1) + 1];
+        const uint8_t* previous = y > 0 ? &raw[(y - 1) * (stride + 1) + 1] : nullptr;
+        for (size_t x = 0; x < stride; x++) {
+            int left = x >= (size_t)channels ? row[x - channels] : 0;
+            int up = previous ? previous[x] : 0;
+            int upLeft = previous && x >= (size_t)channels ? previous[x - channels] : 0;
+            switch (filter) {
+            case 0: break;
+            case 1: row[x] = (uint8_t)(row[x] + left); break;
+            case 2: row[x] = (uint8_t)(row[x] + up); break;
+            case 3: row[x] = (uint8_t)(row[x] + ((left + up) >> 1)); break;
+            case 4: row[x] = (uint8_t)(row[x] + paeth(left, up, upLeft)); break;
+            default:
+                error = "bad row filter";
+                return false;
+            }
+        }
+    }
+
+    width = (int)w;
+    height = (int)h;
+    rgba.resize((size_t)w * h * 4);
+    for (uint32_t y = 0; y < h; y++) {
+        const uint8_t* row = &raw[y * (stride + 1) + 1];
+        uint8_t* dst = &rgba[(size_t)y * w * 4];
+        for (uint32_t x = 0; x < w; x++, dst += 4) {
+            const uint8_t* p = row + (size_t)x * channels;
+            switch (colorType) {
+            case 0: dst[0] = dst[1] = dst[2] = p[0]; dst[3] = 255; break;
+            case 2: dst[0] = p[0]; dst[1] = p[1]; dst[2] = p[2]; dst[3] = 255; break;
+            case 3: std::memcpy(dst, &palette[p[0] * 4], 4); break;
+            case 4: dst[0] = dst[1] = dst[2] = p[0]; dst[3] = p[1]; break;
+            case 6: std::memcpy(dst, p, 4); break;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reads a whole file; returns false if it can't be opened
+bool readFile(const std::string& path, std::vector<uint8_t>& bytes);
+
+// Decodes an 8-bit, non-interlaced PNG (grey, grey + alpha, RGB, RGBA or palette) to tightly
+// packed RGBA8, top row first. On failure returns false and describes why in error.
+//
+// Self-contained zlib inflate, so loading images needs no extra library. Only used off the
+// render thread or offline: the runtime normally reads the pre-baked texture cache instead.
+bool decodePng(const std::vector<uint8_t>& file, std::vector<uint8_t>& rgba, int& width, int& height, std::string& error);
@@ -0,0 +1,157 @@
+#include "input.h"
+
+#include <GLFW/glfw3.h>
+#include <cstring>
+#include <iostream>
+
+void InputSystem::install(GLFWwindow* window)
+{
+    std::memset(keyActions, -1, sizeof(keyActions));
+    std::memset(buttonActions, -1, sizeof(buttonActions));
+
+    // Ship: arrows move, space or the left button fires
+    bindKey(GLFW_KEY_UP, InputAction_Forward);
+    bindKey(GLFW_KEY_DOWN, InputAction_Back);
+    bindKey(GLFW_KEY_LEFT, InputAction_Left);
+    bindKey(GLFW_KEY_RIGHT, InputAction_Right);
+    bindKey(GLFW_KEY_SPACE, InputAction_Fire);
+    bindMouseButton(GLFW_MOUSE_BUTTON_LEFT, InputAction_Fire);
+
+    // Camera: C cycles modes; J/L yaw, I/K pitch, U/O zoom (orbit); W/S, A/D, R/F move (free);
+    // dragging with the right button looks around
+    bindKey(GLFW_KEY_C, InputAction_CameraMode);
+    bindKey(GLFW_KEY_J, InputAction_CameraYawLeft);
+    bindKey(GLFW_KEY_L, InputAction_CameraYawRight);
+    bindKey(GLFW_KEY_I, InputAction_CameraPitchUp);
+    bindKey(GLFW_KEY_K, InputAction_CameraPitchDown);
+    bindKey(GLFW_KEY_U, InputAction_CameraZoomIn);
+    bindKey(GLFW_KEY_O, InputAction_CameraZoomOut);
+    bindKey(GLFW_KEY_W, InputAction_CameraForward);
+    bindKey(GLFW_KEY_S, InputAction_CameraBack);
+    bindKey(GLFW_KEY_A, InputAction_CameraLeft);
+    bindKey(GLFW_KEY_D, InputAction_CameraRight);
+    bindKey(GLFW_KEY_R, InputAction_CameraUp);
+    bindKey(GLFW_KEY_F, InputAction_CameraDown);
+    bindMouseButton(GLFW_MOUSE_BUTTON_RIGHT, InputAction_Look);
+
+    bindKey(GLFW_KEY_ENTER, InputAction_Confirm);
+    bindKey(GLFW_KEY_ESCAPE, InputAction_Quit);
+    bindKey(GLFW_KEY_F3, InputAction_ToggleOverlay);
+    bindKey(GLFW_KEY_F9, InputAction_DumpAllocations);
+    bindKey(GLFW_KEY_F10, InputAction_DumpRenderGraph);
+
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetCursorPosCallback(window, cursorCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+}
+
+void InputSystem::bindKey(int key, InputAction action)
+{
+    if (key >= 0 && key < maxKeys)
+        keyActions[key] = (int8_t)action;
+}
+
+void InputSystem::bindMouseButton(int button, InputAction action)
+{
+    if (button >= 0 && button < maxButtons)
+        buttonActions[button] = (int8_t)action;
+}
+
+int InputSystem::actionFor(const InputEvent& event) const
+{
+    if (event.type == InputEvent_Key)
+        return event.code >= 0 && event.code < maxKeys ? keyActions[event.code] : -1;
+    return event.code >= 0 && event.code < maxButtons ? buttonActions[event.code] : -1;
+}
+
+void InputSystem::enqueue(InputEventType type, int code, bool pressed)
+{
+    InputEvent event = { glfwGetTime(), code, type, (uint8_t)pressed };
+    int action = actionFor(event);
+    if (action < 0)
+        return;
+
+    uint64_t bit = 1ull << action;
+    if (pressed)
+        live.down |= bit;
+    else
+        live.down &= ~bit;
+
+    if (!events.push(event))
+        dropped++;
+}
+
+void InputSystem::keyCallback(GLFWwindow* window, int key, int, int action, int)
+{
+    if (action == GLFW_REPEAT)
+        return;
+    static_cast<InputSystem*>(glfwGetWindowUserPointer(window))->enqueue(InputEvent_Key, key, action == GLFW_PRESS);
+}
+
+void InputSystem::mouseButtonCallback(GLFWwindow* window, int button, int action, int)
+{
+    static_cast<InputSystem*>(glfwGetWindowUserPointer(window))->enqueue(InputEvent_MouseButton, button, action == GLFW_PRESS);
+}
+
+void InputSystem::cursorCallback(GLFWwindow* window, double x, double y)
+{
+    InputSystem& input = *static_cast<InputSystem*>(glfwGetWindowUserPointer(window));
+    if (input.cursorKnown && input.live.held(InputAction_Look)) {
+        input.lookX += (float)(x - input.cursorX);
+        input.lookY += (float)(y - input.cursorY);
+    }
+    input.cursorX = x;
+    input.cursorY = y;
+    input.cursorKnown = true;
+}
+
+void InputSystem::scrollCallback(GLFWwindow* window, double, double dy)
+{
+    static_cast<InputSystem*>(glfwGetWindowUserPointer(window))->scroll += (float)dy;
+}
+
+InputState InputSystem::advance(double time)
+{
+    ticked.pressed = 0;
+    ticked.released = 0;
+    while (const InputEvent* event = events.peek()) {
+        if (event->time > time)
+            break;
+        uint64_t bit = 1ull << actionFor(*event);
+        if (event->pressed) {
+            ticked.down |= bit;
+            ticked.pressed |= bit;
+        } else {
+            ticked.down &= ~bit;
+            ticked.released |= bit;
+        }
+        events.pop();
+    }
+
+    if (recording)
+        recorded.push_back(ticked);
+    return ticked;
+}
+
+void InputSystem::takeLook(float& dx, float& dy)
+{
+    dx = lookX;
+    dy = lookY;
+    lookX = lookY = 0.0f;
+}
+
+float InputSystem::takeScroll()
+{
+    float notches = scroll;
+    scroll = 0.0f;
+    return notches;
+}
+
+void InputSystem::startRecording()
+{
+    recorded.clear();
+    recorded.reserve(120 * 60 * 10); // Ten minutes at 120 Hz before the first reallocation
+    recording = true;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct GLFWwindow;
+
+// What the game reacts to; keys and mouse buttons are bound to these
+enum InputAction
+{
+    InputAction_Forward,
+    InputAction_Back,
+    InputAction_Left,
+    InputAction_Right,
+    InputAction_Fire,
+    InputAction_CameraMode,
+    InputAction_CameraYawLeft,
+    InputAction_CameraYawRight,
+    InputAction_CameraPitchUp,
+    InputAction_CameraPitchDown,
+    InputAction_CameraZoomIn,
+    InputAction_CameraZoomOut,
+    InputAction_CameraForward,
+    InputAction_CameraBack,
+    InputAction_CameraLeft,
+    InputAction_CameraRight,
+    InputAction_CameraUp,
+    InputAction_CameraDown,
+    InputAction_Look,       // Held: cursor movement turns the camera
+    InputAction_Confirm,
+    InputAction_Quit,
+    InputAction_ToggleOverlay,
+    InputAction_DumpAllocations,
+    InputAction_DumpRenderGraph,
+    InputAction_Count
+};
+static_assert(InputAction_Count <= 64, "actions are stored as bits of a uint64_t");
+
+// Actions over one simulation tick, one bit per action. pressed/released keep every transition
+// seen in the tick, so a tap that starts and ends between two ticks still shows up.
+struct InputState
+{
+    uint64_t down = 0;     // Held at the end of the tick
+    uint64_t pressed = 0;  // Went down during the tick
+    uint64_t released = 0; // Went up during the tick
+
+    bool held(InputAction action) const { return (down >> action) & 1; }
+    bool wasPressed(InputAction action) const { return (pressed >> action) & 1; }
+    bool wasReleased(InputAction action) const { return (released >> action) & 1; }
+    // Held now or tapped during the tick
+    bool active(InputAction action) const { return ((down | pressed) >> action) & 1; }
+};
+
+enum InputEventType : uint8_t
+{
+    InputEvent_Key,
+    InputEvent_MouseButton
+};
+
+// A raw transition as GLFW reported it, stamped with glfwGetTime() on arrival
+struct InputEvent
+{
+    double time;
+    int32_t code;  // GLFW key or mouse button
+    InputEventType type;
+    uint8_t pressed;
+};
+
+// Bounded single-producer single-consumer ring. push and pop never block or allocate; push
+// fails when the consumer has fallen a whole ring behind.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    bool push(const T& item)
+    {
+        size_t tail = writeIndex.load(std::memory_order_relaxed);
+        if (tail - readIndex.load(std::memory_order_acquire) == Capacity)
+            return false;
+        items[tail & (Capacity - 1)] = item;
+        writeIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Oldest item without removing it
+    const T* peek() const
+    {
+        size_t head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire))
+            return nullptr;
+        return &items[head & (Capacity - 1)];
+    }
+
+    void pop() { readIndex.store(readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> readIndex{ 0 };
+    alignas(64) std::atomic<size_t> writeIndex{ 0 };
+};
+
+// GLFW-callback input. Key and mouse button callbacks timestamp every transition into a
+// lock-free queue; the fixed-step simulation drains it one tick at a time with advance(), so
+// each transition lands in the tick it happened in and short taps are not lost between polls.
+//
+// Render-rate consumers (the camera) read liveState() and the accumulated cursor/scroll deltas
+// instead, which are as fresh as the last glfwPollEvents().
+class InputSystem
+{
+public:
+    // Installs the callbacks and the default bindings; takes the window's user pointer
+    void install(GLFWwindow* window);
+
+    void bindKey(int key, InputAction action);
+    void bindMouseButton(int button, InputAction action);
+
+    // Applies every queued event stamped up to time (glfwGetTime seconds) and returns the
+    // tick's state. Later events stay queued for the next tick.
+    InputState advance(double time);
+
+    // Held actions as of the last poll, for per-frame rather than per-tick use
+    const InputState& liveState() const { return live; }
+
+    // Cursor movement while InputAction_Look is held, and scroll, since the last take (pixels, notches)
+    void takeLook(float& dx, float& dy);
+    float takeScroll();
+
+    // Keeps the state of every tick from now on; recorded ticks are what a replay feeds back,
+    // so recording starts with the simulation
+    void startRecording();
+    void stopRecording() { recording = false; }
+    bool isRecording() const { return recording; }
+    const std::vector<InputState>& recordedTicks() const { return recorded; }
+
+    size_t droppedEvents() const { return dropped; }
+
+private:
+    static const int maxKeys = 512;   // GLFW_KEY_LAST + 1, rounded up
+    static const int maxButtons = 8;
+
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+    static void cursorCallback(GLFWwindow* window, double x, double y);
+    static void scrollCallback(GLFWwindow* window, double dx, double dy);
+
+    void enqueue(InputEventType type, int code, bool pressed);
+    int actionFor(const InputEvent& event) const;
+
+    SpscQueue<InputEvent, 1024> events;
+    int8_t keyActions[maxKeys];
+    int8_t buttonActions[maxButtons];
+
+    InputState ticked; // Down bits carried from tick to tick
+    InputState live;
+    double cursorX = 0.0;
+    double cursorY = 0.0;
+    bool cursorKnown = false;
+    float lookX = 0.0f;
+    float lookY = 0.0f;
+    float scroll = 0.0f;
+    size_t dropped = 0;
+
+    bool recording = false;
+    std::vector<InputState> recorded;
+};
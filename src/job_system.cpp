@@ -0,0 +1,209 @@
+#include "job_system.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+static thread_local unsigned int currentThreadIndex = 0;
+
+bool JobDeque::push(Job* job)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= capacity)
+        return false; // Would overwrite a job that has not been taken yet
+    jobs[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* JobDeque::pop()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // Empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = jobs[b & (capacity - 1)].load(std::memory_order_relaxed);
+    if (t != b)
+        return job;
+
+    // Last job: race against stealers for it
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        job = nullptr;
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return job;
+}
+
+Job* JobDeque::steal()
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+        return nullptr;
+
+    Job* job = jobs[t & (capacity - 1)].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr; // Lost the race to pop() or another stealer
+    return job;
+}
+
+unsigned int JobSystem::threadIndex()
+{
+    return currentThreadIndex;
+}
+
+bool JobSystem::init(unsigned int workerCount)
+{
+    if (workerCount == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 0;
+    }
+
+    currentThreadIndex = 0;
+    queues.resize(workerCount + 1);
+    for (ThreadData*& data : queues) {
+        data = new ThreadData();
+        data->ring.reset(new Job[jobRingSize]()); // Zeroed, so every slot starts finished
+    }
+
+    running = true;
+    for (unsigned int i = 1; i <= workerCount; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+
+    std::cout << "Job system: " << workerCount << " worker threads" << std::endl;
+    return true;
+}
+
+void JobSystem::shutdown()
+{
+    running = false;
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    for (ThreadData* data : queues)
+        delete data;
+    queues.clear();
+}
+
+Job* JobSystem::createJob(JobFunction function, const void* data, size_t size)
+{
+    ThreadData& thread = *queues[currentThreadIndex];
+
+    // Skip slots whose job is still queued or running; with the whole ring in flight, run
+    // queued jobs until one of them finishes
+    Job* job = nullptr;
+    while (!job) {
+        for (unsigned int i = 0; i < jobRingSize && !job; i++) {
+            Job* slot = &thread.ring[thread.allocated++ & (jobRingSize - 1)];
+            if (slot->unfinishedJobs.load(std::memory_order_acquire) == 0)
+                job = slot;
+        }
+        if (!job) {
+            Job* next = getJob();
+            if (next)
+                execute(next);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    job->function = function;
+    job->parent = nullptr;
+    job->unfinishedJobs.store(1, std::memory_order_relaxed);
+    if (data && size > 0) {
+        if (size > sizeof(job->data)) {
+            std::cerr << "Job data of " << size << " bytes does not fit in a job" << std::endl;
+            size = sizeof(job->data);
+        }
+        std::memcpy(job->data, data, size);
+    }
+    return job;
+}
+
+Job* JobSystem::createChildJob(Job* parent, JobFunction function, const void* data, size_t size)
+{
+    // The parent can't finish until this child has
+    parent->unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+
+    Job* job = createJob(function, data, size);
+    job->parent = parent;
+    return job;
+}
+
+void JobSystem::run(Job* job)
+{
+    if (!queues[currentThreadIndex]->queue.push(job))
+        execute(job);
+}
+
+void JobSystem::wait(const Job* job)
+{
+    // Help out instead of blocking, so the main thread counts as a worker
+    while (job->unfinishedJobs.load(std::memory_order_acquire) > 0) {
+        Job* next = getJob();
+        if (next)
+            execute(next);
+        else
+            std::this_thread::yield();
+    }
+}
+
+Job* JobSystem::getJob()
+{
+    Job* job = queues[currentThreadIndex]->queue.pop();
+    if (job)
+        return job;
+
+    // Own deque is empty: try to steal, starting from a different victim per thread
+    const unsigned int count = (unsigned int)queues.size();
+    for (unsigned int i = 1; i < count; i++) {
+        unsigned int victim = (currentThreadIndex + i) % count;
+        job = queues[victim]->queue.steal();
+        if (job)
+            return job;
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job* job)
+{
+    job->function(job, job->data);
+    finish(job);
+}
+
+void JobSystem::finish(Job* job)
+{
+    int32_t unfinished = job->unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    if (unfinished == 0 && job->parent)
+        finish(job->parent);
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    currentThreadIndex = index;
+
+    unsigned int idleSpins = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        Job* job = getJob();
+        if (job) {
+            execute(job);
+            idleSpins = 0;
+        } else if (++idleSpins < 64) {
+            std::this_thread::yield();
+        } else {
+            // Nothing to do for a while (menus, vsync wait): stop burning a core
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
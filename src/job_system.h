@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct Job;
+typedef void (*JobFunction)(Job* job, const void* data);
+
+// A unit of work. Jobs live in per-thread ring buffers and are never freed; a slot is reused
+// once its job has finished, and a thread with the whole ring in flight helps run queued jobs
+// until one does. A job is finished when it and all of its children have run.
+struct alignas(64) Job
+{
+    JobFunction function;
+    Job* parent;
+    std::atomic<int32_t> unfinishedJobs;
+    unsigned char data[64 - sizeof(JobFunction) - sizeof(Job*) - sizeof(std::atomic<int32_t>)];
+};
+
+// Fixed-capacity Chase-Lev deque. The owning thread pushes and pops at the bottom (LIFO,
+// cache warm); other threads steal from the top (FIFO, oldest and usually largest work).
+class JobDeque
+{
+public:
+    static const int64_t capacity = 4096;
+
+    // False when the deque is full; the job is not queued then
+    bool push(Job* job);
+    Job* pop();
+    Job* steal();
+
+private:
+    std::atomic<int64_t> top{ 0 };
+    std::atomic<int64_t> bottom{ 0 };
+    std::atomic<Job*> jobs[capacity];
+};
+
+// Work-stealing job system: one deque per thread, the main thread being thread 0.
+// run() pushes onto the calling thread's deque; idle threads steal from the others.
+// Jobs must only be created and run from the main thread or from inside other jobs.
+class JobSystem
+{
+public:
+    static const unsigned int jobRingSize = 4096;
+
+    // workerCount == 0 picks hardware_concurrency - 1 (the main thread also works)
+    bool init(unsigned int workerCount = 0);
+    void shutdown();
+
+    Job* createJob(JobFunction function, const void* data = nullptr, size_t size = 0);
+    Job* createChildJob(Job* parent, JobFunction function, const void* data = nullptr, size_t size = 0);
+    // Queues the job, or runs it right away when the thread's deque is full
+    void run(Job* job);
+
+    // Executes other jobs until job (and its children) have finished
+    void wait(const Job* job);
+
+    // Calls func(begin, end) over [0, count) split into chunks of at most splitSize,
+    // spread across all threads. Returns once every chunk has run.
+    template <typename Func>
+    void parallelFor(uint32_t count, uint32_t splitSize, const Func& func);
+
+    // Workers + the main thread; use it to size per-thread data such as render buckets
+    unsigned int threadCount() const { return (unsigned int)queues.size(); }
+
+    // Index of the calling thread in [0, threadCount()), 0 being the main thread
+    static unsigned int threadIndex();
+
+private:
+    template <typename Func>
+    struct ParallelForData
+    {
+        JobSystem* system;
+        const Func* func;
+        uint32_t begin;
+        uint32_t count;
+        uint32_t splitSize;
+    };
+
+    template <typename Func>
+    static void parallelForJob(Job* job, const void* data);
+
+    void workerLoop(unsigned int index);
+    Job* getJob();
+    void execute(Job* job);
+    void finish(Job* job);
+
+    struct ThreadData
+    {
+        JobDeque queue;
+        std::unique_ptr<Job[]> ring;
+        uint32_t allocated = 0;
+    };
+
+    std::vector<ThreadData*> queues;
+    std::vector<std::thread> workers;
+    std::atomic<bool> running{ false };
+};
+
+template <typename Func>
+void JobSystem::parallelForJob(Job* job, const void* data)
+{
+    const ParallelForData<Func>& range = *static_cast<const ParallelForData<Func>*>(data);
+
+    if (range.count > range.splitSize) {
+        // Split in halves as children so idle threads can steal the other half
+        uint32_t leftCount = range.count / 2;
+        ParallelForData<Func> left = { range.system, range.func, range.begin, leftCount, range.splitSize };
+        ParallelForData<Func> right = { range.system, range.func, range.begin + leftCount, range.count - leftCount, range.splitSize };
+
+        JobSystem& system = *range.system;
+        system.run(system.createChildJob(job, &parallelForJob<Func>, &left, sizeof(left)));
+        system.run(system.createChildJob(job, &parallelForJob<Func>, &right, sizeof(right)));
+    } else {
+        (*range.func)(range.begin, range.begin + range.count);
+    }
+}
+
+template <typename Func>
+void JobSystem::parallelFor(uint32_t count, uint32_t splitSize, const Func& func)
+{
+    if (count == 0)
+        return;
+    if (splitSize == 0)
+        splitSize = 1;
+
+    static_assert(sizeof(ParallelForData<Func>) <= sizeof(Job::data), "parallel for data does not fit in a job");
+    ParallelForData<Func> data = { this, &func, 0, count, splitSize };
+    Job* root = createJob(&parallelForJob<Func>, &data, sizeof(data));
+    run(root);
+    wait(root);
+}
@@ -5,7 +5,10 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cmath> // For sin and cos functions
+#include <cstring>
+#include <cstdlib>
 
 // GLM for matrix operations
 #include <glm/glm.hpp>
@@ -15,9 +18,40 @@
 // Allows text to be printed from text file
 #include <fstream>
 #include <sstream>
-#include <ft2build.h>
-#include FT_FREETYPE_H
-#include <map>
+
+#include "shader.h"
+#include "render_queue.h"
+#include "job_system.h"
+#include "ships.h"
+#include "frustum.h"
+#include "mesh_pool.h"
+#include "gpu_culling.h"
+#include "collision.h"
+#include "projectiles.h"
+#include "particles.h"
+#include "starfield.h"
+#include "asteroids.h"
+#include "camera.h"
+#include "depth.h"
+#include "render_target.h"
+#include "shadows.h"
+#include "textures.h"
+#include "texture_arrays.h"
+#include "gpu_resources.h"
+#include "frame_arena.h"
+#include "allocation_tracker.h"
+#include "text.h"
+#include "profiler_overlay.h"
+#include "input.h"
+#include "replay.h"
+#include "frame_pacing.h"
+#include "gpu_timer.h"
+#include "dynamic_resolution.h"
+#include "render_target_pool.h"
+#include "post_process.h"
+#include "render_graph.h"
+
+#include <filesystem>
 
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
@@ -27,19 +61,31 @@ const char* vertexShaderSource = R"glsl(
     #version 330 core
     layout(location = 0) in vec3 aPos;
     layout(location = 1) in vec3 aNormal;
+    layout(location = 2) in mat4 instanceModel; // Per-instance, from the mesh pool
+    layout(location = 6) in vec2 aTexCoord;
+    layout(location = 7) in uint aTextureLayer; // Per instance
 
-    uniform mat4 model;
     uniform mat4 view;
     uniform mat4 projection;
 
     out vec3 FragPos;  
     out vec3 Normal;  
+    out float ViewDepth; // Picks the shadow cascade
+    out vec2 TexCoord;
+    flat out uint TextureLayer;
 
-    void main() {
-        FragPos = vec3(model * vec4(aPos, 1.0));  
-        Normal = mat3(transpose(inverse(model))) * aNormal;  
+    // Must match the depth pre-pass shader exactly for GL_EQUAL to pass
+    invariant gl_Position;
 
-        gl_Position = projection * view * vec4(FragPos, 1.0);
+    void main() {
+        vec4 worldPos = instanceModel * vec4(aPos, 1.0);
+        FragPos = vec3(worldPos);  
+        Normal = mat3(transpose(inverse(instanceModel))) * aNormal;  
+        ViewDepth = -(view * worldPos).z;
+        TexCoord = aTexCoord;
+        TextureLayer = aTextureLayer;
+
+        gl_Position = projection * view * worldPos;
     }
 )glsl";
 
@@ -50,12 +96,49 @@ const char* fragmentShaderSource = R"glsl(
 
     in vec3 FragPos;  
     in vec3 Normal;  
+    in float ViewDepth;
+    in vec2 TexCoord;
+    flat in uint TextureLayer;
 
     // Light and material properties
-    uniform vec3 lightPos; 
+    uniform vec3 sunDirection; // Towards the sun
     uniform vec3 viewPos; 
     uniform vec3 lightColor;
     uniform vec3 objectColor;
+    uniform bool useTexture;
+    uniform sampler2DArray diffuseTexture; // Unit 0, bound per material; layer per instance
+
+    // Cascaded shadow maps of the sun
+    uniform bool shadowsEnabled;
+    uniform sampler2DArrayShadow shadowMap;
+    uniform mat4 cascadeMatrices[4];
+    uniform vec4 cascadeSplits; // Far view distance of each cascade, 0 when unused
+
+    float sunVisibility(vec3 norm) {
+        if (!shadowsEnabled)
+            return 1.0;
+
+        int cascade = 0;
+        while (cascade < 4 && cascadeSplits[cascade] > 0.0 && ViewDepth > cascadeSplits[cascade])
+            cascade++;
+        if (cascade == 4 || cascadeSplits[cascade] <= 0.0)
+            return 1.0;
+
+        // Push the lookup off the surface along the normal; coarser cascades need more
+        vec3 offsetPos = FragPos + norm * 0.03 * float(cascade + 1);
+        vec3 coord = (cascadeMatrices[cascade] * vec4(offsetPos, 1.0)).xyz;
+        if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0))))
+            return 1.0;
+
+        // Four hardware-filtered taps: a 4x4 texel PCF footprint
+        vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+        float lit = 0.0;
+        lit += texture(shadowMap, vec4(coord.xy + vec2(-0.5, -0.5) * texel, float(cascade), coord.z));
+        lit += texture(shadowMap, vec4(coord.xy + vec2( 0.5, -0.5) * texel, float(cascade), coord.z));
+        lit += texture(shadowMap, vec4(coord.xy + vec2(-0.5,  0.5) * texel, float(cascade), coord.z));
+        lit += texture(shadowMap, vec4(coord.xy + vec2( 0.5,  0.5) * texel, float(cascade), coord.z));
+        return lit * 0.25;
+    }
 
     void main() {
         // Ambient
@@ -64,7 +147,7 @@ const char* fragmentShaderSource = R"glsl(
       	
         // Diffuse 
         vec3 norm = normalize(Normal);
-        vec3 lightDir = normalize(lightPos - FragPos);  
+        vec3 lightDir = normalize(sunDirection);  
         float diff = max(dot(norm, lightDir), 0.0);
         vec3 diffuse = diff * lightColor;
         
@@ -75,7 +158,11 @@ const char* fragmentShaderSource = R"glsl(
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
         vec3 specular = specularStrength * spec * lightColor;  
             
-        vec3 result = (ambient + diffuse + specular) * objectColor;
+        float visibility = sunVisibility(norm);
+        vec3 albedo = objectColor;
+        if (useTexture)
+            albedo *= texture(diffuseTexture, vec3(TexCoord, float(TextureLayer))).rgb;
+        vec3 result = (ambient + visibility * (diffuse + specular)) * albedo;
         FragColor = vec4(result, 1.0);
     }
 )glsl";
@@ -112,23 +199,88 @@ const char* axesFragmentShaderSource = R"glsl(
 glm::vec3 modelPosition = glm::vec3(0.0f, 0.0f, 0.0f);
 float rotationY = 0.0f; // Yaw rotation
 const float rotationSpeed = 0.01f;
-const float movementSpeed = 0.05f;
+const float movementSpeed = 3.0f; // Units per second
 
-// Function prototypes
-void processInput(GLFWwindow* window);
-void checkGLError(const std::string& errorMessage);
+// Lay down depth first and shade with GL_EQUAL, so overlapping ships are lit once per pixel
+bool useDepthPrepass = true;
 
-// Define the Character structure for text display
-struct Character 
-{
-    GLuint TextureID;   // ID of the glyph
-    glm::ivec2 Size;    // Size 
-    glm::ivec2 Bearing; // Offset from baseline 
-    GLuint Advance;     // Offset to advance to next char (glyph)
-};
+// NPC ships flying around the player
+const unsigned int fleetSize = 200;
+
+// Seeds the fleet and the asteroid field are generated from; a replay brings its own
+uint32_t fleetSeed = 1234;
+uint32_t asteroidSeed = 4321;
+
+// Submit all ship meshes with one glMultiDrawElementsIndirect when GL 4.3 is available
+bool useMultiDrawIndirect = true;
+
+// Cull ships in a compute pass (frustum + last frame's Hi-Z) when compute shaders are available
+bool useGpuCulling = true;
+
+// Reversed-Z into a 32-bit float depth buffer with an infinite far plane, when glClipControl exists
+bool useReversedZ = true;
+
+// Direction towards the sun, the only light; its shadows come from cascaded shadow maps
+const glm::vec3 sunDirection = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+
+// Print the GPU memory report every minute, to watch VRAM over long sessions; the F3 overlay
+// shows the total either way
+bool debugGpuMemory = false;
+const double gpuMemoryReportInterval = 60.0;
+
+// Per-frame scratch memory (double-buffered); grows to the peak if a frame overflows it
+const size_t frameArenaSize = 1 << 20;
+
+// Print frame arena peaks and heap allocations per frame every few seconds; steady-state
+// gameplay should show zero
+bool debugFrameMemory = false;
+const double frameMemoryReportInterval = 5.0;
+
+// Adaptive vsync tears a late frame instead of waiting a whole refresh; a frame rate limit above
+// zero paces frames with sleep + spin, e.g. with the swap interval off (--swap, --fps override)
+SwapMode swapMode = SwapMode_Adaptive;
+double frameRateLimit = 0.0;
 
-// Declare the Characters map globally
-std::map<GLchar, Character> Characters;
+// The scene renders offscreen at a scale picked from measured GPU frame time, between the
+// minimum and full window resolution, and is upscaled to the window
+bool useDynamicResolution = true;
+const double gpuFrameBudget = 0.014; // Seconds, leaves headroom under a 60 Hz refresh
+const float minResolutionScale = 0.5f;
+
+// The scene is lit in HDR and finished by bloom, tonemapping and FXAA; off, it is blitted as is
+bool usePostProcessing = true;
+
+// Engine exhaust and hit sparks are brighter than white so the bloom makes them glow
+const float glowIntensity = 4.0f;
+
+// Frame time percentiles are taken over windows of a few seconds (shown by F3); print them too
+bool debugFramePacing = false;
+const double framePacingReportInterval = 5.0;
+
+// Weapons: the player fires with space, NPCs fire at the player every few seconds
+const float projectileSpeed = 40.0f;
+const float projectileLifetime = 3.0f;
+const float playerFireInterval = 0.05f;
+const float npcFireInterval = 3.0f;
+
+// Gameplay runs in fixed ticks fed by timestamped input; a slow frame catches up with at most
+// maxSimulationTicks ticks and drops the rest rather than spiralling
+const double simulationStep = 1.0 / 120.0;
+const int maxSimulationTicks = 8;
+
+// Camera turn per pixel of cursor movement while the right button is held, and zoom per scroll notch
+const float mouseLookSensitivity = 0.004f;
+const float scrollZoomStep = 2.0f;
+
+// Window framebuffer size, kept current by the resize callback
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+bool framebufferResized = false;
+
+// Function prototypes
+bool loadShipMesh(const char* path, std::vector<float>& vertices, std::vector<unsigned int>& indices);
+CameraInput readCameraInput(InputSystem& input, float dt);
+void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 
 enum GameState 
 {
@@ -140,8 +292,79 @@ enum GameState
 
 GameState gameState = Start_Screen;
 
-int main() 
+int main(int argc, char** argv) 
 {
+    // --record writes the session's input to a replay log on exit; --replay plays one back,
+    // with --headless as fast as possible in a hidden window without rendering
+    std::string recordPath;
+    std::string replayPath;
+    bool headless = false;
+
+    // Replay and frame pacing options, then the offline modes that run and exit
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (std::string(argv[i]) == "--headless")
+            headless = true;
+        else if (std::string(argv[i]) == "--fps" && i + 1 < argc)
+            frameRateLimit = std::atof(argv[++i]);
+        else if (std::string(argv[i]) == "--swap" && i + 1 < argc) {
+            std::string name = argv[++i];
+            int found = -1;
+            for (int mode = 0; mode < SwapMode_Count; mode++) {
+                if (name == swapModeName((SwapMode)mode))
+                    found = mode;
+            }
+            if (found < 0) {
+                std::cerr << "Unknown swap mode " << name << "; expected one of:";
+                for (int mode = 0; mode < SwapMode_Count; mode++)
+                    std::cerr << " " << swapModeName((SwapMode)mode);
+                std::cerr << std::endl;
+                return -1;
+            }
+            swapMode = (SwapMode)found;
+        }
+        if (std::string(argv[i]) == "--bench-spatial") {
+            runSpatialBenchmark();
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bench-collision") {
+            runCollisionBenchmark();
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bake-textures") {
+            // Compress every image next to the models into its texture cache
+            std::vector<std::string> paths;
+            for (const auto& file : std::filesystem::directory_iterator("./BlenderObjects")) {
+                if (file.path().extension() == ".png")
+                    paths.push_back(file.path().string());
+            }
+            JobSystem bakeJobs;
+            bakeJobs.init();
+            std::cout << "Baking " << paths.size() << " textures" << std::endl;
+            int failures = bakeTextures(paths, bakeJobs);
+            bakeJobs.shutdown();
+            return failures == 0 ? 0 : -1;
+        }
+    }
+
+    // A replay rebuilds the recorded world and must step it the same way
+    ReplayLog replay;
+    const bool replaying = !replayPath.empty();
+    if (replaying) {
+        if (!readReplay(replayPath, replay))
+            return -1;
+        if (replay.step != simulationStep) {
+            std::cerr << "Replay " << replayPath << " was recorded with a different simulation step" << std::endl;
+            return -1;
+        }
+        fleetSeed = replay.fleetSeed;
+        asteroidSeed = replay.asteroidSeed;
+    }
+    headless = headless && replaying;
+
     // Initialize GLFW
     if (!glfwInit()) 
     {
@@ -153,6 +376,8 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // The systems still need a GL context
 
     // Create window
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "3D Model Loader with Axes Visualization", NULL, NULL);
@@ -165,6 +390,16 @@ int main()
     // Set current context
     glfwMakeContextCurrent(window);
 
+    // Keys and buttons arrive through callbacks as timestamped events
+    InputSystem input;
+    input.install(window);
+
+    swapMode = applySwapMode(headless ? SwapMode_Off : swapMode);
+
+    // Render targets are reallocated at the start of the frame after a resize
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+
     // Initialize GLEW
     glewExperimental = GL_TRUE; // Needed for core profile
     if (glewInit() != GLEW_OK) {
@@ -173,136 +408,56 @@ int main()
     }
 
     checkGLError("GLEW initialization error");
+
+    // GL objects owned by main live in the registry; so do render targets and texture arrays
+    GpuResources gpuResources;
     // Set up rendering
     //---------------------------------------------------------------------------------------------------------------------------------------------------------------
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
 
-    // Build and compile shaders for the model
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    checkGLError("Vertex shader compilation error");
-
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    checkGLError("Fragment shader compilation error");
-
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    checkGLError("Shader program linking error");
+    // Reversed-Z: [0, 1] clip depth, near maps to 1 and infinity to 0, cleared to 0, GL_GREATER
+    bool reversedZ = useReversedZ && reversedZSupported();
+    if (reversedZ) {
+        glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glClearDepth(depthFar(true));
+        glDepthFunc(depthLess(true));
+    }
+    std::cout << "Depth: " << (reversedZ ? "reversed-Z, 32-bit float, infinite far plane" : "standard, 24-bit fixed point") << std::endl;
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Build and compile shaders for the model
+    unsigned int shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource, "Model");
 
     // Build and compile shaders for the axes
-    unsigned int axesVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(axesVertexShader, 1, &axesVertexShaderSource, NULL);
-    glCompileShader(axesVertexShader);
-    checkGLError("Axes vertex shader compilation error");
-
-    unsigned int axesFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(axesFragmentShader, 1, &axesFragmentShaderSource, NULL);
-    glCompileShader(axesFragmentShader);
-    checkGLError("Axes fragment shader compilation error");
-
-    unsigned int axesShaderProgram = glCreateProgram();
-    glAttachShader(axesShaderProgram, axesVertexShader);
-    glAttachShader(axesShaderProgram, axesFragmentShader);
-    glLinkProgram(axesShaderProgram);
-    checkGLError("Axes shader program linking error");
-
-    glDeleteShader(axesVertexShader);
-    glDeleteShader(axesFragmentShader);
-
-    // Load .obj file
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    std::string inputfile = "./BlenderObjects/Spaceship2.obj";
-    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, inputfile.c_str());
-
-    if (!warn.empty()) {
-        std::cout << "WARN: " << warn << std::endl;
-    }
-
-    if (!err.empty()) {
-        std::cerr << "ERR: " << err << std::endl;
-    }
+    unsigned int axesShaderProgram = createShaderProgram(axesVertexShaderSource, axesFragmentShaderSource, "Axes");
 
-    if (!ret) {
-        std::cerr << "Failed to load .obj file!" << std::endl;
+    if (!shaderProgram || !axesShaderProgram) {
         return -1;
     }
+    ProgramHandle modelProgramHandle = gpuResources.adopt<GpuResource_Program>(shaderProgram, GpuMemory_Other, "Model program");
+    ProgramHandle axesProgramHandle = gpuResources.adopt<GpuResource_Program>(axesShaderProgram, GpuMemory_Other, "Axes program");
 
-    // Prepare vertex data for the model
+    // Load the ship; the parser's data is freed on return, the mesh copies once uploaded
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
-    for (size_t s = 0; s < shapes.size(); s++) {
-        size_t index_offset = 0;
-        for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-            int fv = shapes[s].mesh.num_face_vertices[f];
-
-            // Process per-face
-            for (size_t v = 0; v < fv; v++) {
-                // Access vertex data
-                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-                tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
-                tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
-                tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
-
-                tinyobj::real_t nx = 0;
-                tinyobj::real_t ny = 0;
-                tinyobj::real_t nz = 0;
-                if (idx.normal_index >= 0) {
-                    nx = attrib.normals[3 * idx.normal_index + 0];
-                    ny = attrib.normals[3 * idx.normal_index + 1];
-                    nz = attrib.normals[3 * idx.normal_index + 2];
-                }
-
-                // Append vertex data
-                vertices.push_back(vx);
-                vertices.push_back(vy);
-                vertices.push_back(vz);
-                vertices.push_back(nx);
-                vertices.push_back(ny);
-                vertices.push_back(nz);
-
-                indices.push_back(indices.size());
-            }
-            index_offset += fv;
-        }
-    }
-
-    // Setup buffers and arrays for the model
-    unsigned int VBO, VAO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    // Bind buffers for the model
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-    // Vertex positions
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Vertex normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    if (!loadShipMesh("./BlenderObjects/Spaceship2.obj", vertices, indices))
+        return -1;
 
-    checkGLError("Vertex attribute setup error");
+    // All meshes share one vertex/index buffer so ships can be drawn in a single indirect call
+    MeshPool meshPool;
+    meshPool.setResources(&gpuResources);
+    meshPool.init(fleetSize + 1);
+    meshPool.multiDrawIndirectEnabled = useMultiDrawIndirect;
+    uint16_t shipMesh = meshPool.addMesh(vertices, indices);
+    meshPool.upload();
+
+    // GPU culling writes visible instances straight into the pool's indirect draws
+    GpuCuller gpuCuller;
+    gpuCuller.setResources(&gpuResources);
+    gpuCuller.init();
+    gpuCuller.enabled = useGpuCulling;
+    gpuCuller.reversedZ = reversedZ;
+    meshPool.setGpuCuller(&gpuCuller);
 
     // Prepare vertex data for the axes
     float axesVertices[] = {
@@ -321,15 +476,13 @@ int main()
     };
 
     // Generate buffers and arrays for the axes
-    unsigned int axesVAO, axesVBO;
-    glGenVertexArrays(1, &axesVAO);
-    glGenBuffers(1, &axesVBO);
+    VertexArrayHandle axesVAOHandle = gpuResources.createVertexArray("Axes VAO");
+    BufferHandle axesVBOHandle = gpuResources.createBuffer(GpuMemory_Geometry, "Axes VBO");
+    unsigned int axesVAO = gpuResources.get(axesVAOHandle);
 
     // Bind and set up axes VAO and VBO
     glBindVertexArray(axesVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, axesVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(axesVertices), axesVertices, GL_STATIC_DRAW);
+    gpuResources.bufferData(axesVBOHandle, GL_ARRAY_BUFFER, sizeof(axesVertices), axesVertices, GL_STATIC_DRAW);
 
     // Position attribute
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
@@ -342,90 +495,291 @@ int main()
     checkGLError("Axes attribute setup error");
 
     // Get uniform locations for the model shader
-    unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
     unsigned int viewLoc  = glGetUniformLocation(shaderProgram, "view");
     unsigned int projLoc  = glGetUniformLocation(shaderProgram, "projection");
-    //---------------------------------------------------------------------------------------------------------------------------------------------------------------
 
-    //---------------------------------------------------- Freetype setup ------------------------------------------------------------------------------------
-    // // Initialize FreeType
-    FT_Library ft;
-    if (FT_Init_FreeType(&ft)) {
-        std::cerr << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+    // Simulation, culling and command generation run on worker threads; GL stays on this one
+    JobSystem jobs;
+    jobs.init();
+
+    // Ship texture: from its compressed cache when baked, otherwise decoded on the workers.
+    // Liveries are tinted copies packed into the same array, so the fleet stays one batch.
+    TextureLoader textures;
+    TextureArrays textureArrays;
+    textureArrays.setResources(&gpuResources);
+    textures.setTextureArrays(&textureArrays);
+    textures.setResources(&gpuResources);
+    uint32_t shipTexture = textures.request("./BlenderObjects/Spaceship.png");
+    textures.loadPending(jobs);
+
+    std::vector<uint16_t> shipLiveryLayers;
+    unsigned int shipLiveries = 0;
+    uint32_t shipBaseLivery = textures.arrayHandle(shipTexture);
+    if (shipBaseLivery != UINT32_MAX) {
+        const glm::vec3 liveryTints[] = { glm::vec3(1.0f, 0.55f, 0.5f), glm::vec3(0.55f, 0.7f, 1.0f), glm::vec3(0.6f, 1.0f, 0.6f) };
+        std::vector<uint32_t> liveries = { shipBaseLivery };
+        for (const glm::vec3& tint : liveryTints)
+            liveries.push_back(textureArrays.addTinted(shipBaseLivery, tint));
+        textureArrays.build();
+
+        shipLiveries = textureArrays.slot(shipBaseLivery).texture;
+        for (uint32_t livery : liveries)
+            if (textureArrays.slot(livery).texture == shipLiveries)
+                shipLiveryLayers.push_back(textureArrays.slot(livery).layer);
+    }
+    if (shipLiveryLayers.empty())
+        shipLiveryLayers.push_back(0);
+
+    // Ship world: the player plus the NPC fleet
+    ShipWorld ships;
+    ConvexHull shipHull = buildConvexHull(vertices.data(), vertices.size() / meshVertexFloats, meshVertexFloats);
+    ships.hull = &shipHull;
+    for (size_t i = 0; i < vertices.size(); i += meshVertexFloats) {
+        float radius = glm::length(glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]));
+        ships.boundingRadius = std::max(ships.boundingRadius, radius);
     }
 
-    // Load font as face
-    FT_Face face;
-    if (FT_New_Face(ft, "c:/WINDOWS/Fonts/Consola.ttf", 0, &face)) {
-        std::cerr << "ERROR::FREETYPE: Failed to load font" << std::endl;
-
+    // The pool and the hull have what they need; drop the CPU copies of the ship mesh
+    std::vector<float>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+    spawnFleet(ships, fleetSize, fleetSeed);
+    CollisionWorld collisions;
+
+    // Asteroid chunks stream in around the player; mesh variants go into the shared pool
+    AsteroidField asteroids;
+    asteroids.init(asteroidSeed, meshPool, jobs);
+
+    // Shots of every ship share one pool and one instanced draw
+    ProjectileSystem projectiles;
+    projectiles.init(16384);
+    float playerFireCooldown = 0.0f;
+
+    // Procedural star background, a single full-screen triangle
+    Starfield starfield;
+    starfield.init();
+    starfield.reversedZ = reversedZ;
+
+    // Sun shadows; casters are gathered from the ships and asteroids every frame
+    CascadedShadowMap shadows;
+    shadows.setResources(&gpuResources);
+    shadows.init();
+    shadows.reversedZ = reversedZ;
+
+    // Engine trails behind every ship and sparks where shots hit; simulated on the GPU
+    ParticleSystem particles;
+    particles.setResources(&gpuResources);
+    particles.init(1 << 18);
+    for (uint32_t i = 0; i < ships.size(); i++) {
+        ParticleEmitter engine = {};
+        engine.attachment = i;
+        engine.localOffset = glm::vec3(ships.boundingRadius * 0.8f, 0.0f, 0.0f); // Ships fly towards -X
+        engine.localVelocity = glm::vec3(3.0f, 0.0f, 0.0f);
+        engine.spread = 0.4f;
+        engine.color = (i == 0 ? glm::vec3(0.3f, 0.6f, 1.0f) : glm::vec3(1.0f, 0.4f, 0.1f)) * glowIntensity;
+        engine.lifetime = 0.8f;
+        engine.size = 0.12f;
+        engine.rate = 80.0f;
+        particles.addEmitter(engine);
     }
-    // Set size to load glyphs as
-    FT_Set_Pixel_Sizes(face, 0, 48);
-
-    // Load first 128 characters of ASCII set
-    std::map<GLchar, Character> Characters;
-    for (GLubyte c = 0; c < 128; c++) {
-        // Load character glyph 
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-            std::cerr << "ERROR::FREETYPE: Failed to load Glyph" << std::endl;
-            continue;
+    double lastFrameTime = glfwGetTime();
+
+    // Chase camera by default (C cycles modes); the world is rebased when the player flies far out
+    Camera camera;
+    camera.reversedZ = reversedZ;
+    FloatingOrigin origin;
+
+    // Simulation clock: glfwGetTime() seconds simulated so far, and the tick count that drives the world
+    double simulatedUntil = 0.0;
+    uint64_t simulationTick = 0;
+
+    // Opaque draws are queued per thread, sorted by key and issued with an optional depth pre-pass
+    RenderQueue renderQueue;
+    renderQueue.init(jobs.threadCount());
+    renderQueue.depthPrepassEnabled = renderQueue.depthPrepassEnabled && useDepthPrepass;
+    renderQueue.reversedZ = reversedZ;
+
+    // Transient per-frame data (visible lists, shadow casters, text quads) is bump allocated here
+    FrameArena frameArena;
+    frameArena.init(frameArenaSize);
+    uint64_t frameAllocationsTotal = 0;
+    uint64_t frameAllocationsMax = 0;
+    uint32_t framesSinceMemoryReport = 0;
+    double nextFrameMemoryReport = frameMemoryReportInterval;
+    double nextGpuMemoryReport = gpuMemoryReportInterval;
+
+    // The window's depth buffer is fixed point, so reversed-Z renders the game offscreen; so do
+    // dynamic resolution, into the corner of a window-sized target, and the HDR post stack
+    const bool useSceneTarget = reversedZ || useDynamicResolution || usePostProcessing;
+    RenderTarget sceneTarget;
+    sceneTarget.setResources(&gpuResources);
+    if (usePostProcessing)
+        sceneTarget.colorFormat = GL_RGBA16F;
+    // Float depth only pays off with reversed-Z; the Hi-Z copy also expects this format
+    if (!reversedZ)
+        sceneTarget.depthFormat = GL_DEPTH_COMPONENT24;
+    bool sceneTargetReady = useSceneTarget && sceneTarget.resize(framebufferWidth, framebufferHeight);
+
+    // Bloom levels and the other intermediate buffers are pooled across frames
+    RenderTargetPool renderTargetPool;
+    renderTargetPool.setResources(&gpuResources);
+    PostProcess postProcess;
+    bool postProcessReady = usePostProcessing && postProcess.init();
+    // Rebuilt every frame; F10 writes the current one to render_graph.dot for GraphViz
+    RenderGraph renderGraph;
+    GpuTimer gpuFrameTimer;
+    gpuFrameTimer.init();
+    DynamicResolution dynamicResolution;
+    dynamicResolution.budget = gpuFrameBudget;
+    dynamicResolution.minScale = useDynamicResolution ? minResolutionScale : 1.0f;
+    renderQueue.setMeshPool(&meshPool);
+    uint16_t modelShaderId = renderQueue.registerShader(shaderProgram);
+    uint16_t axesShaderId  = renderQueue.registerShader(axesShaderProgram);
+    uint16_t shipMaterial  = renderQueue.registerMaterial(shipLiveries ? glm::vec3(1.0f) : glm::vec3(0.6f), shipLiveries);
+    uint16_t asteroidMaterial = renderQueue.registerMaterial(glm::vec3(0.45f, 0.4f, 0.35f));
+    //---------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+    //---------------------------------------------------- Text setup ------------------------------------------------------------------------------------
+    // Glyphs come from FreeType; the game runs without text if the font is missing
+    TextRenderer textRenderer;
+    textRenderer.init("c:/WINDOWS/Fonts/Consola.ttf", 48, gpuResources);
+
+    // F3 shows frame, heap and GPU memory stats; F9 writes the heap stats to allocations.json
+    ProfilerOverlay overlay;
+
+    // One simulation tick. Everything it touches is seeded or driven by the tick's input, so the
+    // same ticks from the same seeds give the same session; the checksum taken every
+    // ReplayLog::checksumInterval ticks is recorded with a session or compared against a replay's.
+    ReplayLog session;
+    session.fleetSeed = fleetSeed;
+    session.asteroidSeed = asteroidSeed;
+    session.step = simulationStep;
+    bool replayDiverged = false;
+    auto simulationChecksum = [&]() {
+        uint32_t hash = checksumBytes(&modelPosition, sizeof(modelPosition));
+        hash = checksumBytes(ships.worldCenters.data(), ships.size() * sizeof(glm::vec3), hash);
+        hash = checksumBytes(ships.fireCooldowns.data(), ships.size() * sizeof(float), hash);
+        uint64_t shots = projectiles.size();
+        return checksumBytes(&shots, sizeof(shots), hash);
+    };
+    auto simulateTick = [&](const InputState& tick) {
+        const float step = (float)simulationStep;
+        float simulationTime = (float)(simulationTick * simulationStep);
+
+        // Far from the origin: move everything back so coordinates stay small
+        glm::vec3 originShift;
+        if (origin.update(ships.worldCenters[0], originShift)) {
+            modelPosition -= worldToShipSpace(originShift);
+            rebaseShips(ships, originShift);
+            asteroids.rebase(originShift);
+            projectiles.rebase(originShift);
+            particles.rebase(originShift);
+            rebaseCamera(camera, originShift);
+            gpuCuller.invalidateDepth();
+            shadows.invalidate();
         }
-        // Generate texture
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        // Set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Now store character for later use
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            static_cast<GLuint>(face->glyph->advance.x)
-        };
-        Characters.insert(std::pair<GLchar, Character>(c, character));
+
+        // Forward/backward moves along the x axis, left/right along the z axis
+        if (tick.active(InputAction_Forward))
+            modelPosition.x -= movementSpeed * step;
+        if (tick.active(InputAction_Back))
+            modelPosition.x += movementSpeed * step;
+        if (tick.active(InputAction_Left))
+            modelPosition.z += movementSpeed * step;
+        if (tick.active(InputAction_Right))
+            modelPosition.z -= movementSpeed * step;
+
+        // Simulate ships and build their transforms across the job system
+        ships.positions[0] = modelPosition;
+        ships.yaws[0] = rotationY;
+        updateShips(ships, jobs, simulationTime);
+        asteroids.update(ships.worldCenters[0], simulationTime, jobs);
+
+        // Keep the player out of the other ships; the push shows up next tick
+        collisions.update(ships.bounds.data(), ships.shapes.data(), ships.size(), jobs);
+        modelPosition += playerContactOffset(collisions.contacts());
+
+        // Fire, then move every shot and sweep it against the ships
+        playerFireCooldown -= step;
+        if (tick.active(InputAction_Fire) && playerFireCooldown <= 0.0f) {
+            playerFireCooldown = playerFireInterval;
+            glm::vec3 forward = glm::normalize(glm::mat3(ships.transforms[0]) * glm::vec3(-1.0f, 0.0f, 0.0f));
+            projectiles.spawn(ships.worldCenters[0] + forward * ships.boundingRadius, forward * projectileSpeed, projectileLifetime, 0);
+        }
+        for (uint32_t i = 1; i < ships.size(); i++) {
+            ships.fireCooldowns[i] -= step;
+            if (ships.fireCooldowns[i] > 0.0f)
+                continue;
+            ships.fireCooldowns[i] += npcFireInterval;
+            glm::vec3 aim = ships.worldCenters[0] - ships.worldCenters[i];
+            if (glm::dot(aim, aim) < 1e-6f)
+                continue;
+            aim = glm::normalize(aim);
+            projectiles.spawn(ships.worldCenters[i] + aim * ships.boundingRadius, aim * projectileSpeed, projectileLifetime, i);
+        }
+        projectiles.update(step, ships, jobs);
+
+        for (const ProjectileHit& hit : projectiles.hits())
+            particles.emit(hit.point, glm::vec3(0.0f), 6.0f, glm::vec3(1.0f, 0.7f, 0.3f) * glowIntensity, 0.6f, 0.25f, 200);
+
+        simulationTick++;
+        if (simulationTick % ReplayLog::checksumInterval == 0) {
+            uint32_t checksum = simulationChecksum();
+            size_t index = simulationTick / ReplayLog::checksumInterval - 1;
+            if (input.isRecording())
+                session.checksums.push_back(checksum);
+            if (replaying && !replayDiverged && index < replay.checksums.size() && replay.checksums[index] != checksum) {
+                std::cerr << "Replay diverged between ticks " << simulationTick - ReplayLog::checksumInterval
+                          << " and " << simulationTick << std::endl;
+                replayDiverged = true;
+            }
+        }
+    };
+
+    // Headless replay: every tick back to back, no rendering, then straight to shutdown
+    if (headless) {
+        double start = glfwGetTime();
+        for (const InputState& tick : replay.ticks)
+            simulateTick(tick);
+        double seconds = glfwGetTime() - start;
+        std::cout << "Replayed " << replay.ticks.size() << " ticks (" << replay.ticks.size() * simulationStep << " s of play) in "
+                  << seconds << " s, " << (replay.ticks.empty() ? 0.0 : seconds * 1000.0 / replay.ticks.size()) << " ms per tick"
+                  << (replayDiverged ? ", diverged" : "") << std::endl;
+        glfwSetWindowShouldClose(window, true);
+    } else if (replaying) {
+        gameState = Game_Screen;
+        simulatedUntil = glfwGetTime();
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    // Destroy FreeType once we're finishe
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
-    
-    // Setup text specific VAO and VBO
-    unsigned int textVAO, textVBO;
-    glGenVertexArrays(1, &textVAO);
-    glGenBuffers(1, &textVBO);
-
-    glBindVertexArray(textVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-
-    // Setup vertex attributes for the text rendering (positions and texture coordinates)
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
 
+    // Frames start on the limiter's schedule; frame time is measured swap to swap
+    FrameLimiter frameLimiter;
+    frameLimiter.setTargetRate(frameRateLimit);
+    FrameTimeHistogram frameTimes;
+    FrameTimeStats frameTimeStats;
+    double lastSwapTime = glfwGetTime();
+    double nextFramePacingReport = lastSwapTime + framePacingReportInterval;
 
     //---------------------------------------------------------------------------------------------------------------------------------------------------------------
     // Main loop
     while (!glfwWindowShouldClose(window)) 
     {
+        frameLimiter.wait();
+
+        // Minimized: nothing to draw into, and the simulation pauses until the window is back
+        if (framebufferWidth == 0 || framebufferHeight == 0) {
+            glfwWaitEvents();
+            continue;
+        }
+        if (framebufferResized) {
+            framebufferResized = false;
+            sceneTargetReady = useSceneTarget && sceneTarget.resize(framebufferWidth, framebufferHeight);
+        }
+
+        frameArena.beginFrame();
+        uint64_t allocationsAtFrameStart = allocationCount();
+
         // Input
-        processInput(window);
+        if (input.liveState().held(InputAction_Quit))
+            glfwSetWindowShouldClose(window, true);
         //---------------------------------------------------------------------------------------------------------------------------------------------------------------
         // If statements dictate the current state of the game
         if(gameState == Start_Screen)
@@ -446,120 +800,334 @@ int main()
             if (scale <= minScale) growing = true;
             }
 
-            std::string text = "Raumschiff";
-            float x = (SCR_WIDTH - 25.0f * text.length()) / 2.0f; // Center X position
-            float y = (SCR_HEIGHT / 2.0f); // Center Y position
+            const char* text = "Raumschiff";
+            float x = (framebufferWidth - textRenderer.width(text, scale)) / 2.0f; // Center X position
+            float y = (framebufferHeight / 2.0f); // Center Y position
             glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f); // White color
+            textRenderer.draw(text, x, y, scale, color, framebufferWidth, framebufferHeight, frameArena.current());
 
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-            glBindVertexArray(textVAO);
-
-            for (std::string::const_iterator c = text.begin(); c != text.end(); c++) {
-                Character ch = Characters[*c];
-
-                float xpos = x + ch.Bearing.x * scale;
-                float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-                float w = ch.Size.x * scale;
-                float h = ch.Size.y * scale;
-
-                // Update VBO for each character
-                float vertices[6][4] = {
-                    { xpos,     ypos + h,   0.0f, 0.0f },
-                    { xpos,     ypos,       0.0f, 1.0f },
-                    { xpos + w, ypos,       1.0f, 1.0f },
+            // Enter starts the game; the simulation clock starts with it
+            if (input.advance(glfwGetTime()).wasPressed(InputAction_Confirm)) {
+            gameState = Game_Screen;
+            simulatedUntil = glfwGetTime();
+            if (!recordPath.empty())
+                input.startRecording();
+            }
+        }
+        //---------------------------------------------------------------------------------------------------------------------------------------------------------------
+        else if(gameState == Game_Screen)
+        {
+            // Render at the scale last frames' GPU time allows
+            double gpuFrameTime = 0.0;
+            if (gpuFrameTimer.read(gpuFrameTime))
+                dynamicResolution.update(gpuFrameTime);
+            int renderWidth = framebufferWidth;
+            int renderHeight = framebufferHeight;
+            bool offscreen = sceneTargetReady;
+            if (offscreen) {
+                dynamicResolution.renderSize(framebufferWidth, framebufferHeight, renderWidth, renderHeight);
+                sceneTarget.setViewport(renderWidth, renderHeight);
+                renderWidth = sceneTarget.viewportWidth();
+                renderHeight = sceneTarget.viewportHeight();
+            }
 
-                    { xpos,     ypos + h,   0.0f, 0.0f },
-                    { xpos + w, ypos,       1.0f, 1.0f },
-                    { xpos + w, ypos + h,   1.0f, 0.0f }
-                };
+            double frameTime = glfwGetTime();
+            float deltaTime = std::min((float)(frameTime - lastFrameTime), 0.1f); // No huge step after the menus
+            lastFrameTime = frameTime;
+
+            // Fixed-step simulation up to now. Each tick consumes the input events stamped inside
+            // it, so what the player did and when does not depend on the frame rate. A replay
+            // feeds the recorded ticks instead; live input still drives the camera and toggles.
+            simulatedUntil = std::max(simulatedUntil, frameTime - maxSimulationTicks * simulationStep);
+            uint64_t framePressed = 0;
+            while (simulatedUntil + simulationStep <= frameTime) {
+                InputState live = input.advance(simulatedUntil + simulationStep);
+                framePressed |= live.pressed;
+                if (replaying && simulationTick == replay.ticks.size()) {
+                    std::cout << "Replay finished after " << simulationTick << " ticks" << (replayDiverged ? ", diverged" : "") << std::endl;
+                    glfwSetWindowShouldClose(window, true);
+                    break;
+                }
+                simulateTick(replaying ? replay.ticks[simulationTick] : live);
+                simulatedUntil += simulationStep;
+            }
 
-                // Bind texture for current character
-                glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+            // Effects and the camera run per frame
+            particles.updateEmitters(ships.transforms.data(), ships.size(), deltaTime);
+            particles.update(deltaTime);
+
+            // Camera follows the player ship
+            if ((framePressed >> InputAction_CameraMode) & 1)
+                setCameraMode(camera, (CameraMode)((camera.mode + 1) % CameraMode_Count));
+
+            glm::vec3 playerForward = glm::mat3(ships.transforms[0]) * glm::vec3(-1.0f, 0.0f, 0.0f);
+            updateCamera(camera, ships.worldCenters[0], playerForward, readCameraInput(input, deltaTime), deltaTime);
+
+            // Late latch: poll once more after the simulation and turn the camera by the newest
+            // mouse movement, so the view that culling and drawing use is as fresh as possible.
+            // Events polled here are queued for the next frame's ticks.
+            glfwPollEvents();
+            float lookX, lookY;
+            input.takeLook(lookX, lookY);
+            latchCameraLook(camera, -lookX * mouseLookSensitivity, -lookY * mouseLookSensitivity);
+
+            glm::vec3 cameraPos = camera.position;
+            glm::mat4 view = camera.view();
+            glm::mat4 projection = camera.projection((float)framebufferWidth / (float)framebufferHeight);
+
+            // Fit the shadow cascades to this view and render the ones that are due
+            shadows.update(view, camera.fovY, (float)framebufferWidth / (float)framebufferHeight, camera.nearPlane, sunDirection);
+            const size_t casterCount = ships.size() + asteroids.size();
+            ShadowCaster* shadowCasters = frameArena.allocateArray<ShadowCaster>(casterCount);
+            for (uint32_t i = 0; i < ships.size(); i++) {
+                ShadowCaster caster = {ships.transforms[i], ships.worldCenters[i], ships.boundingRadius, shipMesh};
+                shadowCasters[i] = caster;
+            }
+            for (uint32_t i = 0; i < asteroids.size(); i++) {
+                ShadowCaster caster = {asteroids.transforms[i], asteroids.centers[i], asteroids.radii[i], asteroids.meshes[i]};
+                shadowCasters[ships.size() + i] = caster;
+            }
 
-                // Update the text VBO with the new vertices for this glyph
-                glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-                glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+            // Record draw commands; no GL calls happen until flush
+            renderQueue.begin(view);
+            RenderBucket& bucket = renderQueue.bucket(JobSystem::threadIndex());
+
+            // Queue the axes; lines are cheap to shade so they skip the depth pre-pass
+            DrawCommand axesCommand = {};
+            axesCommand.model = glm::mat4(1.0f);
+            axesCommand.VAO = axesVAO;
+            axesCommand.mode = GL_LINES;
+            axesCommand.count = 6;
+            axesCommand.shader = axesShaderId;
+            axesCommand.layer = RenderLayer_Unlit;
+            axesCommand.indexed = false;
+            bucket.push(axesCommand);
+
+            // Cull ships against the view frustum and queue the visible ones; each worker
+            // writes into its own bucket so no locking is needed. With GPU culling every ship
+            // is queued and the compute pass does the test.
+            DrawCommand shipCommand = {};
+            shipCommand.mode = GL_TRIANGLES;
+            shipCommand.shader = modelShaderId;
+            shipCommand.material = shipMaterial;
+            shipCommand.mesh = shipMesh;
+            shipCommand.layer = RenderLayer_Opaque;
+            shipCommand.indexed = true;
+            shipCommand.pooled = true;
+
+            glm::mat4 viewProjection = projection * view;
+            Frustum frustum = extractFrustum(viewProjection);
+            const bool cpuCulling = !meshPool.gpuCullingActive();
+            gpuCuller.beginFrame(viewProjection);
+
+            uint32_t* visibleShips = frameArena.allocateArray<uint32_t>(ships.size());
+            uint32_t visibleShipCount = 0;
+            if (cpuCulling) {
+                // Serial on purpose: the tree prunes a fleet of a couple of hundred ships in a few
+                // microseconds, less than handing subtrees to the workers would cost
+                ships.tree.queryFrustum(frustum, [&](int32_t proxy) {
+                    uint32_t ship = ships.tree.userData(proxy);
+                    if (sphereInFrustum(frustum, ships.worldCenters[ship], ships.boundingRadius))
+                        visibleShips[visibleShipCount++] = ship;
+                    return true;
+                });
+            } else {
+                for (uint32_t i = 0; i < ships.size(); i++)
+                    visibleShips[visibleShipCount++] = i;
+            }
 
-                // Render the glyph quad
-                glDrawArrays(GL_TRIANGLES, 0, 6);
+            jobs.parallelFor(visibleShipCount, 64, [&](uint32_t begin, uint32_t end) {
+                RenderBucket& shipBucket = renderQueue.bucket(JobSystem::threadIndex());
+                for (uint32_t i = begin; i < end; i++) {
+                    DrawCommand command = shipCommand;
+                    command.model = ships.transforms[visibleShips[i]];
+                    command.textureLayer = shipLiveryLayers[visibleShips[i] % shipLiveryLayers.size()];
+                    shipBucket.push(command);
+                }
+            });
+
+            // Same for the asteroids, one mesh variant per rock
+            DrawCommand asteroidCommand = shipCommand;
+            asteroidCommand.material = asteroidMaterial;
+            jobs.parallelFor((uint32_t)asteroids.size(), 64, [&](uint32_t begin, uint32_t end) {
+                RenderBucket& rockBucket = renderQueue.bucket(JobSystem::threadIndex());
+                for (uint32_t i = begin; i < end; i++) {
+                    if (cpuCulling && !sphereInFrustum(frustum, asteroids.centers[i], asteroids.radii[i]))
+                        continue;
+                    DrawCommand command = asteroidCommand;
+                    command.mesh = asteroids.meshes[i];
+                    command.model = asteroids.transforms[i];
+                    rockBucket.push(command);
+                }
+            });
+
+            // Sort by key (layer, shader, material, depth); nothing is drawn until the graph runs
+            renderQueue.sort();
+
+            if ((framePressed >> InputAction_ToggleOverlay) & 1)
+                overlay.visible = !overlay.visible;
+            if (((framePressed >> InputAction_DumpAllocations) & 1) && writeAllocationJson("allocations.json"))
+                std::cout << "Wrote allocations.json" << std::endl;
+
+            // The frame's GPU work as a render graph: each pass says what it reads and writes, the
+            // graph drops what nothing uses, orders the rest and places the transient targets
+            renderGraph.beginFrame(frameArena.current());
+            RenderResource backbuffer = renderGraph.importTexture("Window", 0, 0, framebufferWidth, framebufferHeight, GL_RGBA8);
+            RenderResource sceneColor = backbuffer;
+            RenderResource sceneDepth = renderGraph.importTexture("Window depth", 0, 0, framebufferWidth, framebufferHeight,
+                                                                  GL_DEPTH_COMPONENT24);
+            if (offscreen) {
+                sceneColor = renderGraph.importTexture("Scene color", sceneTarget.framebufferObject(), sceneTarget.colorTexture(),
+                                                       sceneTarget.width(), sceneTarget.height(), sceneTarget.colorFormat);
+                sceneDepth = renderGraph.importTexture("Scene depth", sceneTarget.framebufferObject(), sceneTarget.depthTexture(),
+                                                       sceneTarget.width(), sceneTarget.height(), sceneTarget.depthFormat);
+            }
+            // Persistent: cascades are only redrawn when due, and next frame culls against the Hi-Z
+            RenderResource shadowMaps = renderGraph.importTexture("Shadow maps", 0, 0, shadows.resolution, shadows.resolution,
+                                                                  GL_DEPTH_COMPONENT32F);
+
+            // Binds the scene's render-size region, the target or the window
+            auto bindScene = [&]() {
+                if (offscreen) {
+                    sceneTarget.bind();
+                } else {
+                    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                    glViewport(0, 0, framebufferWidth, framebufferHeight);
+                }
+            };
+
+            renderGraph.addPass("Shadows",
+                [&](RenderPassBuilder& builder) { shadowMaps = builder.write(shadowMaps); },
+                [&](RenderGraph&) { shadows.render(shadowCasters, casterCount, meshPool); });
+
+            renderGraph.addPass("Depth prepass",
+                [&](RenderPassBuilder& builder) {
+                    sceneColor = builder.write(sceneColor); // Cleared
+                    sceneDepth = builder.write(sceneDepth);
+                },
+                [&](RenderGraph&) {
+                    bindScene();
+                    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Covered by the starfield
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    renderQueue.depthPrepass(view, projection);
+                });
+
+            renderGraph.addPass("Scene",
+                [&](RenderPassBuilder& builder) {
+                    builder.read(shadowMaps);
+                    builder.read(sceneDepth);
+                    sceneColor = builder.write(sceneColor);
+                    sceneDepth = builder.write(sceneDepth);
+                    if (!offscreen)
+                        builder.sideEffect();
+                },
+                [&](RenderGraph&) {
+                    bindScene();
+
+                    // Per-frame uniforms for the axes
+                    glUseProgram(axesShaderProgram);
+                    glUniformMatrix4fv(glGetUniformLocation(axesShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+                    glUniformMatrix4fv(glGetUniformLocation(axesShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+                    // // Optionally set line width
+                    glLineWidth(2.0f);
+
+                    // Per-frame uniforms for the model shader
+                    glUseProgram(shaderProgram);
+                    glUniformMatrix4fv(viewLoc,  1, GL_FALSE, glm::value_ptr(view));
+                    glUniformMatrix4fv(projLoc,  1, GL_FALSE, glm::value_ptr(projection));
+
+                    // Update viewPos uniform
+                    glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos));
+
+                    // Light and material properties
+                    glUniform3fv(glGetUniformLocation(shaderProgram, "sunDirection"), 1, glm::value_ptr(sunDirection));
+                    glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
+                    shadows.setUniforms(shaderProgram, 1);
+
+                    renderQueue.shade();
+                    starfield.draw(view, projection);
+                    projectiles.draw(view, projection);
+                    particles.draw(view, projection);
+                });
+
+            // This frame's depth becomes the Hi-Z pyramid that next frame is culled against. The
+            // copy needs the depth format the culler was set up for, which only the scene target
+            // guarantees; without it (disabled, or it failed to allocate) there is no occlusion
+            // culling.
+            if (offscreen) {
+                RenderResource hiZ = renderGraph.importTexture("Hi-Z pyramid", 0, 0, renderWidth, renderHeight, GL_R32F);
+                renderGraph.addPass("Hi-Z",
+                    [&](RenderPassBuilder& builder) {
+                        builder.read(sceneDepth);
+                        hiZ = builder.write(hiZ);
+                        builder.sideEffect();
+                    },
+                    [&](RenderGraph& graph) {
+                        glBindFramebuffer(GL_FRAMEBUFFER, graph.framebuffer(sceneDepth));
+                        gpuCuller.captureDepth(renderWidth, renderHeight, graph.width(sceneDepth), graph.height(sceneDepth), viewProjection);
+                    });
+            } else {
+                gpuCuller.invalidateDepth();
+            }
 
-                // Move cursor to the next character position
-                x += (ch.Advance >> 6) * scale;
+            if (offscreen && postProcessReady) {
+                backbuffer = postProcess.addPasses(renderGraph, sceneTarget, sceneColor, backbuffer);
+            } else if (offscreen) {
+                renderGraph.addPass("Blit",
+                    [&](RenderPassBuilder& builder) {
+                        builder.read(sceneColor);
+                        backbuffer = builder.write(backbuffer);
+                        builder.sideEffect();
+                    },
+                    [&](RenderGraph&) { sceneTarget.blitToScreen(framebufferWidth, framebufferHeight); });
+            } else {
+                backbuffer = sceneColor;
             }
 
-            glBindVertexArray(0);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glDisable(GL_BLEND);
+            // Stats overlay over the finished frame
+            if (overlay.visible) {
+                renderGraph.addPass("Overlay",
+                    [&](RenderPassBuilder& builder) {
+                        backbuffer = builder.write(backbuffer);
+                        builder.sideEffect();
+                    },
+                    [&](RenderGraph& graph) {
+                        graph.bindTarget(backbuffer);
+                        overlay.draw(textRenderer, framebufferWidth, framebufferHeight, frameArena.current());
+                    });
+            }
 
-            // Check for Enter key press to transition to Game_Screen
-            if (glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
-            gameState = Game_Screen;
+            renderGraph.compile();
+            if (((framePressed >> InputAction_DumpRenderGraph) & 1) && renderGraph.writeGraphviz("render_graph.dot"))
+                std::cout << "Wrote render_graph.dot" << std::endl;
+
+            if (overlay.visible) {
+                const double mb = 1.0 / (1024.0 * 1024.0);
+                AllocationStats heap = allocationStats();
+                overlay.beginFrame();
+                overlay.addLine("Frame %.2f ms", deltaTime * 1000.0f);
+                overlay.addLine("Render %dx%d (%.0f%%), GPU %.2f ms of %.2f ms budget", renderWidth, renderHeight,
+                                dynamicResolution.scale() * 100.0f, dynamicResolution.smoothedTime() * 1000.0, gpuFrameBudget * 1000.0);
+                overlay.addLine("Render graph: %u passes (%u culled), targets %.2f MB (%.2f MB without aliasing)", renderGraph.passCount(),
+                                renderGraph.culledPassCount(), renderGraph.allocatedBytes() * mb, renderGraph.transientBytes() * mb);
+                overlay.addLine("Target pool: %zu targets, %.2f MB", renderTargetPool.targetCount(), renderTargetPool.memoryUsed() * mb);
+                overlay.addLine("Frame times p50 %.2f, p99 %.2f, max %.2f ms (vsync %s, limit %.0f fps)", frameTimeStats.p50 * 1000.0,
+                                frameTimeStats.p99 * 1000.0, frameTimeStats.max * 1000.0, swapModeName(swapMode), frameLimiter.targetRate());
+                overlay.addLine("Heap: %.2f MB live, %.2f MB peak, %llu allocations this frame", heap.liveBytes * mb, heap.peakBytes * mb,
+                                (unsigned long long)(allocationCount() - allocationsAtFrameStart));
+                for (int t = 0; t < AllocationTag_Count; t++) {
+                    AllocationStats tag = allocationStats((AllocationTag)t);
+                    overlay.addLine("  %s: %.2f MB live, %.2f MB peak, %llu allocations", allocationTagName((AllocationTag)t),
+                                    tag.liveBytes * mb, tag.peakBytes * mb, (unsigned long long)tag.allocations);
+                }
+                overlay.addLine("Frame arena: %zu KB peak of %zu KB", frameArena.peak() / 1024, frameArena.current().capacity() / 1024);
+                overlay.addLine("GPU: %.2f MB", gpuResources.totalMemory() * mb);
             }
-        }
-        //---------------------------------------------------------------------------------------------------------------------------------------------------------------
-        else if(gameState == Game_Screen)
-        {
-            // Render
-            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-            // // Transformations for the model
-            glm::mat4 model = glm::mat4(1.0f);
-
-            // Rotate to make Z-axis point up
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)); // Rotate around X-axis
-
-            // Apply translation based on modelPosition
-            model = glm::translate(model, modelPosition);
-
-            // Apply rotation around new Y-axis (previously Z-axis)
-            model = glm::rotate(model, rotationY, glm::vec3(0.0f, 0.0f, 1.0f));
-
-            // Camera settings
-            //glm::vec3 cameraOffset = glm::vec3(30.0f, 0.0f, 15.0f); // Adjust offsets as needed
-            glm::vec3 cameraOffset = glm::vec3(30.0f, 30.0f, 30.0f); // checking if the obj is moving linearly in the axes
-            glm::vec3 cameraPos = cameraOffset; // modelPosition + cameraOffset;
-            glm::vec3 target = modelPosition;
-            glm::vec3 up = glm::vec3(.0f, 0.0f, 1.0f);
-            glm::mat4 view = glm::lookAt(cameraPos, target, up);
-
-            // Projection
-            glm::mat4 projection = glm::perspective(glm::radians(45.0f),
-                    (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-
-            // Render the axes
-            glUseProgram(axesShaderProgram);
-            glUniformMatrix4fv(glGetUniformLocation(axesShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-            glUniformMatrix4fv(glGetUniformLocation(axesShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glBindVertexArray(axesVAO);
-
-            // // Optionally set line width
-            glLineWidth(2.0f);
-
-            // Draw the axes
-            glDrawArrays(GL_LINES, 0, 6);
-            // Render the model
-            glUseProgram(shaderProgram);
-
-            // Set uniforms for the model shader
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(viewLoc,  1, GL_FALSE, glm::value_ptr(view));
-            glUniformMatrix4fv(projLoc,  1, GL_FALSE, glm::value_ptr(projection));
-
-            // Update viewPos uniform
-            glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos));
-
-            // Light and material properties
-            glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"), 50.0f, 50.0f, 50.0f);
-            glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-            glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 0.6f, 0.6f, 0.6f);
-
-            // Render the model
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+
+            gpuFrameTimer.begin();
+            renderGraph.execute(renderTargetPool);
+            gpuFrameTimer.end();
         }
         else if(gameState == End_screen)
         {
@@ -569,54 +1137,187 @@ int main()
         // Swap buffers and poll IO events
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        double swapTime = glfwGetTime();
+        frameTimes.record(swapTime - lastSwapTime);
+        lastSwapTime = swapTime;
+        if (swapTime >= nextFramePacingReport) {
+            nextFramePacingReport = swapTime + framePacingReportInterval;
+            frameTimeStats = frameTimes.stats();
+            frameTimes.reset();
+            if (debugFramePacing)
+                std::cout << "Frame times: p50 " << frameTimeStats.p50 * 1000.0 << " ms, p99 " << frameTimeStats.p99 * 1000.0
+                          << " ms, max " << frameTimeStats.max * 1000.0 << " ms over " << frameTimeStats.frames << " frames" << std::endl;
+        }
+
+        // Objects released this frame are deleted once the GPU has finished with them
+        renderTargetPool.endFrame();
+        gpuResources.endFrame();
+
+        if (debugFrameMemory) {
+            uint64_t frameAllocations = allocationCount() - allocationsAtFrameStart;
+            frameAllocationsTotal += frameAllocations;
+            frameAllocationsMax = std::max(frameAllocationsMax, frameAllocations);
+            framesSinceMemoryReport++;
+            if (glfwGetTime() >= nextFrameMemoryReport) {
+                nextFrameMemoryReport = glfwGetTime() + frameMemoryReportInterval;
+                std::cout << "Frame memory: arena peak " << frameArena.peak() / 1024 << " KB of "
+                          << frameArena.current().capacity() / 1024 << " KB, heap allocations per frame "
+                          << (double)frameAllocationsTotal / framesSinceMemoryReport << " average, "
+                          << frameAllocationsMax << " max" << std::endl;
+                frameAllocationsTotal = frameAllocationsMax = 0;
+                framesSinceMemoryReport = 0;
+            }
+        }
+        if (debugGpuMemory && glfwGetTime() >= nextGpuMemoryReport) {
+            nextGpuMemoryReport = glfwGetTime() + gpuMemoryReportInterval;
+            gpuResources.printReport(std::cout);
+        }
     }
 
-    // Clean up resources
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    // The recorded session goes out before anything is torn down
+    if (input.isRecording()) {
+        input.stopRecording();
+        session.ticks = input.recordedTicks();
+        if (writeReplay(recordPath, session))
+            std::cout << "Wrote " << session.ticks.size() << " ticks to " << recordPath << std::endl;
+    }
 
-    glDeleteVertexArrays(1, &axesVAO);
-    glDeleteBuffers(1, &axesVBO);
+    // Clean up resources
+    sceneTarget.destroy();
+    postProcess.destroy();
+    renderTargetPool.destroy();
+    gpuFrameTimer.destroy();
+    shadows.destroy();
+    textures.destroy();
+    textureArrays.destroy();
+    starfield.destroy();
+    particles.destroy();
+    projectiles.destroy();
+    gpuCuller.destroy();
+    meshPool.destroy();
+
+    gpuResources.release(axesVAOHandle);
+    gpuResources.release(axesVBOHandle);
+    textRenderer.destroy();
+    gpuResources.release(modelProgramHandle);
+    gpuResources.release(axesProgramHandle);
+
+    renderQueue.destroy();
+    jobs.shutdown();
+
+    gpuResources.printReport(std::cout);
+    gpuResources.destroy();
+    frameArena.destroy();
 
     glfwTerminate();
     return 0;
 
 }
 
-void processInput(GLFWwindow* window) {
-    // Close window
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-    // Calculate forward vector based on current rotation
-    glm::vec3 forward = glm::vec3(-cos(rotationY), -sin(rotationY), 0.0f);
-    glm::vec3 right = glm::vec3(-forward.y, forward.x, 0.0f); // Right vector is perpendicular to forward
-
-    // Forward/backward movement - moves along the x axis
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-        //modelPosition += forward * movementSpeed;
-         modelPosition.x -= movementSpeed;
-    }
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-        //modelPosition -= forward * movementSpeed;
-        modelPosition.x += movementSpeed;
+// Only records the size; the main loop reallocates the render targets before the next frame
+void framebufferSizeCallback(GLFWwindow* window, int width, int height)
+{
+    framebufferWidth = width;
+    framebufferHeight = height;
+    framebufferResized = true;
+    glViewport(0, 0, width, height);
+}
+
+// Camera controls from the held actions (bindings in InputSystem::install) plus the scroll wheel.
+// Mouse look is not read here; it is latched later in the frame.
+CameraInput readCameraInput(InputSystem& input, float dt)
+{
+    const float turnSpeed = 1.5f; // Radians per second
+    const float zoomSpeed = 30.0f;
+    const InputState& live = input.liveState();
+    auto axis = [&live](InputAction negative, InputAction positive) {
+        return (live.held(positive) ? 1.0f : 0.0f) - (live.held(negative) ? 1.0f : 0.0f);
+    };
+
+    CameraInput camera;
+    camera.yaw = axis(InputAction_CameraYawRight, InputAction_CameraYawLeft) * turnSpeed * dt;
+    camera.pitch = axis(InputAction_CameraPitchDown, InputAction_CameraPitchUp) * turnSpeed * dt;
+    camera.zoom = axis(InputAction_CameraZoomIn, InputAction_CameraZoomOut) * zoomSpeed * dt - input.takeScroll() * scrollZoomStep;
+    camera.move = glm::vec3(axis(InputAction_CameraLeft, InputAction_CameraRight), axis(InputAction_CameraDown, InputAction_CameraUp),
+                            axis(InputAction_CameraBack, InputAction_CameraForward));
+    return camera;
+}
+
+// Reads an OBJ into the interleaved meshVertexFloats layout, one index per face corner.
+// Everything the parser allocates is charged to the loading tag and freed on return.
+bool loadShipMesh(const char* path, std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+    // Load .obj file
+    AllocationScope loadingScope(AllocationTag_Loading);
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path);
+
+    if (!warn.empty()) {
+        std::cout << "WARN: " << warn << std::endl;
     }
 
-    // Left/right strafing movement - moves along the z axis
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-        //modelPosition -= right * movementSpeed;
-        modelPosition.z += movementSpeed;
+    if (!err.empty()) {
+        std::cerr << "ERR: " << err << std::endl;
     }
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-        //modelPosition += right * movementSpeed;
-        modelPosition.z -= movementSpeed;
+
+    if (!ret) {
+        std::cerr << "Failed to load .obj file!" << std::endl;
+        return false;
     }
-}
 
-// Function to check for OpenGL errors
-void checkGLError(const std::string& errorMessage) {
-    GLenum err;
-    while ((err = glGetError()) != GL_NO_ERROR) {
-        std::cerr << errorMessage << ": OpenGL error: " << err << std::endl;
+    // Prepare vertex data for the model
+    vertices.clear();
+    indices.clear();
+    for (size_t s = 0; s < shapes.size(); s++) {
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
+            int fv = shapes[s].mesh.num_face_vertices[f];
+
+            // Process per-face
+            for (size_t v = 0; v < fv; v++) {
+                // Access vertex data
+                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+                tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
+                tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
+                tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
+
+                // OBJ puts v = 0 at the bottom, images are stored top row first
+                tinyobj::real_t tu = 0;
+                tinyobj::real_t tv = 0;
+                if (idx.texcoord_index >= 0) {
+                    tu = attrib.texcoords[2 * idx.texcoord_index + 0];
+                    tv = 1.0f - attrib.texcoords[2 * idx.texcoord_index + 1];
+                }
+
+                tinyobj::real_t nx = 0;
+                tinyobj::real_t ny = 0;
+                tinyobj::real_t nz = 0;
+                if (idx.normal_index >= 0) {
+                    nx = attrib.normals[3 * idx.normal_index + 0];
+                    ny = attrib.normals[3 * idx.normal_index + 1];
+                    nz = attrib.normals[3 * idx.normal_index + 2];
+                }
+
+                // Append vertex data
+                vertices.push_back(vx);
+                vertices.push_back(vy);
+                vertices.push_back(vz);
+                vertices.push_back(nx);
+                vertices.push_back(ny);
+                vertices.push_back(nz);
+                vertices.push_back(tu);
+                vertices.push_back(tv);
+
+                indices.push_back(indices.size());
+            }
+            index_offset += fv;
+        }
     }
-}
\ No newline at end of file
+
+    return true;
+}
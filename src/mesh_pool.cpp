@@ -0,0 +1,297 @@
+#include "mesh_pool.h"
+#include "allocation_tracker.h"
+#include "gpu_culling.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <iostream>
+
+static const GLsizei vertexStride = meshVertexFloats * sizeof(float);
+
+bool MeshPool::init(uint32_t initialInstanceCapacity)
+{
+    multiDrawIndirectSupported = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+    std::cout << "Mesh pool: " << (multiDrawIndirectSupported ? "multi-draw indirect" : "instanced fallback") << std::endl;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glGenBuffers(1, &instanceBuffer);
+    glGenBuffers(1, &instanceDataBuffer);
+    if (multiDrawIndirectSupported)
+        glGenBuffers(1, &indirectBuffer);
+    vertexHandle = adoptBuffer(vertexBuffer, GpuMemory_Geometry, "Mesh pool vertices");
+    indexHandle = adoptBuffer(indexBuffer, GpuMemory_Geometry, "Mesh pool indices");
+    instanceHandle = adoptBuffer(instanceBuffer, GpuMemory_Geometry, "Mesh pool instances");
+    instanceDataHandle = adoptBuffer(instanceDataBuffer, GpuMemory_Geometry, "Mesh pool instance data");
+    if (indirectBuffer)
+        indirectHandle = adoptBuffer(indirectBuffer, GpuMemory_Other, "Mesh pool indirect draws");
+
+    glBindVertexArray(VAO);
+
+    instanceCapacity = std::max<size_t>(initialInstanceCapacity, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    recordMemory(instanceHandle, instanceCapacity * sizeof(glm::mat4));
+    glBindBuffer(GL_ARRAY_BUFFER, instanceDataBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+    recordMemory(instanceDataHandle, instanceCapacity * sizeof(uint32_t));
+    bindInstanceAttributes(0);
+
+    glBindVertexArray(0);
+    checkGLError("Mesh pool setup error");
+    return true;
+}
+
+void MeshPool::destroy()
+{
+    glDeleteVertexArrays(1, &VAO);
+    deleteBuffer(vertexBuffer, vertexHandle);
+    deleteBuffer(indexBuffer, indexHandle);
+    deleteBuffer(instanceBuffer, instanceHandle);
+    deleteBuffer(instanceDataBuffer, instanceDataHandle);
+    deleteBuffer(indirectBuffer, indirectHandle);
+    VAO = 0;
+    vertexCapacity = indexCapacity = instanceCapacity = indirectCapacity = 0;
+
+    meshes.clear();
+    instances.clear();
+    instanceData.clear();
+    indirectCommands.clear();
+}
+
+uint16_t MeshPool::addMesh(const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+{
+    AllocationScope allocationScope(AllocationTag_Meshes);
+    MeshRange range;
+    range.indexCount = (GLuint)indices.size();
+    range.firstIndex = uploadedIndices + (GLuint)pendingIndices.size();
+    range.baseVertex = uploadedVertices + (GLint)(pendingVertices.size() / meshVertexFloats);
+    range.boundingRadius = 0.0f;
+    for (size_t i = 0; i + 2 < vertices.size(); i += meshVertexFloats) {
+        glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+        range.boundingRadius = std::max(range.boundingRadius, glm::length(position));
+    }
+    meshes.push_back(range);
+
+    pendingVertices.insert(pendingVertices.end(), vertices.begin(), vertices.end());
+    pendingIndices.insert(pendingIndices.end(), indices.begin(), indices.end());
+    return (uint16_t)(meshes.size() - 1);
+}
+
+BufferHandle MeshPool::adoptBuffer(unsigned int buffer, GpuMemoryCategory category, const char* name)
+{
+    return resources ? resources->adopt<GpuResource_Buffer>(buffer, category, name) : BufferHandle();
+}
+
+void MeshPool::deleteBuffer(unsigned int& buffer, BufferHandle& handle)
+{
+    if (resources && handle.valid())
+        resources->release(handle);
+    else if (buffer)
+        glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+void MeshPool::recordMemory(BufferHandle handle, size_t bytes)
+{
+    if (resources)
+        resources->setMemory(handle, bytes);
+}
+
+// Makes sure buffer can hold neededBytes, keeping its first usedBytes. Growing doubles the
+// capacity and copies the old contents on the GPU, so meshes can be added at any time.
+void MeshPool::growBuffer(GLenum target, unsigned int& buffer, BufferHandle& handle, size_t& capacity, size_t usedBytes,
+                          size_t neededBytes)
+{
+    if (neededBytes <= capacity)
+        return;
+
+    size_t newCapacity = std::max(neededBytes, capacity * 2);
+    unsigned int newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, NULL, GL_STATIC_DRAW);
+
+    if (usedBytes > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+    }
+    const char* name = target == GL_ELEMENT_ARRAY_BUFFER ? "Mesh pool indices" : "Mesh pool vertices";
+    deleteBuffer(buffer, handle);
+
+    buffer = newBuffer;
+    handle = adoptBuffer(buffer, GpuMemory_Geometry, name);
+    recordMemory(handle, newCapacity);
+    capacity = newCapacity;
+    glBindBuffer(target, buffer);
+}
+
+void MeshPool::upload()
+{
+    if (pendingVertices.empty() && pendingIndices.empty())
+        return;
+
+    glBindVertexArray(VAO);
+
+    size_t usedVertexBytes = (size_t)uploadedVertices * vertexStride;
+    size_t pendingVertexBytes = pendingVertices.size() * sizeof(float);
+    growBuffer(GL_ARRAY_BUFFER, vertexBuffer, vertexHandle, vertexCapacity, usedVertexBytes, usedVertexBytes + pendingVertexBytes);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, usedVertexBytes, pendingVertexBytes, pendingVertices.data());
+
+    // Vertex positions
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Vertex normals
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Texture coordinates; locations 2-5 are the instance matrix
+    glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, vertexStride, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(6);
+
+    size_t usedIndexBytes = (size_t)uploadedIndices * sizeof(unsigned int);
+    size_t pendingIndexBytes = pendingIndices.size() * sizeof(unsigned int);
+    growBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, indexHandle, indexCapacity, usedIndexBytes, usedIndexBytes + pendingIndexBytes);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, usedIndexBytes, pendingIndexBytes, pendingIndices.data());
+
+    glBindVertexArray(0);
+
+    uploadedVertices += (GLint)(pendingVertices.size() / meshVertexFloats);
+    uploadedIndices += (GLuint)pendingIndices.size();
+
+    // Release the CPU copies, the GPU owns the data now
+    std::vector<float>().swap(pendingVertices);
+    std::vector<unsigned int>().swap(pendingIndices);
+
+    checkGLError("Mesh pool upload error");
+}
+
+void MeshPool::bindInstanceAttributes(uint32_t firstInstance)
+{
+    // A mat4 attribute takes four vec4 locations
+    size_t byteOffset = (size_t)firstInstance * sizeof(glm::mat4);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void*)(byteOffset + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(2 + column);
+        glVertexAttribDivisor(2 + column, 1);
+    }
+
+    // Integer attribute, not converted to float
+    glBindBuffer(GL_ARRAY_BUFFER, instanceDataBuffer);
+    glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)((size_t)firstInstance * sizeof(uint32_t)));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+}
+
+void MeshPool::beginFrame()
+{
+    instances.clear();
+    instanceData.clear();
+}
+
+uint32_t MeshPool::pushInstance(const glm::mat4& model, uint32_t data)
+{
+    instances.push_back(model);
+    instanceData.push_back(data);
+    return (uint32_t)(instances.size() - 1);
+}
+
+bool MeshPool::gpuCullingActive() const
+{
+    return gpuCuller && gpuCuller->active() && useMultiDrawIndirect();
+}
+
+void MeshPool::uploadFrame(const std::vector<MeshDraw>& draws, bool gpuCull)
+{
+    if (instances.empty())
+        return;
+
+    const bool gpuCulling = gpuCull && gpuCullingActive();
+
+    // Orphan and refill: the driver hands out fresh storage instead of stalling on last frame's draws.
+    // When culling on the GPU the compute pass fills it instead.
+    if (instances.size() > instanceCapacity)
+        instanceCapacity = std::max(instances.size(), instanceCapacity * 2);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    recordMemory(instanceHandle, instanceCapacity * sizeof(glm::mat4));
+    if (!gpuCulling)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(glm::mat4), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, instanceDataBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+    recordMemory(instanceDataHandle, instanceCapacity * sizeof(uint32_t));
+    if (!gpuCulling)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instanceData.size() * sizeof(uint32_t), instanceData.data());
+
+    if (!useMultiDrawIndirect())
+        return;
+
+    indirectCommands.clear();
+    for (const MeshDraw& d : draws) {
+        const MeshRange& range = meshes[d.mesh];
+        DrawElementsIndirectCommand command;
+        command.count = range.indexCount;
+        command.instanceCount = gpuCulling ? 0 : d.instanceCount; // The cull pass counts survivors
+        command.firstIndex = range.firstIndex;
+        command.baseVertex = range.baseVertex;
+        command.baseInstance = d.firstInstance;
+        indirectCommands.push_back(command);
+    }
+
+    size_t indirectBytes = indirectCommands.size() * sizeof(DrawElementsIndirectCommand);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    if (indirectBytes > indirectCapacity)
+        indirectCapacity = std::max(indirectBytes, indirectCapacity * 2);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, NULL, GL_STREAM_DRAW);
+    recordMemory(indirectHandle, indirectCapacity);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, indirectBytes, indirectCommands.data());
+
+    if (!gpuCulling)
+        return;
+
+    // Every pushed instance is a candidate; baseInstance already reserves room for all of a draw's
+    cullCandidates.resize(instances.size());
+    for (size_t drawIndex = 0; drawIndex < draws.size(); drawIndex++) {
+        const MeshDraw& d = draws[drawIndex];
+        float radius = meshes[d.mesh].boundingRadius;
+        for (uint32_t i = d.firstInstance; i < d.firstInstance + d.instanceCount; i++) {
+            CullCandidate& candidate = cullCandidates[i];
+            candidate.model = instances[i];
+            candidate.drawIndex = (uint32_t)drawIndex;
+            candidate.radius = radius;
+            candidate.data = instanceData[i];
+        }
+    }
+    gpuCuller->cull(cullCandidates, indirectBuffer, instanceBuffer, instanceDataBuffer);
+}
+
+void MeshPool::draw(const std::vector<MeshDraw>& draws, size_t first, size_t count)
+{
+    if (count == 0)
+        return;
+
+    if (useMultiDrawIndirect()) {
+        // baseInstance offsets the instance stream per command, so one call covers every mesh
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                    (void*)(first * sizeof(DrawElementsIndirectCommand)), (GLsizei)count, 0);
+        return;
+    }
+
+    // GL 3.3 has no baseInstance, so the instance attributes are rebased per draw instead
+    for (size_t i = first; i < first + count; i++) {
+        const MeshDraw& d = draws[i];
+        const MeshRange& range = meshes[d.mesh];
+        bindInstanceAttributes(d.firstInstance);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                                          (void*)(range.firstIndex * sizeof(unsigned int)),
+                                          d.instanceCount, range.baseVertex);
+    }
+    bindInstanceAttributes(0);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "gpu_resources.h"
+
+class GpuCuller;
+
+// Floats per vertex in the pool's interleaved layout
+const int meshVertexFloats = 8;
+struct CullCandidate;
+
+// Where a mesh lives inside the shared buffers
+struct MeshRange
+{
+    GLuint indexCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    float boundingRadius; // Around the mesh origin, for culling
+};
+
+// Layout fixed by the GL spec for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// One instanced draw of a mesh inside a frame's instance stream
+struct MeshDraw
+{
+    uint16_t mesh;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// All meshes packed into one mega vertex buffer and one mega index buffer behind a single VAO,
+// plus per-instance streams: the model matrix (attribute locations 2-5) and one uint of data
+// such as a texture array layer (location 7), both with divisor 1.
+//
+// With GL 4.3 / ARB_multi_draw_indirect a whole batch of meshes is one glMultiDrawElementsIndirect;
+// on plain GL 3.3 it falls back to one glDrawElementsInstancedBaseVertex per mesh.
+//
+// Vertex layout: position (location 0), normal (location 1) and texcoord (location 6), 8 floats.
+class MeshPool
+{
+public:
+    bool multiDrawIndirectEnabled = true;
+
+    // With a registry set the buffers are accounted there, and replaced ones are deleted only
+    // once the GPU has finished the frames that used them; call before init()
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    bool init(uint32_t initialInstanceCapacity = 1024);
+    void destroy();
+
+    // Appends a mesh; the data is copied to the GPU on the next upload() and not kept on the CPU
+    uint16_t addMesh(const std::vector<float>& vertices, const std::vector<unsigned int>& indices);
+    void upload();
+
+    const MeshRange& mesh(uint16_t id) const { return meshes[id]; }
+    unsigned int vao() const { return VAO; }
+    bool useMultiDrawIndirect() const { return multiDrawIndirectSupported && multiDrawIndirectEnabled; }
+
+    // With an active culler, uploadFrame treats the pushed instances as candidates and lets the
+    // GPU pick the visible ones; callers should then skip their own frustum test
+    void setGpuCuller(GpuCuller* culler) { gpuCuller = culler; }
+    bool gpuCullingActive() const;
+
+    // Per-frame instance stream
+    void beginFrame();
+    uint32_t pushInstance(const glm::mat4& model, uint32_t data = 0);
+    uint32_t instanceCount() const { return (uint32_t)instances.size(); }
+    // gpuCull false skips the culler for passes with their own view, e.g. shadow maps. A stream
+    // may be uploaded several times per frame; draws already issued keep the previous storage.
+    void uploadFrame(const std::vector<MeshDraw>& draws, bool gpuCull = true);
+
+    // Issues draws[first, first + count) of the list given to uploadFrame
+    void draw(const std::vector<MeshDraw>& draws, size_t first, size_t count);
+
+private:
+    void growBuffer(GLenum target, unsigned int& buffer, BufferHandle& handle, size_t& capacity, size_t usedBytes, size_t neededBytes);
+    BufferHandle adoptBuffer(unsigned int buffer, GpuMemoryCategory category, const char* name);
+    void deleteBuffer(unsigned int& buffer, BufferHandle& handle);
+    void recordMemory(BufferHandle handle, size_t bytes);
+    void bindInstanceAttributes(uint32_t firstInstance);
+
+    unsigned int VAO = 0;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+    unsigned int instanceBuffer = 0;
+    unsigned int instanceDataBuffer = 0;
+    unsigned int indirectBuffer = 0;
+
+    GpuResources* resources = nullptr;
+    BufferHandle vertexHandle;
+    BufferHandle indexHandle;
+    BufferHandle instanceHandle;
+    BufferHandle instanceDataHandle;
+    BufferHandle indirectHandle;
+
+    size_t vertexCapacity = 0; // Bytes
+    size_t indexCapacity = 0;
+    size_t instanceCapacity = 0; // Instances, for both streams
+    size_t indirectCapacity = 0;
+
+    // GPU-side fill of the mega buffers, in elements
+    GLint uploadedVertices = 0;
+    GLuint uploadedIndices = 0;
+
+    // Meshes added since the last upload
+    std::vector<float> pendingVertices;
+    std::vector<unsigned int> pendingIndices;
+
+    std::vector<MeshRange> meshes;
+    std::vector<glm::mat4> instances;
+    std::vector<uint32_t> instanceData;
+    std::vector<DrawElementsIndirectCommand> indirectCommands;
+
+    GpuCuller* gpuCuller = nullptr;
+    std::vector<CullCandidate> cullCandidates;
+
+    bool multiDrawIndirectSupported = false;
+};
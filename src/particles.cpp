@@ -0,0 +1,356 @@
+#include "particles.h"
+#include "shader.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+
+// Particle layout in the simulation buffers: three vec4s, 48 bytes
+static const GLsizei particleStride = 12 * sizeof(float);
+
+static const char* particleUpdateShaderSource = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec4 inPositionAge;  // xyz, age in seconds
+    layout(location = 1) in vec4 inVelocityLife; // xyz, lifetime in seconds
+    layout(location = 2) in vec4 inColorSize;    // rgb, half-size
+
+    out vec4 outPositionAge;
+    out vec4 outVelocityLife;
+    out vec4 outColorSize;
+
+    uniform float deltaTime;
+    uniform float drag;
+    uniform uint spawnStart;
+    uniform uint spawnCount;
+    uniform uint capacity;
+    uniform int requestCount;
+    uniform uint seed;
+    uniform vec3 originShift; // Floating-origin rebase, applied to particles that already exist
+    uniform samplerBuffer requests; // Four texels per spawn request
+
+    uint hash(uint x) {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    float random01(inout uint state) {
+        state = hash(state);
+        return float(state >> 8) * (1.0 / 16777216.0);
+    }
+
+    void main() {
+        uint id = uint(gl_VertexID);
+        uint offset = (id + capacity - spawnStart) % capacity;
+
+        if (offset < spawnCount && requestCount > 0) {
+            // Last request whose first offset is at or before this slot
+            int low = 0;
+            int high = requestCount - 1;
+            while (low < high) {
+                int middle = (low + high + 1) / 2;
+                if (texelFetch(requests, middle * 4).w <= float(offset))
+                    low = middle;
+                else
+                    high = middle - 1;
+            }
+            vec4 positionFirst = texelFetch(requests, low * 4);
+            vec4 velocitySpread = texelFetch(requests, low * 4 + 1);
+            vec4 colorLifetime = texelFetch(requests, low * 4 + 2);
+            float size = texelFetch(requests, low * 4 + 3).x;
+
+            uint state = hash(id ^ hash(seed));
+            vec3 jitter = vec3(random01(state), random01(state), random01(state)) * 2.0 - 1.0;
+            float lifetime = colorLifetime.w * (0.75 + 0.5 * random01(state));
+
+            outPositionAge = vec4(positionFirst.xyz, 0.0);
+            outVelocityLife = vec4(velocitySpread.xyz + jitter * velocitySpread.w, lifetime);
+            outColorSize = vec4(colorLifetime.rgb, size);
+            return;
+        }
+
+        outPositionAge = vec4(inPositionAge.xyz - originShift, inPositionAge.w);
+        outVelocityLife = inVelocityLife;
+        outColorSize = inColorSize;
+        if (inPositionAge.w < inVelocityLife.w) {
+            outPositionAge = vec4(outPositionAge.xyz + inVelocityLife.xyz * deltaTime, inPositionAge.w + deltaTime);
+            outVelocityLife.xyz *= max(1.0 - drag * deltaTime, 0.0);
+        }
+    }
+)glsl";
+
+static const char* particleVertexShaderSource = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec4 aPositionAge;
+    layout(location = 1) in vec4 aVelocityLife;
+    layout(location = 2) in vec4 aColorSize;
+    layout(location = 3) in vec2 aCorner;
+
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    out vec2 Corner;
+    out vec3 Color;
+
+    void main() {
+        Corner = aCorner;
+        if (aPositionAge.w >= aVelocityLife.w) {
+            // Dead: put the quad outside the clip volume
+            Color = vec3(0.0);
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+            return;
+        }
+
+        float t = aPositionAge.w / aVelocityLife.w;
+        Color = aColorSize.rgb * (1.0 - t);
+        vec4 center = view * vec4(aPositionAge.xyz, 1.0);
+        gl_Position = projection * (center + vec4(aCorner * aColorSize.w * (1.0 - 0.5 * t), 0.0, 0.0));
+    }
+)glsl";
+
+static const char* particleFragmentShaderSource = R"glsl(
+    #version 330 core
+    out vec4 FragColor;
+
+    in vec2 Corner;
+    in vec3 Color;
+
+    void main() {
+        float falloff = max(1.0 - dot(Corner, Corner), 0.0);
+        FragColor = vec4(Color * falloff * falloff, 1.0);
+    }
+)glsl";
+
+static void bindParticleAttributes(unsigned int buffer, bool instanced)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int i = 0; i < 3; i++) {
+        glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, particleStride, (void*)(i * 4 * sizeof(float)));
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, instanced ? 1 : 0);
+    }
+}
+
+bool ParticleSystem::init(uint32_t capacity)
+{
+    const char* varyings[] = { "outPositionAge", "outVelocityLife", "outColorSize" };
+    updateProgram = createTransformFeedbackProgram(particleUpdateShaderSource, varyings, 3, "Particle update");
+    renderProgram = createShaderProgram(particleVertexShaderSource, particleFragmentShaderSource, "Particle");
+    if (!updateProgram || !renderProgram) {
+        std::cerr << "Particle system disabled" << std::endl;
+        return false;
+    }
+
+    deltaTimeLoc = glGetUniformLocation(updateProgram, "deltaTime");
+    dragLoc = glGetUniformLocation(updateProgram, "drag");
+    spawnStartLoc = glGetUniformLocation(updateProgram, "spawnStart");
+    spawnCountLoc = glGetUniformLocation(updateProgram, "spawnCount");
+    capacityLoc = glGetUniformLocation(updateProgram, "capacity");
+    requestCountLoc = glGetUniformLocation(updateProgram, "requestCount");
+    seedLoc = glGetUniformLocation(updateProgram, "seed");
+    originShiftLoc = glGetUniformLocation(updateProgram, "originShift");
+    requestsLoc = glGetUniformLocation(updateProgram, "requests");
+    viewLoc = glGetUniformLocation(renderProgram, "view");
+    projectionLoc = glGetUniformLocation(renderProgram, "projection");
+
+    maxParticles = capacity;
+    ringHead = 0;
+    usedParticles = 0;
+    current = 0;
+
+    // Zeroed particles have age 0 and lifetime 0, i.e. dead
+    std::vector<float> zeros((size_t)capacity * 12, 0.0f);
+    glGenBuffers(2, particleBuffers);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, particleBuffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, zeros.size() * sizeof(float), zeros.data(), GL_DYNAMIC_COPY);
+        if (resources) {
+            particleHandles[i] = resources->adopt<GpuResource_Buffer>(particleBuffers[i], GpuMemory_Geometry, "Particle state");
+            resources->setMemory(particleHandles[i], zeros.size() * sizeof(float));
+        }
+    }
+
+    const float corners[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+    glGenBuffers(1, &quadVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+    glGenVertexArrays(2, updateVAOs);
+    glGenVertexArrays(2, renderVAOs);
+    for (int i = 0; i < 2; i++) {
+        glBindVertexArray(updateVAOs[i]);
+        bindParticleAttributes(particleBuffers[i], false);
+
+        glBindVertexArray(renderVAOs[i]);
+        bindParticleAttributes(particleBuffers[i], true);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(3);
+    }
+    glBindVertexArray(0);
+
+    glGenBuffers(1, &requestBuffer);
+    glGenTextures(1, &requestTexture);
+    requestCapacity = 256;
+    glBindBuffer(GL_TEXTURE_BUFFER, requestBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, requestCapacity * sizeof(SpawnRequest), NULL, GL_STREAM_DRAW);
+    if (resources) {
+        requestHandle = resources->adopt<GpuResource_Buffer>(requestBuffer, GpuMemory_Other, "Particle spawn requests");
+        resources->setMemory(requestHandle, requestCapacity * sizeof(SpawnRequest));
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, requestTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, requestBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    requests.reserve(requestCapacity);
+    checkGLError("Particle setup error");
+    return true;
+}
+
+void ParticleSystem::destroy()
+{
+    if (updateProgram)
+        glDeleteProgram(updateProgram);
+    if (renderProgram)
+        glDeleteProgram(renderProgram);
+    glDeleteVertexArrays(2, updateVAOs);
+    glDeleteVertexArrays(2, renderVAOs);
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteTextures(1, &requestTexture);
+    if (resources && requestHandle.valid()) {
+        resources->release(particleHandles[0]);
+        resources->release(particleHandles[1]);
+        resources->release(requestHandle);
+    } else {
+        glDeleteBuffers(2, particleBuffers);
+        glDeleteBuffers(1, &requestBuffer);
+    }
+
+    updateProgram = renderProgram = quadVBO = requestBuffer = requestTexture = 0;
+    particleBuffers[0] = particleBuffers[1] = 0;
+    updateVAOs[0] = updateVAOs[1] = renderVAOs[0] = renderVAOs[1] = 0;
+    emitters.clear();
+    requests.clear();
+}
+
+uint32_t ParticleSystem::addEmitter(const ParticleEmitter& emitter)
+{
+    emitters.push_back(emitter);
+    return (uint32_t)(emitters.size() - 1);
+}
+
+void ParticleSystem::emit(const glm::vec3& position, const glm::vec3& velocity, float spread, const glm::vec3& color,
+                          float lifetime, float size, uint32_t count)
+{
+    // More than a full ring in one frame would overwrite itself
+    count = std::min(count, maxParticles - pendingSpawns);
+    if (count == 0)
+        return;
+
+    SpawnRequest request;
+    request.positionFirst = glm::vec4(position, (float)pendingSpawns);
+    request.velocitySpread = glm::vec4(velocity, spread);
+    request.colorLifetime = glm::vec4(color, lifetime);
+    request.size = glm::vec4(size, 0.0f, 0.0f, 0.0f);
+    requests.push_back(request);
+    pendingSpawns += count;
+}
+
+void ParticleSystem::updateEmitters(const glm::mat4* transforms, size_t transformCount, float dt)
+{
+    for (ParticleEmitter& e : emitters) {
+        e.accumulator += e.rate * dt;
+        uint32_t count = (uint32_t)e.accumulator;
+        e.accumulator -= (float)count;
+        if (count == 0 || e.attachment >= transformCount)
+            continue;
+
+        const glm::mat4& transform = transforms[e.attachment];
+        glm::vec3 position = glm::vec3(transform * glm::vec4(e.localOffset, 1.0f));
+        glm::vec3 velocity = glm::mat3(transform) * e.localVelocity;
+        emit(position, velocity, e.spread, e.color, e.lifetime, e.size, count);
+    }
+}
+
+void ParticleSystem::update(float dt)
+{
+    if (!updateProgram)
+        return;
+
+    const uint32_t spawnStart = ringHead;
+    const uint32_t spawnCount = pendingSpawns;
+    ringHead = (ringHead + spawnCount) % maxParticles;
+    usedParticles = std::min(maxParticles, usedParticles + spawnCount);
+    if (usedParticles == 0) {
+        pendingShift = glm::vec3(0.0f); // Nothing alive to move
+        return;
+    }
+
+    // Upload this frame's spawn requests into a fresh (orphaned, possibly larger) buffer
+    if (requests.size() > requestCapacity)
+        requestCapacity = std::max(requests.size(), requestCapacity * 2);
+    glBindBuffer(GL_TEXTURE_BUFFER, requestBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, requestCapacity * sizeof(SpawnRequest), NULL, GL_STREAM_DRAW);
+    if (resources)
+        resources->setMemory(requestHandle, requestCapacity * sizeof(SpawnRequest));
+    if (!requests.empty())
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, requests.size() * sizeof(SpawnRequest), requests.data());
+
+    glUseProgram(updateProgram);
+    glUniform1f(deltaTimeLoc, dt);
+    glUniform1f(dragLoc, drag);
+    glUniform1ui(spawnStartLoc, spawnStart);
+    glUniform1ui(spawnCountLoc, spawnCount);
+    glUniform1ui(capacityLoc, maxParticles);
+    glUniform1i(requestCountLoc, (int)requests.size());
+    glUniform1ui(seedLoc, frameSeed++);
+    glUniform3f(originShiftLoc, pendingShift.x, pendingShift.y, pendingShift.z);
+    glUniform1i(requestsLoc, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, requestTexture);
+
+    // Read current, write the other buffer; no fragments are needed
+    const int next = 1 - current;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(updateVAOs[current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, particleBuffers[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)usedParticles);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    current = next;
+
+    requests.clear();
+    pendingSpawns = 0;
+    pendingShift = glm::vec3(0.0f);
+}
+
+void ParticleSystem::draw(const glm::mat4& view, const glm::mat4& projection)
+{
+    if (!renderProgram || usedParticles == 0)
+        return;
+
+    glUseProgram(renderProgram);
+    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+
+    // Additive and depth-tested against the scene, but not writing depth
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    glBindVertexArray(renderVAOs[current]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)usedParticles);
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gpu_resources.h"
+
+// Continuous emitter attached to an entity transform (a ship), in that entity's model space
+struct ParticleEmitter
+{
+    uint32_t attachment;     // Index into the transforms given to updateEmitters
+    glm::vec3 localOffset;
+    glm::vec3 localVelocity;
+    float spread;            // Random velocity added per axis, units per second
+    glm::vec3 color;
+    float lifetime;          // Seconds
+    float size;              // Billboard half-size
+    float rate;              // Particles per second
+    float accumulator;       // Fractional particles carried to the next frame
+};
+
+// GPU particle system. Particles only ever live in GPU memory.
+//
+// Simulation is a transform feedback pass on GL 3.3: a vertex shader reads every particle from
+// one buffer and writes it, aged and moved, to the other, and the two swap each frame. New
+// particles are allocated from a ring: the CPU only uploads a short list of this frame's spawn
+// requests (one per emitter or burst) to a buffer texture, and the slots in this frame's spawn
+// window look up their request and initialise themselves. CPU cost is per emitter, never per
+// particle.
+//
+// Rendering is one instanced draw of camera-facing quads with additive blending, which is
+// order independent, so no sorting is needed.
+class ParticleSystem
+{
+public:
+    float drag = 0.8f; // Velocity lost per second, as a fraction
+
+    // With a registry set the particle and request buffers are accounted there; call before init()
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    bool init(uint32_t capacity);
+    void destroy();
+
+    uint32_t addEmitter(const ParticleEmitter& emitter);
+    ParticleEmitter& emitter(uint32_t id) { return emitters[id]; }
+
+    // One-off burst, e.g. an explosion
+    void emit(const glm::vec3& position, const glm::vec3& velocity, float spread, const glm::vec3& color,
+              float lifetime, float size, uint32_t count);
+
+    // Spawns this frame's share of every continuous emitter from the current attachment transforms
+    void updateEmitters(const glm::mat4* transforms, size_t transformCount, float dt);
+
+    // Runs the simulation pass, creating everything emitted since the last update
+    void update(float dt);
+
+    void draw(const glm::mat4& view, const glm::mat4& projection);
+
+    // Floating-origin rebase: live particles are moved by -shift in the next update pass
+    void rebase(const glm::vec3& shift) { pendingShift += shift; }
+
+    uint32_t capacity() const { return maxParticles; }
+
+private:
+    // Spawn request as uploaded to the buffer texture, four RGBA32F texels
+    struct SpawnRequest
+    {
+        glm::vec4 positionFirst; // xyz, first slot offset in this frame's spawn window
+        glm::vec4 velocitySpread;
+        glm::vec4 colorLifetime;
+        glm::vec4 size;
+    };
+
+    std::vector<ParticleEmitter> emitters;
+    std::vector<SpawnRequest> requests;
+    uint32_t pendingSpawns = 0;
+
+    uint32_t maxParticles = 0;
+    uint32_t ringHead = 0;     // Next slot to spawn into
+    uint32_t usedParticles = 0; // Slots touched so far; grows to capacity once the ring wraps
+    uint32_t frameSeed = 0;
+    glm::vec3 pendingShift = glm::vec3(0.0f);
+
+    // Ping-pong particle buffers; current holds the latest state
+    unsigned int particleBuffers[2] = { 0, 0 };
+    unsigned int updateVAOs[2] = { 0, 0 };
+    unsigned int renderVAOs[2] = { 0, 0 };
+    int current = 0;
+
+    unsigned int quadVBO = 0;
+    unsigned int requestBuffer = 0;
+    unsigned int requestTexture = 0;
+    size_t requestCapacity = 0;
+
+    GpuResources* resources = nullptr;
+    BufferHandle particleHandles[2];
+    BufferHandle requestHandle;
+
+    unsigned int updateProgram = 0;
+    unsigned int renderProgram = 0;
+    int deltaTimeLoc = -1;
+    int dragLoc = -1;
+    int spawnStartLoc = -1;
+    int spawnCountLoc = -1;
+    int capacityLoc = -1;
+    int requestCountLoc = -1;
+    int seedLoc = -1;
+    int originShiftLoc = -1;
+    int requestsLoc = -1;
+    int viewLoc = -1;
+    int projectionLoc = -1;
+};
@@ -0,0 +1,65 @@
+#include "pool_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+
+BlockPool::BlockPool(size_t blockSize, size_t blocksPerChunk)
+{
+    // Every block must hold the free list link and keep the next block aligned
+    const size_t alignment = alignof(std::max_align_t);
+    size = std::max(blockSize, sizeof(FreeBlock));
+    size = (size + alignment - 1) & ~(alignment - 1);
+    perChunk = std::max<size_t>(blocksPerChunk, 1);
+}
+
+BlockPool::~BlockPool()
+{
+    if (live > 0)
+        std::cerr << "Block pool: " << live << " blocks of " << size << " bytes still live" << std::endl;
+    for (void* chunk : chunks)
+        ::operator delete(chunk);
+}
+
+void BlockPool::addChunk()
+{
+    uint8_t* chunk = static_cast<uint8_t*>(::operator new(size * perChunk, std::nothrow));
+    if (!chunk) {
+        std::cerr << "Block pool: out of memory" << std::endl;
+        std::abort();
+    }
+    chunks.push_back(chunk);
+
+    // Thread the new blocks onto the free list, lowest address first
+    for (size_t i = perChunk; i-- > 0; ) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * size);
+        block->next = freeList;
+        freeList = block;
+    }
+}
+
+void* BlockPool::allocate()
+{
+    if (!freeList)
+        addChunk();
+    FreeBlock* block = freeList;
+    freeList = block->next;
+    live++;
+    peak = std::max(peak, live);
+    return block;
+}
+
+void BlockPool::deallocate(void* pointer)
+{
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    block->next = freeList;
+    freeList = block;
+    live--;
+}
+
+void BlockPool::reserve(size_t count)
+{
+    while (capacity() < count)
+        addChunk();
+}
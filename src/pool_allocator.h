@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Fixed-size blocks carved out of larger chunks. Freed blocks go on an intrusive free list and
+// are handed out again first, so a steady create/destroy pattern never reaches the heap.
+class BlockPool
+{
+public:
+    explicit BlockPool(size_t blockSize, size_t blocksPerChunk = 256);
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+    ~BlockPool();
+
+    void* allocate();
+    void deallocate(void* block);
+
+    // Makes sure count blocks can be live without another chunk
+    void reserve(size_t count);
+
+    size_t blockSize() const { return size; }
+    size_t liveBlocks() const { return live; }
+    size_t peakBlocks() const { return peak; }
+    size_t capacity() const { return chunks.size() * perChunk; }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    void addChunk();
+
+    size_t size;
+    size_t perChunk;
+    size_t live = 0;
+    size_t peak = 0;
+    FreeBlock* freeList = nullptr;
+    std::vector<void*> chunks;
+};
+
+// Typed pool for objects created and destroyed individually (entities, chunks, nodes)
+template <typename T>
+class ObjectPool
+{
+public:
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+
+    explicit ObjectPool(size_t objectsPerChunk = 256) : blocks(sizeof(T), objectsPerChunk) {}
+
+    template <typename... Args>
+    T* create(Args&&... args) { return new (blocks.allocate()) T(std::forward<Args>(args)...); }
+
+    void destroy(T* object)
+    {
+        if (!object)
+            return;
+        object->~T();
+        blocks.deallocate(object);
+    }
+
+    void reserve(size_t count) { blocks.reserve(count); }
+    size_t liveCount() const { return blocks.liveBlocks(); }
+    size_t peakCount() const { return blocks.peakBlocks(); }
+
+private:
+    BlockPool blocks;
+};
+
+// STL allocator that takes single elements that fit a block from a BlockPool and anything else
+// from the heap. Node containers (lists, maps) allocate one node at a time, so their nodes all
+// come from the pool; bucket arrays and other bulk requests do not.
+template <typename T>
+struct PoolAllocator
+{
+    typedef T value_type;
+
+    BlockPool* pool;
+
+    explicit PoolAllocator(BlockPool* blockPool) : pool(blockPool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(size_t count)
+    {
+        if (fromPool(count))
+            return static_cast<T*>(pool->allocate());
+        return static_cast<T*>(::operator new(sizeof(T) * count));
+    }
+
+    void deallocate(T* pointer, size_t count)
+    {
+        if (fromPool(count))
+            pool->deallocate(pointer);
+        else
+            ::operator delete(pointer);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+
+private:
+    bool fromPool(size_t count) const
+    {
+        return count == 1 && sizeof(T) <= pool->blockSize() && alignof(T) <= alignof(std::max_align_t);
+    }
+};
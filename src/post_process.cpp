@@ -0,0 +1,368 @@
+#include "post_process.h"
+#include "shader.h"
+
+#include <algorithm>
+
+// Vertices (-1,-1), (3,-1), (-1,3): one triangle covering the viewport, uv 0..1 across it
+static const char* postVertexShaderSource = R"glsl(
+    #version 330 core
+    out vec2 uv;
+
+    void main() {
+        vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        uv = corner;
+        gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    }
+)glsl";
+
+// 13-tap downsample (box filters over overlapping 4x4 and 2x2 blocks). The first level also
+// averages the blocks weighted by inverse luma, so single bright pixels don't flicker, and
+// applies the soft threshold.
+static const char* downsampleFragmentShaderSource = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+
+    uniform sampler2D source;
+    uniform vec2 texelSize; // Of the source texture
+    uniform vec2 uvScale;   // Part of the source texture holding the image
+    uniform bool prefilter;
+    uniform float threshold;
+    uniform float knee;
+
+    vec3 tap(float x, float y) {
+        vec2 coord = min(uv * uvScale + vec2(x, y) * texelSize, uvScale - 0.5 * texelSize);
+        return texture(source, coord).rgb;
+    }
+
+    float luma(vec3 color) {
+        return dot(color, vec3(0.2126, 0.7152, 0.0722));
+    }
+
+    void main() {
+        vec3 a = tap(-2.0, 2.0), b = tap(0.0, 2.0), c = tap(2.0, 2.0);
+        vec3 d = tap(-2.0, 0.0), e = tap(0.0, 0.0), f = tap(2.0, 0.0);
+        vec3 g = tap(-2.0, -2.0), h = tap(0.0, -2.0), i = tap(2.0, -2.0);
+        vec3 j = tap(-1.0, 1.0), k = tap(1.0, 1.0), l = tap(-1.0, -1.0), m = tap(1.0, -1.0);
+
+        vec3 blocks[5] = vec3[](
+            (j + k + l + m) * 0.25,
+            (a + b + d + e) * 0.25, (b + c + e + f) * 0.25,
+            (d + e + g + h) * 0.25, (e + f + h + i) * 0.25);
+        float weights[5] = float[](0.5, 0.125, 0.125, 0.125, 0.125);
+
+        vec3 color = vec3(0.0);
+        float total = 0.0;
+        for (int n = 0; n < 5; n++) {
+            float w = prefilter ? weights[n] / (1.0 + luma(blocks[n])) : weights[n];
+            color += blocks[n] * w;
+            total += w;
+        }
+        color /= total;
+
+        if (prefilter) {
+            float brightness = max(color.r, max(color.g, color.b));
+            float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+            soft = soft * soft / (4.0 * knee + 1e-4);
+            color *= max(soft, brightness - threshold) / max(brightness, 1e-4);
+        }
+        FragColor = vec4(color, 1.0);
+    }
+)glsl";
+
+// 3x3 tent upsample, added onto the larger level by blending
+static const char* upsampleFragmentShaderSource = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+
+    uniform sampler2D source;
+    uniform vec2 texelSize; // Of the source texture
+    uniform vec2 uvScale;   // Part of the source texture holding the image
+
+    vec3 tap(float x, float y) {
+        vec2 coord = min(uv * uvScale + vec2(x, y) * texelSize, uvScale - 0.5 * texelSize);
+        return texture(source, coord).rgb;
+    }
+
+    void main() {
+        vec3 color = tap(0.0, 0.0) * 4.0;
+        color += (tap(-1.0, 0.0) + tap(1.0, 0.0) + tap(0.0, -1.0) + tap(0.0, 1.0)) * 2.0;
+        color += tap(-1.0, -1.0) + tap(1.0, -1.0) + tap(-1.0, 1.0) + tap(1.0, 1.0);
+        FragColor = vec4(color / 16.0, 1.0);
+    }
+)glsl";
+
+// Bloom composite, exposure and ACES tonemapping; luma goes to alpha for FXAA
+static const char* compositeFragmentShaderSource = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+
+    uniform sampler2D scene;
+    uniform sampler2D bloom;
+    uniform vec2 sceneScale;
+    uniform vec2 bloomScale;
+    uniform float bloomIntensity;
+    uniform float exposure;
+
+    vec3 aces(vec3 x) {
+        return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+    }
+
+    void main() {
+        vec3 hdr = texture(scene, uv * sceneScale).rgb + texture(bloom, uv * bloomScale).rgb * bloomIntensity;
+        vec3 color = aces(hdr * exposure);
+        FragColor = vec4(color, dot(color, vec3(0.299, 0.587, 0.114)));
+    }
+)glsl";
+
+// FXAA: blends along the local edge direction where the luma contrast is high enough
+static const char* fxaaFragmentShaderSource = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+
+    uniform sampler2D source; // Tonemapped, luma in alpha
+    uniform vec2 texelSize;
+    uniform vec2 uvScale; // Part of the source texture holding the image
+
+    const float spanMax = 8.0;
+    const float reduceMul = 1.0 / 8.0;
+    const float reduceMin = 1.0 / 128.0;
+
+    vec4 tap(vec2 coord) {
+        return texture(source, min(coord, uvScale - 0.5 * texelSize));
+    }
+
+    void main() {
+        vec2 at = uv * uvScale;
+        vec4 center = tap(at);
+        float lumaNW = tap(at + vec2(-1.0, -1.0) * texelSize).a;
+        float lumaNE = tap(at + vec2(1.0, -1.0) * texelSize).a;
+        float lumaSW = tap(at + vec2(-1.0, 1.0) * texelSize).a;
+        float lumaSE = tap(at + vec2(1.0, 1.0) * texelSize).a;
+        float lumaMin = min(center.a, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+        float lumaMax = max(center.a, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+        if (lumaMax - lumaMin < max(0.0312, lumaMax * 0.125)) {
+            FragColor = vec4(center.rgb, 1.0);
+            return;
+        }
+
+        vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+        float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * reduceMul, reduceMin);
+        float scale = 1.0 / (min(abs(direction.x), abs(direction.y)) + reduce);
+        direction = clamp(direction * scale, -spanMax, spanMax) * texelSize;
+
+        vec3 inner = 0.5 * (tap(at + direction * (1.0 / 3.0 - 0.5)).rgb +
+                            tap(at + direction * (2.0 / 3.0 - 0.5)).rgb);
+        vec3 outer = inner * 0.5 + 0.25 * (tap(at - direction * 0.5).rgb +
+                                           tap(at + direction * 0.5).rgb);
+        float lumaOuter = dot(outer, vec3(0.299, 0.587, 0.114));
+        FragColor = vec4((lumaOuter < lumaMin || lumaOuter > lumaMax) ? inner : outer, 1.0);
+    }
+)glsl";
+
+bool PostProcess::init()
+{
+    downsampleProgram = createShaderProgram(postVertexShaderSource, downsampleFragmentShaderSource, "Bloom downsample");
+    upsampleProgram = createShaderProgram(postVertexShaderSource, upsampleFragmentShaderSource, "Bloom upsample");
+    compositeProgram = createShaderProgram(postVertexShaderSource, compositeFragmentShaderSource, "Tonemap");
+    fxaaProgram = createShaderProgram(postVertexShaderSource, fxaaFragmentShaderSource, "FXAA");
+    if (!downsampleProgram || !upsampleProgram || !compositeProgram || !fxaaProgram) {
+        destroy();
+        return false;
+    }
+
+    downsampleTexelSizeLoc = glGetUniformLocation(downsampleProgram, "texelSize");
+    downsampleUvScaleLoc = glGetUniformLocation(downsampleProgram, "uvScale");
+    downsamplePrefilterLoc = glGetUniformLocation(downsampleProgram, "prefilter");
+    downsampleThresholdLoc = glGetUniformLocation(downsampleProgram, "threshold");
+    downsampleKneeLoc = glGetUniformLocation(downsampleProgram, "knee");
+    upsampleTexelSizeLoc = glGetUniformLocation(upsampleProgram, "texelSize");
+    upsampleUvScaleLoc = glGetUniformLocation(upsampleProgram, "uvScale");
+    compositeSceneScaleLoc = glGetUniformLocation(compositeProgram, "sceneScale");
+    compositeBloomScaleLoc = glGetUniformLocation(compositeProgram, "bloomScale");
+    compositeBloomIntensityLoc = glGetUniformLocation(compositeProgram, "bloomIntensity");
+    compositeExposureLoc = glGetUniformLocation(compositeProgram, "exposure");
+    fxaaTexelSizeLoc = glGetUniformLocation(fxaaProgram, "texelSize");
+    fxaaUvScaleLoc = glGetUniformLocation(fxaaProgram, "uvScale");
+
+    glUseProgram(compositeProgram);
+    glUniform1i(glGetUniformLocation(compositeProgram, "scene"), 0);
+    glUniform1i(glGetUniformLocation(compositeProgram, "bloom"), 1);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &VAO);
+    return true;
+}
+
+void PostProcess::destroy()
+{
+    glDeleteProgram(downsampleProgram);
+    glDeleteProgram(upsampleProgram);
+    glDeleteProgram(compositeProgram);
+    glDeleteProgram(fxaaProgram);
+    glDeleteVertexArrays(1, &VAO);
+    downsampleProgram = upsampleProgram = compositeProgram = fxaaProgram = 0;
+    VAO = 0;
+}
+
+void PostProcess::beginPass(bool blend) const
+{
+    glDisable(GL_DEPTH_TEST);
+    if (blend) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    glBindVertexArray(VAO);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void PostProcess::endOutputPass() const
+{
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+RenderResource PostProcess::addPasses(RenderGraph& graph, const RenderTarget& scene, RenderResource sceneColor, RenderResource output)
+{
+    static const char* levelNames[maxBloomLevels] = { "Bloom 1/2", "Bloom 1/4", "Bloom 1/8", "Bloom 1/16", "Bloom 1/32", "Bloom 1/64" };
+    static const char* downsampleNames[maxBloomLevels] = { "Bloom down 1/2", "Bloom down 1/4", "Bloom down 1/8",
+                                                           "Bloom down 1/16", "Bloom down 1/32", "Bloom down 1/64" };
+    static const char* upsampleNames[maxBloomLevels] = { "Bloom up 1/2", "Bloom up 1/4", "Bloom up 1/8",
+                                                         "Bloom up 1/16", "Bloom up 1/32", "Bloom up 1/64" };
+
+    // Targets are sized from the whole scene target and the image fills the bottom-left part of
+    // each, like the scene's viewport, so a change of render size reuses the same targets.
+    // Index 0 is the scene, index i + 1 bloom level i.
+    int regionWidths[maxBloomLevels + 1] = { scene.viewportWidth() };
+    int regionHeights[maxBloomLevels + 1] = { scene.viewportHeight() };
+
+    // Bloom chain: down from the scene a level at a time, then back up adding into each level.
+    // The chain is always declared; with bloom off nothing reads it and the graph culls it.
+    RenderResource levels[maxBloomLevels];
+    int levelCount = 0;
+    while (levelCount < std::min(bloomLevels, maxBloomLevels) && regionWidths[levelCount] / 2 >= 2 && regionHeights[levelCount] / 2 >= 2) {
+        regionWidths[levelCount + 1] = regionWidths[levelCount] / 2;
+        regionHeights[levelCount + 1] = regionHeights[levelCount] / 2;
+        levels[levelCount] = graph.createTexture(levelNames[levelCount], scene.width() >> (levelCount + 1),
+                                                 scene.height() >> (levelCount + 1), GL_R11F_G11F_B10F);
+        levelCount++;
+    }
+
+    // The execute functions are built before addPass runs setup, so they capture handles taken
+    // here rather than the versions setup returns; physical lookups only need the resource.
+    for (int i = 0; i < levelCount; i++) {
+        const RenderResource source = i == 0 ? sceneColor : levels[i - 1];
+        const RenderResource target = levels[i];
+        const int sourceWidth = regionWidths[i], sourceHeight = regionHeights[i];
+        const int targetWidth = regionWidths[i + 1], targetHeight = regionHeights[i + 1];
+        graph.addPass(downsampleNames[i],
+            [&](RenderPassBuilder& builder) {
+                builder.read(source);
+                levels[i] = builder.write(levels[i]);
+            },
+            [this, source, target, sourceWidth, sourceHeight, targetWidth, targetHeight, i](RenderGraph& graph) {
+                const bool first = i == 0;
+                beginPass(false);
+                graph.bindTarget(target);
+                glViewport(0, 0, targetWidth, targetHeight);
+                glUseProgram(downsampleProgram);
+                glUniform1f(downsampleThresholdLoc, bloomThreshold);
+                glUniform1f(downsampleKneeLoc, std::max(bloomKnee, 1e-4f));
+                glBindTexture(GL_TEXTURE_2D, graph.texture(source));
+                glUniform2f(downsampleTexelSizeLoc, 1.0f / graph.width(source), 1.0f / graph.height(source));
+                glUniform2f(downsampleUvScaleLoc, (float)sourceWidth / graph.width(source), (float)sourceHeight / graph.height(source));
+                glUniform1i(downsamplePrefilterLoc, first ? 1 : 0);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            });
+    }
+
+    for (int i = levelCount - 1; i > 0; i--) {
+        const RenderResource source = levels[i];
+        const RenderResource target = levels[i - 1];
+        const int sourceWidth = regionWidths[i + 1], sourceHeight = regionHeights[i + 1];
+        const int targetWidth = regionWidths[i], targetHeight = regionHeights[i];
+        graph.addPass(upsampleNames[i - 1],
+            [&](RenderPassBuilder& builder) {
+                builder.read(source);
+                builder.read(levels[i - 1]); // Blended into
+                levels[i - 1] = builder.write(levels[i - 1]);
+            },
+            [this, source, target, sourceWidth, sourceHeight, targetWidth, targetHeight](RenderGraph& graph) {
+                beginPass(true);
+                graph.bindTarget(target);
+                glViewport(0, 0, targetWidth, targetHeight);
+                glUseProgram(upsampleProgram);
+                glBindTexture(GL_TEXTURE_2D, graph.texture(source));
+                glUniform2f(upsampleTexelSizeLoc, 1.0f / graph.width(source), 1.0f / graph.height(source));
+                glUniform2f(upsampleUvScaleLoc, (float)sourceWidth / graph.width(source), (float)sourceHeight / graph.height(source));
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            });
+    }
+
+    // Tonemap at render resolution for FXAA, or straight to the window
+    const RenderResource bloom = bloomEnabled && levelCount > 0 ? levels[0] : RenderResource();
+    const int bloomWidth = regionWidths[1], bloomHeight = regionHeights[1];
+    const int sceneWidth = regionWidths[0], sceneHeight = regionHeights[0];
+    RenderResource tonemapped = fxaaEnabled ? graph.createTexture("Tonemapped", scene.width(), scene.height(), GL_RGBA8) : output;
+    const RenderResource tonemapTarget = tonemapped;
+    const bool direct = !fxaaEnabled;
+    graph.addPass("Tonemap",
+        [&](RenderPassBuilder& builder) {
+            builder.read(sceneColor);
+            builder.read(bloom);
+            tonemapped = builder.write(tonemapped);
+            if (direct)
+                builder.sideEffect();
+        },
+        [this, sceneColor, bloom, bloomWidth, bloomHeight, sceneWidth, sceneHeight, tonemapTarget, direct](RenderGraph& graph) {
+            beginPass(false);
+            graph.bindTarget(tonemapTarget);
+            if (!direct)
+                glViewport(0, 0, sceneWidth, sceneHeight);
+            glUseProgram(compositeProgram);
+            glUniform2f(compositeSceneScaleLoc, (float)sceneWidth / graph.width(sceneColor), (float)sceneHeight / graph.height(sceneColor));
+            if (bloom.valid())
+                glUniform2f(compositeBloomScaleLoc, (float)bloomWidth / graph.width(bloom), (float)bloomHeight / graph.height(bloom));
+            glUniform1f(compositeBloomIntensityLoc, bloom.valid() ? bloomIntensity : 0.0f);
+            glUniform1f(compositeExposureLoc, exposure);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(sceneColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(bloom.valid() ? bloom : sceneColor));
+            glActiveTexture(GL_TEXTURE0);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            if (direct)
+                endOutputPass();
+        });
+    if (direct)
+        return tonemapped;
+
+    // FXAA, upscaling to the window on the way
+    const RenderResource fxaaTarget = output;
+    graph.addPass("FXAA",
+        [&](RenderPassBuilder& builder) {
+            builder.read(tonemapped);
+            output = builder.write(output);
+            builder.sideEffect();
+        },
+        [this, tonemapped, sceneWidth, sceneHeight, fxaaTarget](RenderGraph& graph) {
+            beginPass(false);
+            graph.bindTarget(fxaaTarget);
+            glUseProgram(fxaaProgram);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(tonemapped));
+            glUniform2f(fxaaTexelSizeLoc, 1.0f / graph.width(tonemapped), 1.0f / graph.height(tonemapped));
+            glUniform2f(fxaaUvScaleLoc, (float)sceneWidth / graph.width(tonemapped), (float)sceneHeight / graph.height(tonemapped));
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            endOutputPass();
+        });
+    return output;
+}
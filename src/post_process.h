@@ -0,0 +1,60 @@
+#pragma once
+
+#include "render_graph.h"
+#include "render_target.h"
+
+// HDR scene to the window: bloom, tonemapping and FXAA.
+//
+// Passes are fused wherever they read the same pixels, to save bandwidth on integrated GPUs:
+// the bright-pass threshold runs inside the first bloom downsample, each upsample adds into the
+// next level up through blending instead of a separate combine, and bloom composite, exposure,
+// tonemapping and the luma FXAA needs are one pass. FXAA also does the upscale to the window.
+// Without FXAA the tonemap pass writes to the window directly. That is 2 * levels - 1 bloom
+// passes at half resolution and below, plus one or two full-size ones. The passes are added to
+// the frame's render graph, which culls the bloom chain when bloom is off and places the
+// intermediate targets.
+class PostProcess
+{
+public:
+    static const int maxBloomLevels = 6;
+
+    bool bloomEnabled = true;
+    int bloomLevels = 5;          // Each half the size of the one before, starting at half resolution
+    float bloomThreshold = 1.0f;  // HDR brightness where bloom starts, eased in over the knee
+    float bloomKnee = 0.5f;
+    float bloomIntensity = 0.3f;
+    float exposure = 1.0f;
+    bool fxaaEnabled = true;
+
+    bool init();
+    void destroy();
+
+    // Reads sceneColor (the scene target's viewport region) and draws the finished frame into
+    // output, filling all of it. Returns output's new version. The last pass leaves depth
+    // testing on and blending off.
+    RenderResource addPasses(RenderGraph& graph, const RenderTarget& scene, RenderResource sceneColor, RenderResource output);
+
+private:
+    unsigned int downsampleProgram = 0;
+    unsigned int upsampleProgram = 0;
+    unsigned int compositeProgram = 0;
+    unsigned int fxaaProgram = 0;
+    unsigned int VAO = 0; // Empty; core profile needs one bound to draw
+
+    int downsampleTexelSizeLoc = -1;
+    int downsampleUvScaleLoc = -1;
+    int downsamplePrefilterLoc = -1;
+    int downsampleThresholdLoc = -1;
+    int downsampleKneeLoc = -1;
+    int upsampleTexelSizeLoc = -1;
+    int upsampleUvScaleLoc = -1;
+    int compositeSceneScaleLoc = -1;
+    int compositeBloomScaleLoc = -1;
+    int compositeBloomIntensityLoc = -1;
+    int compositeExposureLoc = -1;
+    int fxaaTexelSizeLoc = -1;
+    int fxaaUvScaleLoc = -1;
+
+    void beginPass(bool blend) const;
+    void endOutputPass() const; // Restores the state the rest of the frame expects
+};
@@ -0,0 +1,42 @@
+#include "profiler_overlay.h"
+#include "text.h"
+
+#include <cstdarg>
+#include <algorithm>
+#include <cstdio>
+
+void ProfilerOverlay::beginFrame()
+{
+    used = 0;
+    lineCount = 0;
+}
+
+void ProfilerOverlay::addLine(const char* format, ...)
+{
+    if (lineCount >= maxLines || used >= sizeof(buffer))
+        return;
+
+    va_list args;
+    va_start(args, format);
+    int written = std::vsnprintf(buffer + used, sizeof(buffer) - used, format, args);
+    va_end(args);
+    if (written < 0)
+        return;
+
+    lines[lineCount++] = buffer + used;
+    used += std::min((size_t)written + 1, sizeof(buffer) - used);
+}
+
+void ProfilerOverlay::draw(TextRenderer& text, int screenWidth, int screenHeight, LinearArena& arena) const
+{
+    if (!visible)
+        return;
+
+    const float scale = 0.35f;
+    const glm::vec3 color(0.9f, 1.0f, 0.6f);
+    float y = screenHeight - text.lineHeight(scale);
+    for (int i = 0; i < lineCount; i++) {
+        text.draw(lines[i], 8.0f, y, scale, color, screenWidth, screenHeight, arena);
+        y -= text.lineHeight(scale);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+class LinearArena;
+class TextRenderer;
+
+// Lines of stats drawn in the top left corner, rebuilt every frame. Text is formatted into a
+// fixed buffer, so filling the overlay does not allocate.
+class ProfilerOverlay
+{
+public:
+    static const int maxLines = 32;
+
+    bool visible = false;
+
+    void beginFrame();
+
+    // printf-style; lines past maxLines or the buffer are dropped
+    void addLine(const char* format, ...);
+
+    void draw(TextRenderer& text, int screenWidth, int screenHeight, LinearArena& arena) const;
+
+private:
+    char buffer[4096];
+    size_t used = 0;
+    const char* lines[maxLines];
+    int lineCount = 0;
+};
@@ -0,0 +1,253 @@
+#include "projectiles.h"
+#include "job_system.h"
+#include "shader.h"
+#include "ships.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROJECTILE_SSE 1
+#endif
+
+static const char* projectileVertexShaderSource = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec2 aCorner;
+    layout(location = 1) in vec4 aInstance; // xyz position, w = 1 for player shots
+
+    uniform mat4 view;
+    uniform mat4 projection;
+    uniform float radius;
+
+    out vec2 Corner;
+    flat out float Player;
+
+    void main() {
+        // Expand in view space so the quad always faces the camera
+        vec4 center = view * vec4(aInstance.xyz, 1.0);
+        Corner = aCorner;
+        Player = aInstance.w;
+        gl_Position = projection * (center + vec4(aCorner * radius, 0.0, 0.0));
+    }
+)glsl";
+
+static const char* projectileFragmentShaderSource = R"glsl(
+    #version 330 core
+    out vec4 FragColor;
+
+    in vec2 Corner;
+    flat in float Player;
+
+    void main() {
+        float d = dot(Corner, Corner);
+        if (d > 1.0)
+            discard;
+        vec3 color = Player > 0.5 ? vec3(0.4, 0.9, 1.0) : vec3(1.0, 0.5, 0.2);
+        FragColor = vec4(mix(vec3(1.0), color, d), 1.0);
+    }
+)glsl";
+
+bool ProjectileSystem::init(size_t capacity)
+{
+    maxCount = capacity;
+    count = 0;
+
+    const size_t padded = (capacity + 3) & ~(size_t)3;
+    positionX.assign(padded, 0.0f);
+    positionY.assign(padded, 0.0f);
+    positionZ.assign(padded, 0.0f);
+    velocityX.assign(padded, 0.0f);
+    velocityY.assign(padded, 0.0f);
+    velocityZ.assign(padded, 0.0f);
+    lifetime.assign(padded, 0.0f);
+    owner.assign(capacity, 0);
+    hitShip.assign(capacity, -1);
+    hitPoint.assign(capacity, glm::vec3(0.0f));
+    hitList.clear();
+    hitList.reserve(capacity);
+    instanceData.assign(capacity, glm::vec4(0.0f));
+
+    program = createShaderProgram(projectileVertexShaderSource, projectileFragmentShaderSource, "Projectile");
+    if (!program)
+        return false;
+    viewLoc = glGetUniformLocation(program, "view");
+    projectionLoc = glGetUniformLocation(program, "projection");
+    radiusLoc = glGetUniformLocation(program, "radius");
+
+    const float corners[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &quadVBO);
+    glGenBuffers(1, &instanceVBO);
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+
+    glBindVertexArray(0);
+    checkGLError("Projectile setup error");
+    return true;
+}
+
+void ProjectileSystem::destroy()
+{
+    if (program)
+        glDeleteProgram(program);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteBuffers(1, &instanceVBO);
+    program = VAO = quadVBO = instanceVBO = 0;
+    count = 0;
+}
+
+bool ProjectileSystem::spawn(const glm::vec3& position, const glm::vec3& velocity, float life, uint32_t shooter)
+{
+    if (count == maxCount)
+        return false;
+
+    size_t i = count++;
+    positionX[i] = position.x;
+    positionY[i] = position.y;
+    positionZ[i] = position.z;
+    velocityX[i] = velocity.x;
+    velocityY[i] = velocity.y;
+    velocityZ[i] = velocity.z;
+    lifetime[i] = life;
+    owner[i] = shooter;
+    return true;
+}
+
+// Moves the last live projectile into the hole, so live entries stay packed at the front
+void ProjectileSystem::remove(size_t index)
+{
+    size_t last = --count;
+    positionX[index] = positionX[last];
+    positionY[index] = positionY[last];
+    positionZ[index] = positionZ[last];
+    velocityX[index] = velocityX[last];
+    velocityY[index] = velocityY[last];
+    velocityZ[index] = velocityZ[last];
+    lifetime[index] = lifetime[last];
+    owner[index] = owner[last];
+    hitShip[index] = hitShip[last];
+    hitPoint[index] = hitPoint[last];
+}
+
+void ProjectileSystem::update(float dt, const ShipWorld& ships, JobSystem& jobs)
+{
+    hitList.clear();
+    if (count == 0)
+        return;
+
+    // Integrate; the padding lanes past count are harmless garbage
+    size_t i = 0;
+#ifdef PROJECTILE_SSE
+    const __m128 step = _mm_set1_ps(dt);
+    for (; i + 4 <= count + 3; i += 4) {
+        _mm_storeu_ps(&positionX[i], _mm_add_ps(_mm_loadu_ps(&positionX[i]), _mm_mul_ps(_mm_loadu_ps(&velocityX[i]), step)));
+        _mm_storeu_ps(&positionY[i], _mm_add_ps(_mm_loadu_ps(&positionY[i]), _mm_mul_ps(_mm_loadu_ps(&velocityY[i]), step)));
+        _mm_storeu_ps(&positionZ[i], _mm_add_ps(_mm_loadu_ps(&positionZ[i]), _mm_mul_ps(_mm_loadu_ps(&velocityZ[i]), step)));
+        _mm_storeu_ps(&lifetime[i], _mm_sub_ps(_mm_loadu_ps(&lifetime[i]), step));
+    }
+#endif
+    for (; i < count; i++) {
+        positionX[i] += velocityX[i] * dt;
+        positionY[i] += velocityY[i] * dt;
+        positionZ[i] += velocityZ[i] * dt;
+        lifetime[i] -= dt;
+    }
+
+    // Sweep each projectile's path over this step against the ships, keeping the earliest hit
+    const float hitRadius = ships.boundingRadius + radius;
+    jobs.parallelFor((uint32_t)count, 256, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t p = begin; p < end; p++) {
+            glm::vec3 to(positionX[p], positionY[p], positionZ[p]);
+            glm::vec3 from = to - glm::vec3(velocityX[p], velocityY[p], velocityZ[p]) * dt;
+            glm::vec3 path = to - from;
+            float pathLengthSquared = glm::dot(path, path);
+
+            int32_t closestShip = -1;
+            float closestT = FLT_MAX;
+            ships.tree.querySegment(from, to, radius, [&](int32_t proxy) {
+                uint32_t ship = ships.tree.userData(proxy);
+                if (ship == owner[p])
+                    return true;
+
+                // Segment against the ship's bounding sphere grown by the projectile radius
+                glm::vec3 m = from - ships.worldCenters[ship];
+                float b = glm::dot(m, path);
+                float c = glm::dot(m, m) - hitRadius * hitRadius;
+                float t = 0.0f;
+                if (c > 0.0f) {
+                    float discriminant = b * b - pathLengthSquared * c;
+                    if (b > 0.0f || discriminant < 0.0f || pathLengthSquared <= 0.0f)
+                        return true;
+                    t = (-b - std::sqrt(discriminant)) / pathLengthSquared;
+                    if (t > 1.0f)
+                        return true;
+                }
+                if (t < closestT) {
+                    closestT = t;
+                    closestShip = (int32_t)ship;
+                }
+                return true;
+            });
+
+            hitShip[p] = closestShip;
+            if (closestShip >= 0)
+                hitPoint[p] = from + path * closestT;
+        }
+    });
+
+    // Retire from the back so swapped-in entries have already been checked
+    for (size_t p = count; p-- > 0; ) {
+        if (hitShip[p] >= 0) {
+            hitList.push_back(ProjectileHit{ owner[p], (uint32_t)hitShip[p], hitPoint[p] });
+            remove(p);
+        } else if (lifetime[p] <= 0.0f) {
+            remove(p);
+        }
+    }
+}
+
+void ProjectileSystem::draw(const glm::mat4& view, const glm::mat4& projection)
+{
+    if (count == 0 || !program)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+        instanceData[i] = glm::vec4(positionX[i], positionY[i], positionZ[i], owner[i] == 0 ? 1.0f : 0.0f);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, maxCount * sizeof(glm::vec4), NULL, GL_STREAM_DRAW); // Orphan
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), instanceData.data());
+
+    glUseProgram(program);
+    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1f(radiusLoc, radius);
+
+    glBindVertexArray(VAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+    glBindVertexArray(0);
+}
+
+void ProjectileSystem::rebase(const glm::vec3& shift)
+{
+    for (size_t i = 0; i < count; i++) {
+        positionX[i] -= shift.x;
+        positionY[i] -= shift.y;
+        positionZ[i] -= shift.z;
+    }
+}
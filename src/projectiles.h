@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+struct ShipWorld;
+
+// A projectile that ran into a ship during the last update
+struct ProjectileHit
+{
+    uint32_t owner; // Ship that fired it
+    uint32_t ship;  // Ship that was hit
+    glm::vec3 point;
+};
+
+// Fixed-capacity projectile pool stored as parallel float arrays.
+//
+// All storage is allocated by init; spawning, expiry (swap-remove with the last live entry) and
+// hit reporting never touch the heap. Integration runs four projectiles at a time with SSE, and
+// each projectile's path over the step is swept against the ship spatial index, so fast shots
+// can't tunnel through a ship between frames. Everything is drawn with one instanced call of
+// camera-facing quads.
+class ProjectileSystem
+{
+public:
+    float radius = 0.15f; // Collision radius and half-size of the quad
+
+    bool init(size_t capacity);
+    void destroy();
+
+    // Returns false when the pool is full; the shot is dropped
+    bool spawn(const glm::vec3& position, const glm::vec3& velocity, float lifetime, uint32_t owner);
+
+    // Moves every projectile by dt, removes expired ones and ones that hit a ship other than
+    // their owner. Ship bounds and the spatial index must be up to date.
+    void update(float dt, const ShipWorld& ships, JobSystem& jobs);
+
+    void draw(const glm::mat4& view, const glm::mat4& projection);
+
+    // Floating-origin rebase: moves every projectile by -shift
+    void rebase(const glm::vec3& shift);
+
+    size_t size() const { return count; }
+    size_t capacity() const { return maxCount; }
+    const std::vector<ProjectileHit>& hits() const { return hitList; }
+
+private:
+    void remove(size_t index);
+
+    size_t count = 0;
+    size_t maxCount = 0;
+
+    // Padded to a multiple of four for the SIMD loops
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> lifetime;
+    std::vector<uint32_t> owner;
+
+    // Written by the collision pass, one entry per projectile
+    std::vector<int32_t> hitShip;
+    std::vector<glm::vec3> hitPoint;
+    std::vector<ProjectileHit> hitList;
+
+    // Instance stream: position and owner flag (1 for the player)
+    std::vector<glm::vec4> instanceData;
+
+    unsigned int program = 0;
+    unsigned int VAO = 0;
+    unsigned int quadVBO = 0;
+    unsigned int instanceVBO = 0;
+    int viewLoc = -1;
+    int projectionLoc = -1;
+    int radiusLoc = -1;
+};
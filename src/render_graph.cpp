@@ -0,0 +1,307 @@
+#include "render_graph.h"
+#include "render_target.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char* formatName(GLenum format)
+{
+    switch (format) {
+    case GL_RGBA8: return "RGBA8";
+    case GL_RGBA16F: return "RGBA16F";
+    case GL_R11F_G11F_B10F: return "R11F_G11F_B10F";
+    case GL_DEPTH_COMPONENT32F: return "DEPTH32F";
+    case GL_DEPTH_COMPONENT24: return "DEPTH24";
+    default: return "?";
+    }
+}
+
+}
+
+RenderResource RenderPassBuilder::read(RenderResource resource)
+{
+    if (!resource.valid())
+        return resource;
+    RenderGraph::Access access = { resource, pass, false };
+    graph.accesses.push_back(access);
+    graph.passes[pass].accessCount++;
+    return resource;
+}
+
+RenderResource RenderPassBuilder::write(RenderResource resource)
+{
+    if (!resource.valid())
+        return resource;
+    RenderGraph::Resource& target = graph.resources[resource.index];
+    if (resource.version != target.latestVersion)
+        std::cerr << "Render graph: " << graph.passes[pass].name << " writes an old version of " << target.name << std::endl;
+
+    RenderResource produced = { resource.index, ++target.latestVersion };
+    RenderGraph::Access access = { produced, pass, true };
+    graph.accesses.push_back(access);
+    graph.passes[pass].accessCount++;
+    return produced;
+}
+
+void RenderPassBuilder::sideEffect()
+{
+    graph.passes[pass].sideEffect = true;
+}
+
+void RenderGraph::beginFrame(LinearArena& frameArena)
+{
+    arena = &frameArena;
+    resources.clear();
+    passes.clear();
+    accesses.clear();
+    edges.clear();
+    order.clear();
+    slots.clear();
+    requestedBytes = aliasedBytes = 0;
+}
+
+RenderResource RenderGraph::createTexture(const char* name, int width, int height, GLenum format)
+{
+    Resource resource = { name, width, height, format, false, 0, 0, 0, -1, -1, -1 };
+    resources.push_back(resource);
+    RenderResource handle = { (int32_t)resources.size() - 1, 0 };
+    return handle;
+}
+
+RenderResource RenderGraph::importTexture(const char* name, unsigned int framebuffer, unsigned int texture, int width, int height,
+                                          GLenum format)
+{
+    Resource resource = { name, width, height, format, true, framebuffer, texture, 0, -1, -1, -1 };
+    resources.push_back(resource);
+    RenderResource handle = { (int32_t)resources.size() - 1, 0 };
+    return handle;
+}
+
+uint32_t RenderGraph::beginPass(const char* name)
+{
+    Pass pass = { name, (uint32_t)accesses.size(), 0, false, false, nullptr, nullptr };
+    passes.push_back(pass);
+    return (uint32_t)passes.size() - 1;
+}
+
+int32_t RenderGraph::producerOf(RenderResource resource) const
+{
+    for (const Access& access : accesses) {
+        if (access.write && access.resource.index == resource.index && access.resource.version == resource.version)
+            return (int32_t)access.pass;
+    }
+    return -1;
+}
+
+void RenderGraph::addEdge(uint32_t from, uint32_t to, bool data)
+{
+    if (from == to)
+        return;
+    Edge edge = { from, to, data };
+    edges.push_back(edge);
+}
+
+void RenderGraph::compile()
+{
+    // Dependencies: a read waits for the write that produced its version; a write waits for the
+    // previous version's writer and for every pass still reading that version
+    edges.clear();
+    for (const Access& access : accesses) {
+        if (!access.write) {
+            int32_t producer = producerOf(access.resource);
+            if (producer >= 0)
+                addEdge((uint32_t)producer, access.pass, true);
+            else if (access.resource.version > 0 || !resources[access.resource.index].imported)
+                std::cerr << "Render graph: " << passes[access.pass].name << " reads " << resources[access.resource.index].name
+                          << " before anything writes it" << std::endl;
+            continue;
+        }
+
+        RenderResource previous = { access.resource.index, access.resource.version - 1 };
+        int32_t producer = producerOf(previous);
+        if (producer >= 0)
+            addEdge((uint32_t)producer, access.pass, true);
+        for (const Access& reader : accesses) {
+            if (!reader.write && reader.resource.index == previous.index && reader.resource.version == previous.version)
+                addEdge(reader.pass, access.pass, false);
+        }
+    }
+
+    // Cull: keep passes with side effects and, transitively, whatever feeds them data
+    scratch.clear();
+    for (uint32_t p = 0; p < passes.size(); p++) {
+        passes[p].alive = passes[p].sideEffect;
+        if (passes[p].alive)
+            scratch.push_back(p);
+    }
+    while (!scratch.empty()) {
+        uint32_t p = scratch.back();
+        scratch.pop_back();
+        for (const Edge& edge : edges) {
+            if (edge.data && edge.to == p && !passes[edge.from].alive) {
+                passes[edge.from].alive = true;
+                scratch.push_back(edge.from);
+            }
+        }
+    }
+
+    // Order: topological over the live passes, earliest declared first among the ready ones
+    scratch.assign(passes.size(), 0);
+    uint32_t aliveCount = 0;
+    for (uint32_t p = 0; p < passes.size(); p++)
+        aliveCount += passes[p].alive ? 1 : 0;
+    for (const Edge& edge : edges) {
+        if (passes[edge.from].alive && passes[edge.to].alive)
+            scratch[edge.to]++;
+    }
+    order.clear();
+    for (;;) {
+        uint32_t next = (uint32_t)passes.size();
+        for (uint32_t p = 0; p < passes.size(); p++) {
+            if (passes[p].alive && scratch[p] == 0) {
+                next = p;
+                break;
+            }
+        }
+        if (next == passes.size())
+            break;
+        order.push_back(next);
+        scratch[next] = UINT32_MAX; // Scheduled
+        for (const Edge& edge : edges) {
+            if (edge.from == next && passes[edge.to].alive && scratch[edge.to] != UINT32_MAX)
+                scratch[edge.to]--;
+        }
+    }
+    if (order.size() != aliveCount) {
+        std::cerr << "Render graph: dependency cycle, running the remaining passes in declaration order" << std::endl;
+        for (uint32_t p = 0; p < passes.size(); p++) {
+            if (passes[p].alive && scratch[p] != UINT32_MAX)
+                order.push_back(p);
+        }
+    }
+
+    // Lifetimes in execution order
+    for (Resource& resource : resources) {
+        resource.firstUse = resource.lastUse = -1;
+        resource.slot = -1;
+    }
+    for (int32_t position = 0; position < (int32_t)order.size(); position++) {
+        const Pass& pass = passes[order[position]];
+        for (uint32_t a = pass.firstAccess; a < pass.firstAccess + pass.accessCount; a++) {
+            Resource& resource = resources[accesses[a].resource.index];
+            if (resource.firstUse < 0)
+                resource.firstUse = position;
+            resource.lastUse = position;
+        }
+    }
+
+    // Alias: give each transient, earliest first, a target of the same size and format whose
+    // previous user is finished before it starts
+    scratch.clear();
+    for (uint32_t r = 0; r < resources.size(); r++) {
+        if (!resources[r].imported && resources[r].firstUse >= 0)
+            scratch.push_back(r);
+    }
+    std::sort(scratch.begin(), scratch.end(), [this](uint32_t a, uint32_t b) { return resources[a].firstUse < resources[b].firstUse; });
+    for (uint32_t r : scratch) {
+        Resource& resource = resources[r];
+        requestedBytes += (size_t)resource.width * resource.height * bytesPerTexel(resource.format);
+        for (uint32_t s = 0; s < slots.size(); s++) {
+            Slot& slot = slots[s];
+            if (slot.width == resource.width && slot.height == resource.height && slot.format == resource.format &&
+                slot.lastUse < resource.firstUse) {
+                resource.slot = (int32_t)s;
+                slot.lastUse = resource.lastUse;
+                break;
+            }
+        }
+        if (resource.slot < 0) {
+            Slot slot = { resource.width, resource.height, resource.format, resource.lastUse, TransientTarget() };
+            slots.push_back(slot);
+            resource.slot = (int32_t)slots.size() - 1;
+            aliasedBytes += (size_t)resource.width * resource.height * bytesPerTexel(resource.format);
+        }
+    }
+}
+
+void RenderGraph::execute(RenderTargetPool& pool)
+{
+    for (Slot& slot : slots)
+        slot.target = pool.acquire(slot.width, slot.height, slot.format);
+
+    for (uint32_t p : order)
+        passes[p].run(passes[p].context, *this);
+
+    for (Slot& slot : slots) {
+        if (slot.target.valid())
+            pool.release(slot.target);
+    }
+}
+
+unsigned int RenderGraph::texture(RenderResource resource) const
+{
+    const Resource& r = resources[resource.index];
+    if (r.imported)
+        return r.importedTexture;
+    return r.slot >= 0 ? slots[r.slot].target.texture : 0;
+}
+
+unsigned int RenderGraph::framebuffer(RenderResource resource) const
+{
+    const Resource& r = resources[resource.index];
+    if (r.imported)
+        return r.importedFramebuffer;
+    return r.slot >= 0 ? slots[r.slot].target.framebuffer : 0;
+}
+
+void RenderGraph::bindTarget(RenderResource resource) const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer(resource));
+    glViewport(0, 0, width(resource), height(resource));
+}
+
+bool RenderGraph::writeGraphviz(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+
+    file << "digraph RenderGraph {\n";
+    file << "    rankdir=LR;\n";
+    file << "    node [fontname=\"Consolas\", fontsize=10];\n";
+    for (uint32_t p = 0; p < passes.size(); p++) {
+        const Pass& pass = passes[p];
+        file << "    pass" << p << " [shape=box, label=\"" << pass.name;
+        if (pass.alive) {
+            auto position = std::find(order.begin(), order.end(), p) - order.begin();
+            file << "\\n#" << position << "\", style=bold";
+        } else {
+            file << "\\nculled\", style=dashed, fontcolor=gray";
+        }
+        file << "];\n";
+    }
+
+    for (const Access& access : accesses) {
+        const Resource& resource = resources[access.resource.index];
+        file << "    r" << access.resource.index << "_" << access.resource.version << " [shape=ellipse, label=\"" << resource.name
+             << " v" << access.resource.version << "\\n" << resource.width << "x" << resource.height << " " << formatName(resource.format);
+        if (resource.imported)
+            file << "\\nimported\", style=filled, fillcolor=lightgrey];\n";
+        else if (resource.slot >= 0)
+            file << "\\ntarget " << resource.slot << "\"];\n";
+        else
+            file << "\"];\n";
+
+        if (access.write)
+            file << "    pass" << access.pass << " -> r" << access.resource.index << "_" << access.resource.version << ";\n";
+        else
+            file << "    r" << access.resource.index << "_" << access.resource.version << " -> pass" << access.pass << ";\n";
+    }
+    file << "}\n";
+    return (bool)file;
+}
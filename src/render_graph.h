@@ -0,0 +1,169 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "frame_arena.h"
+#include "render_target_pool.h"
+
+// One version of a graph texture. Every write makes a new version, so a read names exactly the
+// write it depends on and the graph can order passes without relying on declaration order.
+struct RenderResource
+{
+    int32_t index = -1;
+    int32_t version = 0;
+
+    bool valid() const { return index >= 0; }
+};
+
+class RenderGraph;
+
+// Given to a pass's setup function to declare what the pass touches
+class RenderPassBuilder
+{
+public:
+    RenderResource read(RenderResource resource);
+
+    // Returns the version this pass produces; later readers and writers use that one
+    RenderResource write(RenderResource resource);
+
+    // Keeps the pass even when nothing in the graph reads its output (presenting to the window,
+    // data the next frame consumes)
+    void sideEffect();
+
+private:
+    friend class RenderGraph;
+    RenderPassBuilder(RenderGraph& renderGraph, uint32_t passIndex) : graph(renderGraph), pass(passIndex) {}
+
+    RenderGraph& graph;
+    uint32_t pass;
+};
+
+// Frame graph, rebuilt every frame. Passes declare the textures they read and write; compile()
+// drops passes whose output nothing needs, orders the rest by their dependencies and maps each
+// transient texture to a pooled render target, sharing one target between textures of the same
+// size and format whose lifetimes do not overlap. execute() acquires the targets and runs the
+// passes. Imported textures (the scene target, the window) are owned elsewhere.
+//
+// Pass functions are copied into the frame arena and graph storage keeps its capacity, so a
+// steady frame builds its graph without touching the heap.
+class RenderGraph
+{
+public:
+    void beginFrame(LinearArena& arena);
+
+    RenderResource createTexture(const char* name, int width, int height, GLenum format);
+    // framebuffer 0 is the window; texture may be 0 for resources only used for ordering
+    RenderResource importTexture(const char* name, unsigned int framebuffer, unsigned int texture, int width, int height, GLenum format);
+
+    // setup(RenderPassBuilder&) runs now; execute(RenderGraph&) runs in execute() if the pass survives
+    template <typename Setup, typename Execute>
+    void addPass(const char* name, Setup&& setup, Execute&& execute)
+    {
+        typedef typename std::decay<Execute>::type Function;
+        static_assert(std::is_trivially_destructible<Function>::value, "pass functions live in the frame arena and are never destroyed");
+
+        uint32_t index = beginPass(name);
+        RenderPassBuilder builder(*this, index);
+        setup(builder);
+        void* storage = arena->allocate(sizeof(Function), alignof(Function));
+        passes[index].context = new (storage) Function(std::forward<Execute>(execute));
+        passes[index].run = [](void* context, RenderGraph& graph) { (*static_cast<Function*>(context))(graph); };
+    }
+
+    void compile();
+    void execute(RenderTargetPool& pool);
+
+    // Physical target of a resource, valid while its passes execute. Any version of the resource
+    // names the same target, so execute functions can use handles taken before setup ran.
+    unsigned int texture(RenderResource resource) const;
+    unsigned int framebuffer(RenderResource resource) const;
+    int width(RenderResource resource) const { return resources[resource.index].width; }
+    int height(RenderResource resource) const { return resources[resource.index].height; }
+
+    // Binds the resource's framebuffer with a viewport covering all of it
+    void bindTarget(RenderResource resource) const;
+
+    // Passes, resource versions and their edges; culled passes are dashed
+    bool writeGraphviz(const std::string& path) const;
+
+    uint32_t passCount() const { return (uint32_t)passes.size(); }
+    uint32_t culledPassCount() const { return (uint32_t)(passes.size() - order.size()); }
+    size_t transientBytes() const { return requestedBytes; }  // Every transient in its own target
+    size_t allocatedBytes() const { return aliasedBytes; }    // After aliasing
+
+private:
+    friend class RenderPassBuilder;
+
+    struct Resource
+    {
+        const char* name;
+        int width;
+        int height;
+        GLenum format;
+        bool imported;
+        unsigned int importedFramebuffer;
+        unsigned int importedTexture;
+        int32_t latestVersion;
+        int32_t slot;       // Physical target, transient only
+        int32_t firstUse;   // Positions in the execution order
+        int32_t lastUse;
+    };
+
+    struct Access
+    {
+        RenderResource resource; // For writes, the version produced
+        uint32_t pass;
+        bool write;
+    };
+
+    struct Pass
+    {
+        const char* name;
+        uint32_t firstAccess;
+        uint32_t accessCount;
+        bool sideEffect;
+        bool alive;
+        void* context;
+        void (*run)(void* context, RenderGraph& graph);
+    };
+
+    // Data edges carry a texture from its writer to a reader; the others only keep a reader of
+    // a version ahead of the pass that overwrites it
+    struct Edge
+    {
+        uint32_t from;
+        uint32_t to;
+        bool data;
+    };
+
+    struct Slot
+    {
+        int width;
+        int height;
+        GLenum format;
+        int32_t lastUse;
+        TransientTarget target;
+    };
+
+    uint32_t beginPass(const char* name);
+    int32_t producerOf(RenderResource resource) const;
+    void addEdge(uint32_t from, uint32_t to, bool data);
+
+    LinearArena* arena = nullptr;
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<Access> accesses;
+    std::vector<Edge> edges;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> scratch;
+    std::vector<Slot> slots;
+    size_t requestedBytes = 0;
+    size_t aliasedBytes = 0;
+};
@@ -0,0 +1,408 @@
+#include "render_queue.h"
+#include "shader.h"
+#include "depth.h"
+
+#include <algorithm>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+// Depth-only shaders for the pre-pass. gl_Position must be computed exactly like the
+// model vertex shader does (same expression, invariant) or GL_EQUAL will reject pixels.
+static const char* depthVertexShaderSource = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+
+    uniform mat4 model;
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    invariant gl_Position;
+
+    void main() {
+        vec4 worldPos = model * vec4(aPos, 1.0);
+        gl_Position = projection * view * worldPos;
+    }
+)glsl";
+
+// Same as above for pooled meshes, whose model matrix comes from the instance stream
+static const char* depthInstancedVertexShaderSource = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    layout(location = 2) in mat4 instanceModel;
+
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    invariant gl_Position;
+
+    void main() {
+        vec4 worldPos = instanceModel * vec4(aPos, 1.0);
+        gl_Position = projection * view * worldPos;
+    }
+)glsl";
+
+static const char* depthFragmentShaderSource = R"glsl(
+    #version 330 core
+
+    void main() {
+    }
+)glsl";
+
+uint64_t makeSortKey(uint8_t layer, uint16_t shader, uint16_t material, float viewDepth)
+{
+    // Anything behind the camera sorts first; it is clipped anyway
+    if (!(viewDepth > 0.0f))
+        viewDepth = 0.0f;
+
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+
+    return ((uint64_t)(layer & 0xF) << 60) |
+           ((uint64_t)(shader & 0xFFF) << 48) |
+           ((uint64_t)material << 32) |
+           (uint64_t)depthBits;
+}
+
+void RenderBucket::push(const DrawCommand& command)
+{
+    // Object origin in view space; the camera looks down -Z
+    glm::vec4 viewPos = queue->view * command.model[3];
+    keys.push_back(makeSortKey(command.layer, command.shader, command.material, -viewPos.z));
+    commands.push_back(command);
+}
+
+bool RenderQueue::init(unsigned int bucketCount)
+{
+    buckets.resize(bucketCount > 0 ? bucketCount : 1);
+    for (RenderBucket& b : buckets)
+        b.queue = this;
+
+    depthProgram = createShaderProgram(depthVertexShaderSource, depthFragmentShaderSource, "Depth prepass");
+    depthInstancedProgram = createShaderProgram(depthInstancedVertexShaderSource, depthFragmentShaderSource, "Instanced depth prepass");
+    if (!depthProgram || !depthInstancedProgram) {
+        depthPrepassEnabled = false;
+        return false;
+    }
+
+    depthModelLoc = glGetUniformLocation(depthProgram, "model");
+    depthViewLoc  = glGetUniformLocation(depthProgram, "view");
+    depthProjLoc  = glGetUniformLocation(depthProgram, "projection");
+
+    depthInstancedViewLoc = glGetUniformLocation(depthInstancedProgram, "view");
+    depthInstancedProjLoc = glGetUniformLocation(depthInstancedProgram, "projection");
+    return true;
+}
+
+void RenderQueue::destroy()
+{
+    if (depthProgram) {
+        glDeleteProgram(depthProgram);
+        depthProgram = 0;
+    }
+    if (depthInstancedProgram) {
+        glDeleteProgram(depthInstancedProgram);
+        depthInstancedProgram = 0;
+    }
+    buckets.clear();
+    sorted.clear();
+    scratch.clear();
+    shaders.clear();
+    materials.clear();
+}
+
+uint16_t RenderQueue::registerShader(unsigned int program)
+{
+    ShaderInfo info;
+    info.program = program;
+    info.modelLoc = glGetUniformLocation(program, "model");
+    info.colorLoc = glGetUniformLocation(program, "objectColor");
+    info.useTextureLoc = glGetUniformLocation(program, "useTexture");
+    shaders.push_back(info);
+    return (uint16_t)(shaders.size() - 1);
+}
+
+uint16_t RenderQueue::registerMaterial(const glm::vec3& objectColor, unsigned int textureArray)
+{
+    Material material = { objectColor, textureArray };
+    materials.push_back(material);
+    return (uint16_t)(materials.size() - 1);
+}
+
+void RenderQueue::begin(const glm::mat4& view)
+{
+    this->view = view;
+
+    // Keeps the capacity around so steady-state frames don't reallocate
+    for (RenderBucket& b : buckets)
+        b.clear();
+    sorted.clear();
+}
+
+void RenderQueue::sort()
+{
+    sorted.clear();
+    for (uint32_t b = 0; b < buckets.size(); b++) {
+        const std::vector<uint64_t>& keys = buckets[b].keys;
+        for (uint32_t i = 0; i < keys.size(); i++)
+            sorted.push_back({ keys[i], b, i });
+    }
+
+    radixSort();
+}
+
+// LSD radix sort on the 64-bit key, one byte per pass. All eight histograms are built in a
+// single sweep and passes where every key shares the same byte are skipped, which is most of
+// them in practice (few layers, shaders and materials).
+void RenderQueue::radixSort()
+{
+    const size_t n = sorted.size();
+    if (n < 2)
+        return;
+
+    uint32_t histograms[8][256];
+    std::memset(histograms, 0, sizeof(histograms));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key = sorted[i].key;
+        for (int pass = 0; pass < 8; pass++)
+            histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+    }
+
+    scratch.resize(n);
+    SortEntry* src = sorted.data();
+    SortEntry* dst = scratch.data();
+
+    for (int pass = 0; pass < 8; pass++) {
+        uint32_t* counts = histograms[pass];
+        const int shift = pass * 8;
+
+        if (counts[(src[0].key >> shift) & 0xFF] == n)
+            continue;
+
+        uint32_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            uint32_t c = counts[d];
+            counts[d] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < n; i++)
+            dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+        SortEntry* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != sorted.data())
+        sorted.swap(scratch);
+}
+
+// Merges runs of consecutive pooled commands sharing shader, material and layer into batches.
+// Inside a run instances are grouped by mesh (front-to-back order kept per mesh), written to
+// the pool's instance stream and uploaded once for both the pre-pass and the shading pass.
+void RenderQueue::buildBatches()
+{
+    batches.clear();
+    meshDraws.clear();
+    if (!meshPool)
+        return;
+
+    meshPool->beginFrame();
+
+    const size_t n = sorted.size();
+    for (size_t i = 0; i < n; ) {
+        const DrawCommand& first = commandAt(i);
+        if (!first.pooled) {
+            i++;
+            continue;
+        }
+
+        size_t end = i + 1;
+        while (end < n) {
+            const DrawCommand& other = commandAt(end);
+            if (!other.pooled || other.shader != first.shader || other.material != first.material || other.layer != first.layer)
+                break;
+            end++;
+        }
+
+        // Sort (mesh, sorted index) pairs so each mesh's instances end up contiguous
+        runScratch.clear();
+        for (size_t k = i; k < end; k++)
+            runScratch.push_back(((uint64_t)commandAt(k).mesh << 32) | (uint64_t)k);
+        std::sort(runScratch.begin(), runScratch.end());
+
+        Batch batch = { (uint32_t)i, (uint32_t)end, (uint32_t)meshDraws.size(), 0 };
+        for (uint64_t entry : runScratch) {
+            uint16_t mesh = (uint16_t)(entry >> 32);
+            const DrawCommand& command = commandAt((size_t)(entry & 0xFFFFFFFFu));
+            uint32_t instance = meshPool->pushInstance(command.model, command.textureLayer);
+
+            if (meshDraws.size() > batch.firstDraw && meshDraws.back().mesh == mesh)
+                meshDraws.back().instanceCount++;
+            else
+                meshDraws.push_back({ mesh, instance, 1 });
+        }
+        batch.drawCount = (uint32_t)meshDraws.size() - batch.firstDraw;
+        batches.push_back(batch);
+
+        i = end;
+    }
+
+    meshPool->uploadFrame(meshDraws);
+}
+
+void RenderQueue::useProgram(unsigned int program)
+{
+    if (program != boundProgram) {
+        glUseProgram(program);
+        boundProgram = program;
+        boundMaterial = UINT32_MAX;
+    }
+}
+
+void RenderQueue::useMaterial(const ShaderInfo& shader, uint16_t material)
+{
+    if (material == boundMaterial || material >= materials.size())
+        return;
+
+    const Material& m = materials[material];
+    if (shader.colorLoc >= 0)
+        glUniform3fv(shader.colorLoc, 1, glm::value_ptr(m.color));
+    if (shader.useTextureLoc >= 0)
+        glUniform1i(shader.useTextureLoc, m.textureArray != 0 ? 1 : 0);
+    if (m.textureArray)
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m.textureArray);
+    boundMaterial = material;
+}
+
+void RenderQueue::draw(const DrawCommand& command, unsigned int program, int modelLoc, const ShaderInfo* shader)
+{
+    useProgram(program);
+    if (command.VAO != boundVAO) {
+        glBindVertexArray(command.VAO);
+        boundVAO = command.VAO;
+    }
+    if (shader)
+        useMaterial(*shader, command.material);
+    if (modelLoc >= 0) {
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(command.model));
+    }
+
+    if (command.indexed) {
+        glDrawElements(command.mode, command.count, GL_UNSIGNED_INT, 0);
+    } else {
+        glDrawArrays(command.mode, 0, command.count);
+    }
+}
+
+void RenderQueue::drawBatch(const Batch& batch, bool depthOnly)
+{
+    const DrawCommand& first = commandAt(batch.start);
+    const ShaderInfo& shader = shaders[first.shader];
+
+    useProgram(depthOnly ? depthInstancedProgram : shader.program);
+    if (meshPool->vao() != boundVAO) {
+        glBindVertexArray(meshPool->vao());
+        boundVAO = meshPool->vao();
+    }
+    if (!depthOnly)
+        useMaterial(shader, first.material);
+
+    meshPool->draw(meshDraws, batch.firstDraw, batch.drawCount);
+}
+
+// Walks the sorted commands once. The depth-only pass stops after the opaque layer.
+void RenderQueue::submitPass(bool depthOnly)
+{
+    size_t batchIndex = 0;
+    bool opaqueDone = false;
+
+    for (size_t i = 0; i < sorted.size(); ) {
+        const DrawCommand& command = commandAt(i);
+
+        if (command.layer != RenderLayer_Opaque && !opaqueDone) {
+            if (depthOnly)
+                break;
+
+            // Cheap draws that skipped the pre-pass (lines etc.) are depth tested normally
+            glDepthMask(GL_TRUE);
+            glDepthFunc(depthLess(reversedZ));
+            opaqueDone = true;
+        }
+
+        if (batchIndex < batches.size() && batches[batchIndex].start == i) {
+            const Batch& batch = batches[batchIndex++];
+            drawBatch(batch, depthOnly);
+            i = batch.end;
+            continue;
+        }
+
+        if (depthOnly) {
+            draw(command, depthProgram, depthModelLoc, nullptr);
+        } else {
+            const ShaderInfo& shader = shaders[command.shader];
+            draw(command, shader.program, shader.modelLoc, &shader);
+        }
+        i++;
+    }
+}
+
+void RenderQueue::flush(const glm::mat4& view, const glm::mat4& projection)
+{
+    depthPrepass(view, projection);
+    shade();
+}
+
+void RenderQueue::depthPrepass(const glm::mat4& view, const glm::mat4& projection)
+{
+    boundProgram = 0;
+    boundVAO = 0;
+    boundMaterial = UINT32_MAX;
+
+    buildBatches();
+
+    prepassed = depthPrepassEnabled && depthProgram;
+    if (!prepassed)
+        return;
+
+    // Depth-only pass: lays down the nearest depth for every pixel
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(depthLess(reversedZ));
+
+    glUseProgram(depthProgram);
+    glUniformMatrix4fv(depthViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(depthProjLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUseProgram(depthInstancedProgram);
+    glUniformMatrix4fv(depthInstancedViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(depthInstancedProjLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    boundProgram = depthInstancedProgram;
+
+    submitPass(true);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glBindVertexArray(0);
+    boundVAO = 0;
+}
+
+void RenderQueue::shade()
+{
+    // Other passes may have run in between
+    boundProgram = 0;
+    boundVAO = 0;
+    boundMaterial = UINT32_MAX;
+
+    if (prepassed) {
+        // Shading pass: only the fragment that won the pre-pass gets lit
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_EQUAL);
+    }
+
+    submitPass(false);
+
+    glDepthMask(GL_TRUE);
+    glDepthFunc(depthLess(reversedZ));
+
+    glBindVertexArray(0);
+    boundVAO = 0;
+}
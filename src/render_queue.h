@@ -0,0 +1,173 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "mesh_pool.h"
+
+// Coarse ordering of draws; the layer lives in the top bits of the sort key
+enum RenderLayer
+{
+    RenderLayer_Opaque = 0, // Lit geometry, takes part in the depth pre-pass
+    RenderLayer_Unlit  = 1  // Lines and other cheap draws, depth tested after the opaque pass
+};
+
+// Compact draw command recorded during scene traversal and issued later by RenderQueue::flush.
+// shader and material are ids returned by RenderQueue::registerShader / registerMaterial.
+//
+// Pooled commands draw a MeshPool mesh and take their model matrix as an instance attribute;
+// consecutive pooled commands with the same shader and material are merged into one batch.
+// The others draw VAO/count with a "model" uniform. textureLayer picks the layer of the
+// material's texture array per instance, so differently textured instances still batch.
+struct DrawCommand
+{
+    glm::mat4 model;
+    unsigned int VAO;
+    GLenum mode;       // GL_TRIANGLES, GL_LINES...
+    GLsizei count;
+    uint16_t shader;
+    uint16_t material;
+    uint16_t mesh;     // MeshPool mesh id when pooled
+    uint16_t textureLayer;
+    uint8_t layer;     // RenderLayer
+    bool indexed;      // glDrawElements when true, glDrawArrays otherwise
+    bool pooled;
+};
+
+// Sort key layout, most significant first:
+//   layer (4) | shader (12) | material (16) | view depth (32, float bits)
+// Positive floats compare like unsigned ints, so sorting the key ascending gives
+// layer, then state, then front-to-back order.
+uint64_t makeSortKey(uint8_t layer, uint16_t shader, uint16_t material, float viewDepth);
+
+class RenderQueue;
+
+// Commands pushed by one thread. Each worker owns a bucket so recording needs no locks.
+class RenderBucket
+{
+public:
+    void push(const DrawCommand& command);
+    void clear() { commands.clear(); keys.clear(); }
+
+private:
+    friend class RenderQueue;
+
+    const RenderQueue* queue = nullptr;
+    std::vector<DrawCommand> commands;
+    std::vector<uint64_t> keys;
+};
+
+// Collects draw commands for a frame into per-thread buckets, radix sorts them by key and
+// submits them on the GL thread, skipping program/VAO/material changes that are redundant.
+//
+// Opaque commands go through an optional depth-only pre-pass followed by a GL_EQUAL shading
+// pass, so the lighting shader runs at most once per pixel no matter how many ships overlap.
+// Per-frame uniforms (view, projection, lights) are set on each shading program by the
+// caller before flush; the queue sets "model" per draw and "objectColor", "useTexture" and the
+// texture array on unit 0 per material.
+class RenderQueue
+{
+public:
+    bool depthPrepassEnabled = true;
+    bool reversedZ = false; // Depth tests use GL_GREATER; see depth.h
+
+    bool init(unsigned int bucketCount = 1);
+    void destroy();
+
+    uint16_t registerShader(unsigned int program);
+    // textureArray (optional, a GL_TEXTURE_2D_ARRAY) is bound to unit 0 and enables "useTexture"
+    uint16_t registerMaterial(const glm::vec3& objectColor, unsigned int textureArray = 0);
+
+    // Pool used for pooled commands; must be set before any are flushed
+    void setMeshPool(MeshPool* pool) { meshPool = pool; }
+
+    // Clears all buckets and sets the view used to compute sort depths
+    void begin(const glm::mat4& view);
+    RenderBucket& bucket(unsigned int index) { return buckets[index]; }
+    unsigned int bucketCount() const { return (unsigned int)buckets.size(); }
+
+    void sort();
+    void flush(const glm::mat4& view, const glm::mat4& projection);
+
+    // flush() in two halves, for callers that schedule them separately: depthPrepass() batches
+    // the sorted commands and lays down depth (if enabled), shade() draws them lit
+    void depthPrepass(const glm::mat4& view, const glm::mat4& projection);
+    void shade();
+
+    size_t size() const { return sorted.size(); }
+
+private:
+    friend class RenderBucket;
+
+    struct ShaderInfo
+    {
+        unsigned int program;
+        int modelLoc;
+        int colorLoc;
+        int useTextureLoc;
+    };
+
+    struct Material
+    {
+        glm::vec3 color;
+        unsigned int textureArray;
+    };
+
+    // Sorted reference to a command inside a bucket
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t bucket;
+        uint32_t index;
+    };
+
+    // Run of consecutive pooled commands, sorted[start, end), drawn as meshDraws[firstDraw, firstDraw + drawCount)
+    struct Batch
+    {
+        uint32_t start;
+        uint32_t end;
+        uint32_t firstDraw;
+        uint32_t drawCount;
+    };
+
+    const DrawCommand& commandAt(size_t i) const { return buckets[sorted[i].bucket].commands[sorted[i].index]; }
+
+    void radixSort();
+    void buildBatches();
+    void submitPass(bool depthOnly);
+    void useProgram(unsigned int program);
+    void useMaterial(const ShaderInfo& shader, uint16_t material);
+    void draw(const DrawCommand& command, unsigned int program, int modelLoc, const ShaderInfo* shader);
+    void drawBatch(const Batch& batch, bool depthOnly);
+
+    glm::mat4 view = glm::mat4(1.0f);
+    std::vector<RenderBucket> buckets;
+    std::vector<SortEntry> sorted;
+    std::vector<SortEntry> scratch;
+
+    std::vector<ShaderInfo> shaders;
+    std::vector<Material> materials;
+
+    MeshPool* meshPool = nullptr;
+    std::vector<Batch> batches;
+    std::vector<MeshDraw> meshDraws;
+    std::vector<uint64_t> runScratch;
+
+    unsigned int depthProgram = 0;
+    int depthModelLoc = -1;
+    int depthViewLoc = -1;
+    int depthProjLoc = -1;
+
+    // Depth-only program for pooled batches, model comes from the instance stream
+    unsigned int depthInstancedProgram = 0;
+    int depthInstancedViewLoc = -1;
+    int depthInstancedProjLoc = -1;
+
+    // Last bound state inside flush, to skip redundant binds
+    bool prepassed = false;  // The last depthPrepass() drew depth, so shade() tests GL_EQUAL
+    unsigned int boundProgram = 0;
+    unsigned int boundVAO = 0;
+    uint32_t boundMaterial = UINT32_MAX;
+};
@@ -0,0 +1,155 @@
+#include "render_target.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <iostream>
+
+size_t bytesPerTexel(GLenum format)
+{
+    switch (format) {
+    case GL_RGBA16F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    case GL_R8:
+        return 1;
+    default:
+        return 4;
+    }
+}
+
+void allocateTexture2D(GLenum internalFormat, int width, int height)
+{
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+        return;
+    }
+
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    switch (internalFormat) {
+    case GL_DEPTH_COMPONENT32F:
+        format = GL_DEPTH_COMPONENT;
+        type = GL_FLOAT;
+        break;
+    case GL_DEPTH_COMPONENT24:
+        format = GL_DEPTH_COMPONENT;
+        type = GL_UNSIGNED_INT;
+        break;
+    case GL_DEPTH32F_STENCIL8:
+        format = GL_DEPTH_STENCIL;
+        type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+        break;
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+        type = GL_FLOAT;
+        break;
+    case GL_R11F_G11F_B10F:
+        format = GL_RGB;
+        type = GL_FLOAT;
+        break;
+    case GL_R8:
+        format = GL_RED;
+        break;
+    case GL_R32F:
+        format = GL_RED;
+        type = GL_FLOAT;
+        break;
+    default:
+        break;
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+}
+
+bool RenderTarget::resize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+    if (framebuffer && width == targetWidth && height == targetHeight)
+        return true;
+
+    destroy();
+    targetWidth = viewWidth = width;
+    targetHeight = viewHeight = height;
+
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    allocateTexture2D(colorFormat, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &depth);
+    glBindTexture(GL_TEXTURE_2D, depth);
+    allocateTexture2D(depthFormat, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    checkGLError("Render target setup error");
+
+    if (resources) {
+        framebufferHandle = resources->adopt<GpuResource_Framebuffer>(framebuffer, GpuMemory_RenderTargets, "Render target framebuffer");
+        colorHandle = resources->adopt<GpuResource_Texture>(color, GpuMemory_RenderTargets, "Render target color");
+        depthHandle = resources->adopt<GpuResource_Texture>(depth, GpuMemory_RenderTargets, "Render target depth");
+        resources->setMemory(colorHandle, (size_t)width * height * bytesPerTexel(colorFormat));
+        resources->setMemory(depthHandle, (size_t)width * height * bytesPerTexel(depthFormat));
+    }
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Render target " << width << "x" << height << " incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void RenderTarget::destroy()
+{
+    if (resources && framebufferHandle.valid()) {
+        resources->release(framebufferHandle);
+        resources->release(colorHandle);
+        resources->release(depthHandle);
+    } else {
+        if (framebuffer)
+            glDeleteFramebuffers(1, &framebuffer);
+        if (color)
+            glDeleteTextures(1, &color);
+        if (depth)
+            glDeleteTextures(1, &depth);
+    }
+    framebuffer = color = depth = 0;
+    targetWidth = targetHeight = 0;
+    viewWidth = viewHeight = 0;
+}
+
+void RenderTarget::setViewport(int width, int height)
+{
+    viewWidth = std::min(std::max(width, 1), targetWidth);
+    viewHeight = std::min(std::max(height, 1), targetHeight);
+}
+
+void RenderTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, viewWidth, viewHeight);
+}
+
+void RenderTarget::blitToScreen(int width, int height) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    GLenum filter = (width == viewWidth && height == viewHeight) ? GL_NEAREST : GL_LINEAR;
+    glBlitFramebuffer(0, 0, viewWidth, viewHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, filter);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
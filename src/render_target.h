@@ -0,0 +1,65 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "gpu_resources.h"
+
+// Approximate storage per texel of a render target format, for memory accounting
+size_t bytesPerTexel(GLenum format);
+
+// Single-level storage for the bound GL_TEXTURE_2D: immutable where GL 4.2 or
+// ARB_texture_storage has it, glTexImage2D with a matching format and type on plain 3.3
+void allocateTexture2D(GLenum internalFormat, int width, int height);
+
+// Offscreen framebuffer with a colour texture and a depth texture.
+//
+// The default framebuffer's depth format is whatever the window system gave us (usually 24-bit
+// fixed point), so rendering that needs a specific depth format - 32-bit float for reversed-Z -
+// goes here and is blitted to the window afterwards.
+class RenderTarget
+{
+public:
+    GLenum colorFormat = GL_RGBA8;
+    GLenum depthFormat = GL_DEPTH_COMPONENT32F;
+
+    // With a registry set the attachments are accounted there, and replaced ones are deleted
+    // only once the GPU has finished the frames that used them
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    // (Re)creates the attachments when the size changed; returns false if incomplete
+    bool resize(int width, int height);
+    void destroy();
+
+    // Renders into the bottom-left width x height of the target only, so the render size can
+    // change every frame without reallocating the target; resize() resets it to the whole target.
+    // Anything sized from the render size (the Hi-Z copy) must follow the target size instead.
+    void setViewport(int width, int height);
+
+    // Binds for drawing and reading and sets the viewport
+    void bind() const;
+
+    // Copies the viewport region to the default framebuffer, stretched to width x height
+    void blitToScreen(int width, int height) const;
+
+    unsigned int framebufferObject() const { return framebuffer; }
+    unsigned int colorTexture() const { return color; }
+    unsigned int depthTexture() const { return depth; }
+    int width() const { return targetWidth; }
+    int height() const { return targetHeight; }
+    int viewportWidth() const { return viewWidth; }
+    int viewportHeight() const { return viewHeight; }
+
+private:
+    GpuResources* resources = nullptr;
+    FramebufferHandle framebufferHandle;
+    TextureHandle colorHandle;
+    TextureHandle depthHandle;
+
+    unsigned int framebuffer = 0;
+    unsigned int color = 0;
+    unsigned int depth = 0;
+    int targetWidth = 0;
+    int targetHeight = 0;
+    int viewWidth = 0;
+    int viewHeight = 0;
+};
@@ -0,0 +1,114 @@
+#include "render_target_pool.h"
+#include "render_target.h"
+#include "shader.h"
+
+#include <iostream>
+
+TransientTarget RenderTargetPool::acquire(int width, int height, GLenum format)
+{
+    for (Entry& entry : entries) {
+        if (!entry.inUse && entry.target.width == width && entry.target.height == height && entry.target.format == format) {
+            entry.inUse = true;
+            entry.lastUsedFrame = frame;
+            return entry.target;
+        }
+    }
+
+    Entry entry;
+    if (!create(entry, width, height, format))
+        return TransientTarget();
+    entry.inUse = true;
+    entry.lastUsedFrame = frame;
+    entries.push_back(entry);
+    return entry.target;
+}
+
+void RenderTargetPool::release(const TransientTarget& target)
+{
+    for (Entry& entry : entries) {
+        if (entry.target.framebuffer == target.framebuffer) {
+            entry.inUse = false;
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::endFrame()
+{
+    frame++;
+    for (size_t i = 0; i < entries.size();) {
+        if (!entries[i].inUse && frame - entries[i].lastUsedFrame > maxIdleFrames) {
+            destroyEntry(entries[i]);
+            entries[i] = entries.back();
+            entries.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+void RenderTargetPool::destroy()
+{
+    for (Entry& entry : entries)
+        destroyEntry(entry);
+    entries.clear();
+}
+
+size_t RenderTargetPool::memoryUsed() const
+{
+    size_t bytes = 0;
+    for (const Entry& entry : entries)
+        bytes += (size_t)entry.target.width * entry.target.height * bytesPerTexel(entry.target.format);
+    return bytes;
+}
+
+bool RenderTargetPool::create(Entry& entry, int width, int height, GLenum format)
+{
+    TransientTarget& target = entry.target;
+    target.width = width;
+    target.height = height;
+    target.format = format;
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    allocateTexture2D(format, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    checkGLError("Transient render target setup error");
+
+    if (resources) {
+        entry.framebufferHandle = resources->adopt<GpuResource_Framebuffer>(target.framebuffer, GpuMemory_RenderTargets, "Transient framebuffer");
+        entry.textureHandle = resources->adopt<GpuResource_Texture>(target.texture, GpuMemory_RenderTargets, "Transient color");
+        resources->setMemory(entry.textureHandle, (size_t)width * height * bytesPerTexel(format));
+    }
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Transient render target " << width << "x" << height << " incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        destroyEntry(entry);
+        return false;
+    }
+    return true;
+}
+
+void RenderTargetPool::destroyEntry(Entry& entry)
+{
+    if (resources && entry.framebufferHandle.valid()) {
+        resources->release(entry.framebufferHandle);
+        resources->release(entry.textureHandle);
+    } else {
+        if (entry.target.framebuffer)
+            glDeleteFramebuffers(1, &entry.target.framebuffer);
+        if (entry.target.texture)
+            glDeleteTextures(1, &entry.target.texture);
+    }
+    entry.target = TransientTarget();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "gpu_resources.h"
+
+// A colour-only framebuffer handed out for part of a frame
+struct TransientTarget
+{
+    unsigned int framebuffer = 0;
+    unsigned int texture = 0;
+    int width = 0;
+    int height = 0;
+    GLenum format = 0;
+
+    bool valid() const { return framebuffer != 0; }
+};
+
+// Intermediate render targets (bloom levels, post-processing buffers) come from here instead of
+// being owned by each pass. A released target goes back to the pool and the next acquire of the
+// same size and format gets it, in this frame or a later one, so steady-state frames create
+// nothing. Targets left unused for a while (the render size changed) are deleted.
+class RenderTargetPool
+{
+public:
+    static const uint32_t maxIdleFrames = 120;
+
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    // Linear filtered, clamped; an invalid target if the framebuffer is incomplete
+    TransientTarget acquire(int width, int height, GLenum format);
+    void release(const TransientTarget& target);
+
+    // Deletes targets idle for maxIdleFrames; call once per frame
+    void endFrame();
+    void destroy();
+
+    size_t targetCount() const { return entries.size(); }
+    size_t memoryUsed() const;
+
+private:
+    struct Entry
+    {
+        TransientTarget target;
+        FramebufferHandle framebufferHandle;
+        TextureHandle textureHandle;
+        bool inUse = false;
+        uint32_t lastUsedFrame = 0;
+    };
+
+    bool create(Entry& entry, int width, int height, GLenum format);
+    void destroyEntry(Entry& entry);
+
+    GpuResources* resources = nullptr;
+    std::vector<Entry> entries;
+    uint32_t frame = 0;
+};
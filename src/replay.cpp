@@ -0,0 +1,178 @@
+#include "replay.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "image.h"
+
+namespace {
+
+const char replayMagic[4] = { 'R', 'S', 'R', 'P' };
+const uint32_t replayVersion = 1;
+
+struct ReplayHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t fleetSeed;
+    uint32_t asteroidSeed;
+    double step;
+    uint64_t tickCount;
+    uint64_t checksumCount;
+};
+
+// Tick records: a repeat record covers ticks that keep the previous down mask with no
+// transitions; otherwise the flags say which masks follow
+const uint8_t tickRepeat = 0;
+const uint8_t tickDown = 1;
+const uint8_t tickPressed = 2;
+const uint8_t tickReleased = 4;
+
+void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+bool readVarint(const std::vector<uint8_t>& in, size_t& pos, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size())
+            return false;
+        uint8_t byte = in[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+}
+
+bool writeReplay(const std::string& path, const ReplayLog& log)
+{
+    std::vector<uint8_t> stream;
+    stream.reserve(log.ticks.size() / 8 + 64);
+    uint64_t previousDown = 0;
+    uint64_t repeat = 0;
+    for (const InputState& tick : log.ticks) {
+        if (tick.down == previousDown && tick.pressed == 0 && tick.released == 0) {
+            repeat++;
+            continue;
+        }
+        if (repeat > 0) {
+            stream.push_back(tickRepeat);
+            writeVarint(stream, repeat);
+            repeat = 0;
+        }
+
+        uint8_t flags = (tick.down != previousDown ? tickDown : 0) | (tick.pressed ? tickPressed : 0) |
+                        (tick.released ? tickReleased : 0);
+        stream.push_back(flags);
+        if (flags & tickDown)
+            writeVarint(stream, tick.down);
+        if (flags & tickPressed)
+            writeVarint(stream, tick.pressed);
+        if (flags & tickReleased)
+            writeVarint(stream, tick.released);
+        previousDown = tick.down;
+    }
+    if (repeat > 0) {
+        stream.push_back(tickRepeat);
+        writeVarint(stream, repeat);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to write replay " << path << std::endl;
+        return false;
+    }
+
+    ReplayHeader header;
+    std::memcpy(header.magic, replayMagic, sizeof(replayMagic));
+    header.version = replayVersion;
+    header.fleetSeed = log.fleetSeed;
+    header.asteroidSeed = log.asteroidSeed;
+    header.step = log.step;
+    header.tickCount = log.ticks.size();
+    header.checksumCount = log.checksums.size();
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)stream.data(), stream.size());
+    file.write((const char*)log.checksums.data(), log.checksums.size() * sizeof(uint32_t));
+    return (bool)file;
+}
+
+bool readReplay(const std::string& path, ReplayLog& log)
+{
+    std::vector<uint8_t> file;
+    if (!readFile(path, file)) {
+        std::cerr << "Failed to read replay " << path << std::endl;
+        return false;
+    }
+
+    ReplayHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << "Replay " << path << " is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, replayMagic, sizeof(replayMagic)) != 0 || header.version != replayVersion) {
+        std::cerr << "Replay " << path << " has an unknown format" << std::endl;
+        return false;
+    }
+
+    log.fleetSeed = header.fleetSeed;
+    log.asteroidSeed = header.asteroidSeed;
+    log.step = header.step;
+    log.ticks.clear();
+    log.ticks.reserve(header.tickCount);
+
+    size_t pos = sizeof(header);
+    InputState tick;
+    while (log.ticks.size() < header.tickCount) {
+        if (pos >= file.size())
+            break;
+        uint8_t flags = file[pos++];
+        uint64_t value = 0;
+        if (flags == tickRepeat) {
+            if (!readVarint(file, pos, value) || value > header.tickCount - log.ticks.size())
+                break;
+            tick.pressed = tick.released = 0;
+            log.ticks.insert(log.ticks.end(), (size_t)value, tick);
+            continue;
+        }
+
+        tick.pressed = tick.released = 0;
+        if ((flags & tickDown) && !readVarint(file, pos, tick.down))
+            break;
+        if ((flags & tickPressed) && !readVarint(file, pos, tick.pressed))
+            break;
+        if ((flags & tickReleased) && !readVarint(file, pos, tick.released))
+            break;
+        log.ticks.push_back(tick);
+    }
+
+    if (log.ticks.size() != header.tickCount ||
+        file.size() - pos != header.checksumCount * sizeof(uint32_t)) {
+        std::cerr << "Replay " << path << " is corrupt" << std::endl;
+        return false;
+    }
+    log.checksums.resize((size_t)header.checksumCount);
+    std::memcpy(log.checksums.data(), &file[pos], log.checksums.size() * sizeof(uint32_t));
+    return true;
+}
+
+uint32_t checksumBytes(const void* data, size_t bytes, uint32_t hash)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
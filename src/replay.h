@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "input.h"
+
+// A recorded play session: the seeds the world is generated from and the actions of every
+// simulation tick from the first one. The simulation draws all of its randomness from those
+// seeds, so feeding the ticks back through the same step reproduces the session exactly.
+// A checksum of the simulation every checksumInterval ticks shows where a replay diverges.
+struct ReplayLog
+{
+    static const uint32_t checksumInterval = 60;
+
+    uint32_t fleetSeed = 0;
+    uint32_t asteroidSeed = 0;
+    double step = 0.0;
+    std::vector<InputState> ticks;
+    std::vector<uint32_t> checksums; // One after every checksumInterval ticks
+};
+
+// Binary log: a header, then the ticks run-length encoded (a run of ticks that change nothing is
+// one varint, a tick with changes is a flag byte plus varint masks), then the checksums.
+// A ten minute session is a few tens of kilobytes.
+bool writeReplay(const std::string& path, const ReplayLog& log);
+bool readReplay(const std::string& path, ReplayLog& log);
+
+// FNV-1a, chained through hash, for checksumming simulation state
+uint32_t checksumBytes(const void* data, size_t bytes, uint32_t hash = 2166136261u);
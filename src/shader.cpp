@@ -0,0 +1,98 @@
+#include "shader.h"
+
+#include <iostream>
+
+static unsigned int compileShader(GLenum type, const char* source, const std::string& name)
+{
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        std::cerr << name << " shader compilation error: " << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Links program; on failure logs the info log, deletes it and returns 0
+static unsigned int linkProgram(unsigned int program, const std::string& name)
+{
+    glLinkProgram(program);
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        std::cerr << name << " shader program linking error: " << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource, const std::string& name)
+{
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, name + " vertex");
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, name + " fragment");
+    if (!vertexShader || !fragmentShader) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    program = linkProgram(program, name);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    checkGLError(name + " shader program error");
+    return program;
+}
+
+unsigned int createComputeProgram(const char* computeSource, const std::string& name)
+{
+    unsigned int computeShader = compileShader(GL_COMPUTE_SHADER, computeSource, name + " compute");
+    if (!computeShader)
+        return 0;
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, computeShader);
+    program = linkProgram(program, name);
+
+    glDeleteShader(computeShader);
+    checkGLError(name + " shader program error");
+    return program;
+}
+
+unsigned int createTransformFeedbackProgram(const char* vertexSource, const char* const* varyings, int varyingCount, const std::string& name)
+{
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, name + " vertex");
+    if (!vertexShader)
+        return 0;
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glTransformFeedbackVaryings(program, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS); // Must precede linking
+    program = linkProgram(program, name);
+
+    glDeleteShader(vertexShader);
+    checkGLError(name + " shader program error");
+    return program;
+}
+
+// Function to check for OpenGL errors
+void checkGLError(const std::string& errorMessage) {
+    GLenum err;
+    while ((err = glGetError()) != GL_NO_ERROR) {
+        std::cerr << errorMessage << ": OpenGL error: " << err << std::endl;
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+
+// Compiles a vertex + fragment shader pair and links them into a program.
+// Compile and link failures are reported to std::cerr with the info log; returns 0 on failure.
+unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource, const std::string& name);
+
+// Compiles and links a compute shader program (GL 4.3 / ARB_compute_shader); returns 0 on failure
+unsigned int createComputeProgram(const char* computeSource, const std::string& name);
+
+// Links a vertex-only program whose outputs are captured interleaved by transform feedback
+unsigned int createTransformFeedbackProgram(const char* vertexSource, const char* const* varyings, int varyingCount, const std::string& name);
+
+// Function to check for OpenGL errors
+void checkGLError(const std::string& errorMessage);
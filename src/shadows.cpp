@@ -0,0 +1,283 @@
+#include "shadows.h"
+#include "shader.h"
+#include "depth.h"
+#include "render_target.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Depth only; instance matrices come from the mesh pool like in the main pass
+static const char* shadowVertexShaderSource = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    layout(location = 2) in mat4 instanceModel;
+
+    uniform mat4 lightViewProjection;
+
+    void main() {
+        gl_Position = lightViewProjection * instanceModel * vec4(aPos, 1.0);
+    }
+)glsl";
+
+static const char* shadowFragmentShaderSource = R"glsl(
+    #version 330 core
+    void main() {
+    }
+)glsl";
+
+// Orthographic projection; with [0, 1] clip depth (glClipControl) z maps to [0, 1] instead of [-1, 1]
+static glm::mat4 shadowOrtho(float left, float right, float bottom, float top, float nearPlane, float farPlane, bool zeroToOne)
+{
+    glm::mat4 projection = glm::ortho(left, right, bottom, top, nearPlane, farPlane);
+    if (zeroToOne) {
+        projection[2][2] = -1.0f / (farPlane - nearPlane);
+        projection[3][2] = -nearPlane / (farPlane - nearPlane);
+    }
+    return projection;
+}
+
+bool CascadedShadowMap::init()
+{
+    program = createShaderProgram(shadowVertexShaderSource, shadowFragmentShaderSource, "Shadow");
+    if (!program)
+        return false;
+    viewProjectionLoc = glGetUniformLocation(program, "lightViewProjection");
+
+    glGenFramebuffers(1, &framebuffer);
+    return true;
+}
+
+void CascadedShadowMap::deleteDepthArray()
+{
+    if (resources && depthArrayHandle.valid())
+        resources->release(depthArrayHandle);
+    else if (depthArray)
+        glDeleteTextures(1, &depthArray);
+    depthArray = 0;
+}
+
+void CascadedShadowMap::destroy()
+{
+    if (program)
+        glDeleteProgram(program);
+    if (framebuffer)
+        glDeleteFramebuffers(1, &framebuffer);
+    deleteDepthArray();
+    program = framebuffer = 0;
+    allocatedResolution = 0;
+}
+
+void CascadedShadowMap::invalidate()
+{
+    for (Cascade& cascade : cascades)
+        cascade.valid = false;
+}
+
+void CascadedShadowMap::update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& sunDirection)
+{
+    frameIndex++;
+    int count = std::max(1, std::min(cascadeCount, maxCascades));
+
+    glm::vec3 toSun = glm::normalize(sunDirection);
+    if (glm::dot(toSun, lastSunDirection) < 0.9999f) {
+        invalidate();
+        lastSunDirection = toSun;
+    }
+
+    // Light space: looking along the sun's rays, rotation only so snapping is in world units
+    glm::vec3 up = std::fabs(toSun.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -toSun, up);
+    glm::mat4 inverseView = glm::inverse(view);
+
+    float tanY = std::tan(fovY * 0.5f);
+    float tanX = tanY * aspect;
+    float cornerSlope2 = tanX * tanX + tanY * tanY; // Squared distance of a slice corner from the axis, per unit depth
+
+    float splitNear = nearPlane;
+    for (int i = 0; i < count; i++) {
+        Cascade& cascade = cascades[i];
+        float t = (float)(i + 1) / (float)count;
+        float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, t);
+        float uniformSplit = nearPlane + (shadowDistance - nearPlane) * t;
+        float splitFar = uniformSplit + (logSplit - uniformSplit) * splitLambda;
+        cascade.splitFar = splitFar;
+
+        // Smallest sphere around the slice: centred on the view axis where the near and far
+        // corners are equally far, or at the far plane when the slice is very wide
+        float n = splitNear;
+        float f = splitFar;
+        float centerDepth = std::min(0.5f * (n + f) * (1.0f + cornerSlope2), f);
+        float sliceRadius = std::sqrt((f - centerDepth) * (f - centerDepth) + f * f * cornerSlope2);
+        glm::vec3 sliceCenter = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+        splitNear = splitFar;
+
+        int interval = std::max(1, cascadeIntervals[i]);
+        float radius = interval > 1 ? sliceRadius * (1.0f + staleMargin) : sliceRadius;
+
+        // A stale cascade is only usable while its sphere still contains the current slice
+        bool covered = cascade.valid && glm::length(sliceCenter - cascade.center) + sliceRadius <= cascade.radius;
+        cascade.due = !covered || (frameIndex + (uint32_t)i) % (uint32_t)interval == 0;
+        if (!cascade.due)
+            continue;
+
+        // Snap the centre to whole texels so the rasterised casters don't move by fractions of one
+        float texel = 2.0f * radius / (float)resolution;
+        glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(sliceCenter, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+        lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+        // The near plane is pulled back towards the sun so casters outside the slice still shadow it
+        glm::mat4 projection = shadowOrtho(lightCenter.x - radius, lightCenter.x + radius,
+                                           lightCenter.y - radius, lightCenter.y + radius,
+                                           -lightCenter.z - radius - casterDistance, -lightCenter.z + radius, reversedZ);
+        cascade.pendingViewProjection = projection * lightRotation;
+        cascade.pendingCenter = sliceCenter;
+        cascade.pendingRadius = radius;
+    }
+
+    for (int i = count; i < maxCascades; i++) {
+        cascades[i].due = false;
+        cascades[i].valid = false;
+    }
+}
+
+void CascadedShadowMap::render(const ShadowCaster* casters, size_t casterCount, MeshPool& pool)
+{
+    renderedThisFrame = 0;
+    if (!enabled || !program)
+        return;
+
+    if (allocatedResolution != resolution) {
+        deleteDepthArray();
+        glGenTextures(1, &depthArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        // Immutable storage needs GL 4.2; the context only asks for 3.3
+        if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, maxCascades);
+        else
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, maxCascades, 0, GL_DEPTH_COMPONENT,
+                         GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // Hardware depth comparison with bilinear filtering: 2x2 PCF per tap
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        if (resources) {
+            depthArrayHandle = resources->adopt<GpuResource_Texture>(depthArray, GpuMemory_RenderTargets, "Shadow cascades");
+            resources->setMemory(depthArrayHandle, (size_t)resolution * resolution * maxCascades * bytesPerTexel(GL_DEPTH_COMPONENT32F));
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Shadow framebuffer incomplete" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            enabled = false;
+            return;
+        }
+        checkGLError("Shadow map setup error");
+        allocatedResolution = resolution;
+        invalidate();
+    }
+
+    // Cull every due cascade and group its casters by mesh into one shared instance stream
+    pool.beginFrame();
+    draws.clear();
+    for (int i = 0; i < maxCascades; i++) {
+        Cascade& cascade = cascades[i];
+        cascade.drawCount = 0;
+        if (!cascade.due)
+            continue;
+
+        Frustum frustum = extractFrustum(cascade.pendingViewProjection);
+        visible.clear();
+        for (size_t k = 0; k < casterCount; k++) {
+            if (sphereInFrustum(frustum, casters[k].center, casters[k].radius))
+                visible.push_back(((uint64_t)casters[k].mesh << 32) | (uint64_t)k);
+        }
+        std::sort(visible.begin(), visible.end());
+
+        cascade.firstDraw = draws.size();
+        for (uint64_t entry : visible) {
+            const ShadowCaster& caster = casters[(size_t)(entry & 0xFFFFFFFFu)];
+            uint32_t instance = pool.pushInstance(caster.model);
+            if (draws.size() > cascade.firstDraw && draws.back().mesh == caster.mesh) {
+                draws.back().instanceCount++;
+            } else {
+                MeshDraw draw = {caster.mesh, instance, 1};
+                draws.push_back(draw);
+            }
+        }
+        cascade.drawCount = draws.size() - cascade.firstDraw;
+    }
+    pool.uploadFrame(draws, false);
+
+    // Plain depth test into the maps whatever the main pass uses; slope-scaled bias against acne
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, resolution, resolution);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glClearDepth(1.0);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glUseProgram(program);
+    glBindVertexArray(pool.vao());
+
+    for (int i = 0; i < maxCascades; i++) {
+        Cascade& cascade = cascades[i];
+        if (!cascade.due)
+            continue;
+
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glUniformMatrix4fv(viewProjectionLoc, 1, GL_FALSE, glm::value_ptr(cascade.pendingViewProjection));
+        pool.draw(draws, cascade.firstDraw, cascade.drawCount);
+
+        cascade.viewProjection = cascade.pendingViewProjection;
+        cascade.center = cascade.pendingCenter;
+        cascade.radius = cascade.pendingRadius;
+        cascade.valid = true;
+        cascade.due = false;
+        renderedThisFrame++;
+    }
+
+    glBindVertexArray(0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glClearDepth(depthFar(reversedZ));
+    glDepthFunc(depthLess(reversedZ));
+}
+
+void CascadedShadowMap::setUniforms(unsigned int lightingProgram, int textureUnit) const
+{
+    // Clip space to shadow map texture space; depth is already [0, 1] with clip control
+    glm::mat4 bias(0.5f);
+    bias[3] = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    if (reversedZ) {
+        bias[2][2] = 1.0f;
+        bias[3][2] = 0.0f;
+    }
+
+    glm::mat4 matrices[maxCascades];
+    float splits[maxCascades];
+    for (int i = 0; i < maxCascades; i++) {
+        matrices[i] = bias * cascades[i].viewProjection;
+        splits[i] = cascades[i].valid ? cascades[i].splitFar : 0.0f; // 0 ends the search in the shader
+    }
+
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform1i(glGetUniformLocation(lightingProgram, "shadowMap"), textureUnit);
+    glUniformMatrix4fv(glGetUniformLocation(lightingProgram, "cascadeMatrices"), maxCascades, GL_FALSE, glm::value_ptr(matrices[0]));
+    glUniform4fv(glGetUniformLocation(lightingProgram, "cascadeSplits"), 1, splits);
+    glUniform1i(glGetUniformLocation(lightingProgram, "shadowsEnabled"), enabled && depthArray && cascades[0].valid ? 1 : 0);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"
+#include "gpu_resources.h"
+#include "mesh_pool.h"
+
+// One mesh instance that may cast a shadow this frame
+struct ShadowCaster
+{
+    glm::mat4 model;
+    glm::vec3 center; // World-space bounding sphere
+    float radius;
+    uint16_t mesh;    // MeshPool mesh id
+};
+
+// Cascaded shadow maps for a directional (sun) light.
+//
+// The view distance up to shadowDistance is split into cascades (mix of logarithmic and uniform
+// splits), and each cascade renders the casters around its slice of the camera frustum into one
+// layer of a depth texture array. Each cascade is fit to the bounding sphere of its slice, whose
+// size doesn't change as the camera turns, and its origin is snapped to whole shadow texels in
+// light space, so shadow edges don't shimmer as the camera moves.
+//
+// Casters are culled per cascade with the same sphere/frustum test as the main pass and drawn
+// through the MeshPool with a depth-only instanced shader, all cascades from one instance upload.
+// Far cascades are only re-rendered every few frames (cascadeIntervals), with a margin around
+// their slice so the stale map still covers it; a cascade the camera has moved out of is
+// re-rendered early.
+class CascadedShadowMap
+{
+public:
+    static constexpr int maxCascades = 4;
+
+    bool enabled = true;
+    bool reversedZ = false;            // Clip depth is [0, 1] (glClipControl); see depth.h
+    int cascadeCount = 4;
+    int resolution = 2048;
+    float shadowDistance = 250.0f;     // No shadows past this view distance
+    float splitLambda = 0.75f;         // 0 uniform splits, 1 logarithmic
+    float casterDistance = 150.0f;     // How far towards the sun casters are still picked up
+    float staleMargin = 0.15f;         // Extra radius of cascades that are not redrawn every frame
+    int cascadeIntervals[maxCascades] = {1, 2, 4, 8}; // Frames between updates of each cascade
+
+    // With a registry set the cascade array is accounted there, and a replaced one is deleted
+    // only once the GPU has finished with it
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    bool init();
+    void destroy();
+
+    // Fits the cascades to the camera and decides which are due this frame.
+    // sunDirection points from the scene towards the sun.
+    void update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& sunDirection);
+
+    // Renders the due cascades. Leaves the shadow framebuffer bound; the caller rebinds its target.
+    void render(const ShadowCaster* casters, size_t casterCount, MeshPool& pool);
+
+    // Binds the maps to textureUnit and sets shadowMap, cascadeMatrices, cascadeSplits and
+    // shadowsEnabled on a lighting program, which must be in use
+    void setUniforms(unsigned int lightingProgram, int textureUnit) const;
+
+    // Forces every cascade to be redrawn next frame, e.g. after a rebase moved the world
+    void invalidate();
+
+    int cascadesRendered() const { return renderedThisFrame; }
+
+private:
+    struct Cascade
+    {
+        float splitFar = 0.0f;       // View distance where the cascade ends
+        glm::mat4 viewProjection = glm::mat4(1.0f); // Light matrix it was last rendered with
+        glm::vec3 center = glm::vec3(0.0f);         // Sphere it was last rendered around
+        float radius = 0.0f;
+        bool valid = false;
+        bool due = false;
+        glm::mat4 pendingViewProjection = glm::mat4(1.0f);
+        glm::vec3 pendingCenter = glm::vec3(0.0f);
+        float pendingRadius = 0.0f;
+        size_t firstDraw = 0;        // Range of this frame's draws, when due
+        size_t drawCount = 0;
+    };
+
+    void deleteDepthArray();
+
+    unsigned int program = 0;
+    unsigned int framebuffer = 0;
+    unsigned int depthArray = 0;
+    GpuResources* resources = nullptr;
+    TextureHandle depthArrayHandle;
+    int viewProjectionLoc = -1;
+    int allocatedResolution = 0;
+
+    Cascade cascades[maxCascades];
+    uint32_t frameIndex = 0;
+    int renderedThisFrame = 0;
+    glm::vec3 lastSunDirection = glm::vec3(0.0f);
+
+    // Per-frame scratch, kept to avoid reallocating
+    std::vector<uint64_t> visible; // (mesh << 32) | caster index, sorted per cascade
+    std::vector<MeshDraw> draws;
+};
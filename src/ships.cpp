@@ -0,0 +1,128 @@
+#include "ships.h"
+#include "job_system.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+glm::mat4 buildShipTransform(const glm::vec3& position, float yaw)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+
+    // Rotate to make Z-axis point up
+    model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+    // Apply translation based on position
+    model = glm::translate(model, position);
+
+    // Apply rotation around new Y-axis (previously Z-axis)
+    model = glm::rotate(model, yaw, glm::vec3(0.0f, 0.0f, 1.0f));
+    return model;
+}
+
+void spawnFleet(ShipWorld& world, unsigned int npcCount, unsigned int seed)
+{
+    const size_t count = (size_t)npcCount + 1;
+    world.positions.assign(count, glm::vec3(0.0f));
+    world.yaws.assign(count, 0.0f);
+    world.orbitRadius.assign(count, 0.0f);
+    world.orbitSpeed.assign(count, 0.0f);
+    world.orbitPhase.assign(count, 0.0f);
+    world.orbitHeight.assign(count, 0.0f);
+    world.fireCooldowns.assign(count, 0.0f);
+    world.fleetCenter = glm::vec3(0.0f);
+    world.transforms.assign(count, glm::mat4(1.0f));
+    world.worldCenters.assign(count, glm::vec3(0.0f));
+    world.bounds.assign(count, Aabb{ glm::vec3(0.0f), glm::vec3(0.0f) });
+    world.displacements.assign(count, glm::vec3(0.0f));
+    world.shapes.assign(count, CollisionShape{ world.hull, glm::mat4(1.0f) });
+
+    // Proxies are created by the first update, once the ships have positions
+    world.tree.clear();
+    world.proxies.clear();
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> radius(8.0f, 60.0f);
+    std::uniform_real_distribution<float> speed(0.05f, 0.4f);
+    std::uniform_real_distribution<float> phase(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> height(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> cooldown(0.0f, 3.0f);
+
+    for (size_t i = 1; i < count; i++) {
+        world.orbitRadius[i] = radius(rng);
+        world.orbitSpeed[i] = speed(rng) * (rng() & 1 ? 1.0f : -1.0f);
+        world.orbitPhase[i] = phase(rng);
+        world.orbitHeight[i] = height(rng);
+        world.fireCooldowns[i] = cooldown(rng);
+    }
+}
+
+void updateShips(ShipWorld& world, JobSystem& jobs, float time)
+{
+    jobs.parallelFor((uint32_t)world.size(), 256, [&world, time](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            if (i > 0) {
+                // NPCs circle the fleet center in the ship plane (local X/Z), height along local Y
+                float angle = world.orbitPhase[i] + world.orbitSpeed[i] * time;
+                world.positions[i] = world.fleetCenter + glm::vec3(std::cos(angle) * world.orbitRadius[i],
+                                                                   world.orbitHeight[i],
+                                                                   std::sin(angle) * world.orbitRadius[i]);
+                world.yaws[i] = angle;
+            }
+
+            world.transforms[i] = buildShipTransform(world.positions[i], world.yaws[i]);
+
+            glm::vec3 center = glm::vec3(world.transforms[i][3]);
+            world.displacements[i] = center - world.worldCenters[i];
+            world.worldCenters[i] = center;
+            world.bounds[i] = aabbFromSphere(center, world.boundingRadius);
+            world.shapes[i] = CollisionShape{ world.hull, world.transforms[i] };
+        }
+    });
+
+    if (world.proxies.size() != world.size()) {
+        std::vector<uint32_t> ids(world.size());
+        for (size_t i = 0; i < ids.size(); i++)
+            ids[i] = (uint32_t)i;
+
+        world.tree.clear();
+        world.proxies.resize(world.size());
+        world.tree.createProxies(world.bounds.data(), ids.data(), ids.size(), world.proxies.data());
+    } else {
+        world.tree.moveProxies(world.proxies.data(), world.bounds.data(), world.displacements.data(), world.size());
+    }
+}
+
+glm::vec3 playerContactOffset(const std::vector<Contact>& contacts)
+{
+    // Pairs are ordered, so the player is always body a and the normal points away from it
+    glm::vec3 push(0.0f);
+    for (const Contact& contact : contacts) {
+        if (contact.a == 0)
+            push -= contact.normal * contact.depth;
+    }
+
+    return worldToShipSpace(push);
+}
+
+glm::vec3 worldToShipSpace(const glm::vec3& v)
+{
+    // Positions are applied after the Z-up rotation, so undo it to get back to that space
+    glm::mat3 zUp = glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
+    return glm::transpose(zUp) * v;
+}
+
+void rebaseShips(ShipWorld& world, const glm::vec3& shift)
+{
+    glm::vec3 localShift = worldToShipSpace(shift);
+    world.fleetCenter -= localShift;
+    for (size_t i = 0; i < world.size(); i++) {
+        world.positions[i] -= localShift;
+        world.worldCenters[i] -= shift;
+        world.bounds[i].min -= shift;
+        world.bounds[i].max -= shift;
+    }
+
+    // Every proxy moved; a fresh top-down build is cheaper and better than reinserting them all
+    world.tree.clear();
+    world.proxies.clear();
+}
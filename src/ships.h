@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "collision.h"
+#include "spatial_index.h"
+
+class JobSystem;
+
+// Ship state kept as parallel arrays so the simulation and culling loops stay cache friendly.
+// Index 0 is the player ship, driven by processInput; the rest are NPC ships on orbits.
+struct ShipWorld
+{
+    std::vector<glm::vec3> positions;
+    std::vector<float> yaws;
+
+    // NPC orbit parameters, unused for the player
+    std::vector<float> orbitRadius;
+    std::vector<float> orbitSpeed;
+    std::vector<float> orbitPhase;
+    std::vector<float> orbitHeight;
+    std::vector<float> fireCooldowns; // Seconds until the next shot
+    glm::vec3 fleetCenter = glm::vec3(0.0f); // NPCs orbit this point (ship space, moved by rebasing)
+
+    // Written by updateShips
+    std::vector<glm::mat4> transforms;
+    std::vector<glm::vec3> worldCenters;
+    std::vector<Aabb> bounds;
+    std::vector<glm::vec3> displacements; // World-space movement during the last update
+
+    std::vector<CollisionShape> shapes;
+
+    float boundingRadius = 1.0f; // Mesh bounding sphere around the model origin
+    const ConvexHull* hull = nullptr; // Shared by every ship, owned by the caller
+
+    // World-space bounds of every ship, for frustum and proximity queries
+    DynamicAabbTree tree;
+    std::vector<int32_t> proxies;
+
+    size_t size() const { return positions.size(); }
+};
+
+// Same transform the player ship has always used: Z-up fix, translation, then yaw
+glm::mat4 buildShipTransform(const glm::vec3& position, float yaw);
+
+// Resets the world to the player plus npcCount ships with seeded orbits
+void spawnFleet(ShipWorld& world, unsigned int npcCount, unsigned int seed);
+
+// Advances NPC ships to time (seconds) and rebuilds every transform, spread across the job system,
+// then refits the spatial index (serially; most ships stay inside their fat bounds)
+void updateShips(ShipWorld& world, JobSystem& jobs, float time);
+
+// Ship positions live in the space before the Z-up rotation of buildShipTransform; this takes a
+// world-space vector into that space
+glm::vec3 worldToShipSpace(const glm::vec3& v);
+
+// Moves the fleet by -shift (world space) for a floating-origin rebase; the spatial index is rebuilt
+// on the next update. The player position is owned by the caller and must be moved too.
+void rebaseShips(ShipWorld& world, const glm::vec3& shift);
+
+// Model-space offset that moves the player (ship 0) out of every ship it overlaps; NPCs keep their orbits
+glm::vec3 playerContactOffset(const std::vector<Contact>& contacts);
@@ -0,0 +1,134 @@
+#include "spatial_index.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchmarkCount(size_t count)
+{
+    // Keep density constant: roughly one entity per 8^3 units
+    const float halfExtent = 4.0f * std::cbrt((float)count);
+    const float radius = 1.0f;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+    std::uniform_real_distribution<float> step(-0.6f, 0.6f);
+
+    std::vector<glm::vec3> centers(count);
+    std::vector<Aabb> boxes(count);
+    std::vector<uint32_t> ids(count);
+    std::vector<int32_t> proxies(count);
+    for (size_t i = 0; i < count; i++) {
+        centers[i] = glm::vec3(position(rng), position(rng), position(rng));
+        boxes[i] = aabbFromSphere(centers[i], radius);
+        ids[i] = (uint32_t)i;
+    }
+
+    DynamicAabbTree tree;
+    auto start = std::chrono::steady_clock::now();
+    tree.createProxies(boxes.data(), ids.data(), count, proxies.data());
+    double buildMs = elapsedMs(start);
+
+    // Broadphase right after the build: every proxy is new, so this finds all pairs
+    size_t treePairs = 0;
+    start = std::chrono::steady_clock::now();
+    tree.queryPairs([&treePairs](int32_t, int32_t) { treePairs++; });
+    double treePairsMs = elapsedMs(start);
+
+    // One frame of small random movement
+    std::vector<glm::vec3> displacements(count);
+    for (size_t i = 0; i < count; i++) {
+        displacements[i] = glm::vec3(step(rng), step(rng), step(rng));
+        centers[i] += displacements[i];
+        boxes[i] = aabbFromSphere(centers[i], radius);
+    }
+    start = std::chrono::steady_clock::now();
+    size_t reinserted = tree.moveProxies(proxies.data(), boxes.data(), displacements.data(), count);
+    double updateMs = elapsedMs(start);
+
+    // Steady-state broadphase only looks at proxies that were reinserted
+    size_t movedPairs = 0;
+    start = std::chrono::steady_clock::now();
+    tree.queryPairs([&movedPairs](int32_t, int32_t) { movedPairs++; });
+    double movedPairsMs = elapsedMs(start);
+
+    // Frustum looking into the middle of the field
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, halfExtent);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Frustum frustum = extractFrustum(projection * view);
+
+    size_t treeVisible = 0;
+    start = std::chrono::steady_clock::now();
+    tree.queryFrustum(frustum, [&treeVisible](int32_t) { treeVisible++; return true; });
+    double treeFrustumMs = elapsedMs(start);
+
+    size_t bruteVisible = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        if (aabbInFrustum(frustum, boxes[i].min, boxes[i].max))
+            bruteVisible++;
+    }
+    double bruteFrustumMs = elapsedMs(start);
+
+    // Proximity: 1000 sphere queries of radius 10
+    const int proximityQueries = 1000;
+    const float queryRadius = 10.0f;
+    size_t treeNear = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < proximityQueries; q++) {
+        tree.querySphere(centers[q % count], queryRadius, [&treeNear](int32_t) { treeNear++; return true; });
+    }
+    double treeProximityMs = elapsedMs(start);
+
+    size_t bruteNear = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < proximityQueries; q++) {
+        const glm::vec3& c = centers[q % count];
+        for (size_t i = 0; i < count; i++) {
+            if (distanceSquared(boxes[i], c) <= queryRadius * queryRadius)
+                bruteNear++;
+        }
+    }
+    double bruteProximityMs = elapsedMs(start);
+
+    // All-pairs is O(n^2); skip it where it would take minutes
+    size_t brutePairs = 0;
+    double brutePairsMs = -1.0;
+    if (count <= 10000) {
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = i + 1; j < count; j++) {
+                if (overlaps(boxes[i], boxes[j]))
+                    brutePairs++;
+            }
+        }
+        brutePairsMs = elapsedMs(start);
+    }
+
+    std::printf("%7zu entities  tree height %d, build %.2f ms, update %.2f ms (%zu reinserted, %zu new pairs in %.3f ms)%s\n",
+                count, tree.height(), buildMs, updateMs, reinserted, movedPairs, movedPairsMs, tree.validate() ? "" : " INVALID");
+    std::printf("          frustum    tree %8.3f ms  brute %8.3f ms  (%zu / %zu visible)\n",
+                treeFrustumMs, bruteFrustumMs, treeVisible, bruteVisible);
+    std::printf("          proximity  tree %8.3f ms  brute %8.3f ms  (%zu / %zu hits)\n",
+                treeProximityMs, bruteProximityMs, treeNear, bruteNear);
+    if (brutePairsMs >= 0.0)
+        std::printf("          pairs      tree %8.3f ms  brute %8.3f ms  (%zu fat / %zu tight)\n",
+                    treePairsMs, brutePairsMs, treePairs, brutePairs);
+    else
+        std::printf("          pairs      tree %8.3f ms  brute      skipped  (%zu fat)\n", treePairsMs, treePairs);
+}
+
+void runSpatialBenchmark()
+{
+    std::printf("Spatial index benchmark: dynamic AABB tree vs brute force\n");
+    const size_t counts[] = { 1000, 10000, 100000 };
+    for (size_t count : counts)
+        benchmarkCount(count);
+}
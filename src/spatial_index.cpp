@@ -0,0 +1,407 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <iostream>
+
+int32_t DynamicAabbTree::allocateNode()
+{
+    if (freeList == nullNode) {
+        nodes.push_back(Node());
+        freeList = (int32_t)nodes.size() - 1;
+        nodes[freeList].parent = nullNode;
+    }
+
+    int32_t node = freeList;
+    freeList = nodes[node].parent;
+
+    Node& n = nodes[node];
+    n.parent = nullNode;
+    n.child1 = nullNode;
+    n.child2 = nullNode;
+    n.height = 0;
+    n.userData = 0;
+    n.moved = false;
+    return node;
+}
+
+void DynamicAabbTree::freeNode(int32_t node)
+{
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+Aabb DynamicAabbTree::fatten(const Aabb& box, const glm::vec3& displacement) const
+{
+    Aabb fat = { box.min - glm::vec3(fatMargin), box.max + glm::vec3(fatMargin) };
+
+    // Stretch in the direction of travel so steady movement rarely needs a reinsert
+    glm::vec3 d = displacement * displacementMultiplier;
+    fat.min += glm::min(d, glm::vec3(0.0f));
+    fat.max += glm::max(d, glm::vec3(0.0f));
+    return fat;
+}
+
+int32_t DynamicAabbTree::createProxy(const Aabb& box, uint32_t userData)
+{
+    int32_t proxy = allocateNode();
+    nodes[proxy].box = fatten(box, glm::vec3(0.0f));
+    nodes[proxy].userData = userData;
+    insertLeaf(proxy);
+    proxies++;
+
+    nodes[proxy].moved = true;
+    moveBuffer.push_back(proxy);
+    return proxy;
+}
+
+void DynamicAabbTree::destroyProxy(int32_t proxy)
+{
+    if (nodes[proxy].moved) {
+        std::replace(moveBuffer.begin(), moveBuffer.end(), proxy, nullNode);
+    }
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    proxies--;
+}
+
+bool DynamicAabbTree::moveProxy(int32_t proxy, const Aabb& box, const glm::vec3& displacement)
+{
+    const Aabb& fat = nodes[proxy].box;
+    if (contains(fat, box)) {
+        // Still inside; only refit if the fat box has become much larger than needed
+        Aabb huge = { box.min - glm::vec3(4.0f * fatMargin), box.max + glm::vec3(4.0f * fatMargin) };
+        glm::vec3 d = displacement * (4.0f * displacementMultiplier);
+        huge.min += glm::min(d, glm::vec3(0.0f));
+        huge.max += glm::max(d, glm::vec3(0.0f));
+        if (contains(huge, fat))
+            return false;
+    }
+
+    removeLeaf(proxy);
+    nodes[proxy].box = fatten(box, displacement);
+    insertLeaf(proxy);
+
+    if (!nodes[proxy].moved) {
+        nodes[proxy].moved = true;
+        moveBuffer.push_back(proxy);
+    }
+    return true;
+}
+
+void DynamicAabbTree::createProxies(const Aabb* boxes, const uint32_t* userData, size_t count, int32_t* outProxies)
+{
+    if (root != nullNode || count < 2) {
+        for (size_t i = 0; i < count; i++)
+            outProxies[i] = createProxy(boxes[i], userData[i]);
+        return;
+    }
+
+    nodes.reserve(nodes.size() + 2 * count);
+    buildScratch.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        int32_t proxy = allocateNode();
+        nodes[proxy].box = fatten(boxes[i], glm::vec3(0.0f));
+        nodes[proxy].userData = userData[i];
+        nodes[proxy].moved = true;
+        moveBuffer.push_back(proxy);
+        outProxies[i] = proxy;
+        buildScratch[i] = proxy;
+    }
+    proxies += count;
+
+    root = buildTopDown(buildScratch.data(), count);
+    nodes[root].parent = nullNode;
+}
+
+// Median split on the longest axis of the leaf centers
+int32_t DynamicAabbTree::buildTopDown(int32_t* leaves, size_t count)
+{
+    if (count == 1)
+        return leaves[0];
+
+    Aabb centers = { glm::vec3(1e30f), glm::vec3(-1e30f) };
+    for (size_t i = 0; i < count; i++) {
+        const Aabb& box = nodes[leaves[i]].box;
+        glm::vec3 center = (box.min + box.max) * 0.5f;
+        centers.min = glm::min(centers.min, center);
+        centers.max = glm::max(centers.max, center);
+    }
+
+    glm::vec3 extent = centers.max - centers.min;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    size_t half = count / 2;
+    std::nth_element(leaves, leaves + half, leaves + count, [this, axis](int32_t a, int32_t b) {
+        return nodes[a].box.min[axis] + nodes[a].box.max[axis] < nodes[b].box.min[axis] + nodes[b].box.max[axis];
+    });
+
+    int32_t child1 = buildTopDown(leaves, half);
+    int32_t child2 = buildTopDown(leaves + half, count - half);
+
+    int32_t parent = allocateNode();
+    Node& p = nodes[parent];
+    p.child1 = child1;
+    p.child2 = child2;
+    p.box = merge(nodes[child1].box, nodes[child2].box);
+    p.height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+    nodes[child1].parent = parent;
+    nodes[child2].parent = parent;
+    return parent;
+}
+
+size_t DynamicAabbTree::moveProxies(const int32_t* proxyIds, const Aabb* boxes, const glm::vec3* displacements, size_t count)
+{
+    size_t reinserted = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (moveProxy(proxyIds[i], boxes[i], displacements ? displacements[i] : glm::vec3(0.0f)))
+            reinserted++;
+    }
+    return reinserted;
+}
+
+void DynamicAabbTree::clear()
+{
+    nodes.clear();
+    moveBuffer.clear();
+    root = nullNode;
+    freeList = nullNode;
+    proxies = 0;
+}
+
+void DynamicAabbTree::insertLeaf(int32_t leaf)
+{
+    if (root == nullNode) {
+        root = leaf;
+        nodes[root].parent = nullNode;
+        return;
+    }
+
+    // Descend towards the sibling with the lowest surface area cost
+    const Aabb leafBox = nodes[leaf].box;
+    int32_t index = root;
+    while (!nodes[index].isLeaf()) {
+        int32_t child1 = nodes[index].child1;
+        int32_t child2 = nodes[index].child2;
+
+        float area = surfaceArea(nodes[index].box);
+        float combinedArea = surfaceArea(merge(nodes[index].box, leafBox));
+
+        // Cost of making a new parent for this node and the new leaf
+        float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float cost1 = surfaceArea(merge(leafBox, nodes[child1].box)) + inheritanceCost;
+        if (!nodes[child1].isLeaf())
+            cost1 -= surfaceArea(nodes[child1].box);
+
+        float cost2 = surfaceArea(merge(leafBox, nodes[child2].box)) + inheritanceCost;
+        if (!nodes[child2].isLeaf())
+            cost2 -= surfaceArea(nodes[child2].box);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? child1 : child2;
+    }
+
+    int32_t sibling = index;
+
+    // New parent for the sibling and the leaf
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = merge(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != nullNode) {
+        if (nodes[oldParent].child1 == sibling)
+            nodes[oldParent].child1 = newParent;
+        else
+            nodes[oldParent].child2 = newParent;
+    } else {
+        root = newParent;
+    }
+
+    // Walk back up fixing heights and bounds
+    index = nodes[leaf].parent;
+    while (index != nullNode) {
+        index = balance(index);
+
+        int32_t child1 = nodes[index].child1;
+        int32_t child2 = nodes[index].child2;
+        nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        nodes[index].box = merge(nodes[child1].box, nodes[child2].box);
+
+        index = nodes[index].parent;
+    }
+}
+
+void DynamicAabbTree::removeLeaf(int32_t leaf)
+{
+    if (leaf == root) {
+        root = nullNode;
+        return;
+    }
+
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent != nullNode) {
+        // Replace the parent with the sibling
+        if (nodes[grandParent].child1 == parent)
+            nodes[grandParent].child1 = sibling;
+        else
+            nodes[grandParent].child2 = sibling;
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        int32_t index = grandParent;
+        while (index != nullNode) {
+            index = balance(index);
+
+            int32_t child1 = nodes[index].child1;
+            int32_t child2 = nodes[index].child2;
+            nodes[index].box = merge(nodes[child1].box, nodes[child2].box);
+            nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+
+            index = nodes[index].parent;
+        }
+    } else {
+        root = sibling;
+        nodes[sibling].parent = nullNode;
+        freeNode(parent);
+    }
+}
+
+// Rotates a child up if the subtree at iA is imbalanced; returns the new subtree root
+int32_t DynamicAabbTree::balance(int32_t iA)
+{
+    if (nodes[iA].isLeaf() || nodes[iA].height < 2)
+        return iA;
+
+    int32_t iB = nodes[iA].child1;
+    int32_t iC = nodes[iA].child2;
+    int32_t diff = nodes[iC].height - nodes[iB].height;
+
+    // Rotate C up
+    if (diff > 1) {
+        int32_t iF = nodes[iC].child1;
+        int32_t iG = nodes[iC].child2;
+
+        nodes[iC].child1 = iA;
+        nodes[iC].parent = nodes[iA].parent;
+        nodes[iA].parent = iC;
+
+        if (nodes[iC].parent != nullNode) {
+            if (nodes[nodes[iC].parent].child1 == iA)
+                nodes[nodes[iC].parent].child1 = iC;
+            else
+                nodes[nodes[iC].parent].child2 = iC;
+        } else {
+            root = iC;
+        }
+
+        if (nodes[iF].height > nodes[iG].height) {
+            nodes[iC].child2 = iF;
+            nodes[iA].child2 = iG;
+            nodes[iG].parent = iA;
+            nodes[iA].box = merge(nodes[iB].box, nodes[iG].box);
+            nodes[iC].box = merge(nodes[iA].box, nodes[iF].box);
+            nodes[iA].height = 1 + std::max(nodes[iB].height, nodes[iG].height);
+            nodes[iC].height = 1 + std::max(nodes[iA].height, nodes[iF].height);
+        } else {
+            nodes[iC].child2 = iG;
+            nodes[iA].child2 = iF;
+            nodes[iF].parent = iA;
+            nodes[iA].box = merge(nodes[iB].box, nodes[iF].box);
+            nodes[iC].box = merge(nodes[iA].box, nodes[iG].box);
+            nodes[iA].height = 1 + std::max(nodes[iB].height, nodes[iF].height);
+            nodes[iC].height = 1 + std::max(nodes[iA].height, nodes[iG].height);
+        }
+        return iC;
+    }
+
+    // Rotate B up
+    if (diff < -1) {
+        int32_t iD = nodes[iB].child1;
+        int32_t iE = nodes[iB].child2;
+
+        nodes[iB].child1 = iA;
+        nodes[iB].parent = nodes[iA].parent;
+        nodes[iA].parent = iB;
+
+        if (nodes[iB].parent != nullNode) {
+            if (nodes[nodes[iB].parent].child1 == iA)
+                nodes[nodes[iB].parent].child1 = iB;
+            else
+                nodes[nodes[iB].parent].child2 = iB;
+        } else {
+            root = iB;
+        }
+
+        if (nodes[iD].height > nodes[iE].height) {
+            nodes[iB].child2 = iD;
+            nodes[iA].child1 = iE;
+            nodes[iE].parent = iA;
+            nodes[iA].box = merge(nodes[iC].box, nodes[iE].box);
+            nodes[iB].box = merge(nodes[iA].box, nodes[iD].box);
+            nodes[iA].height = 1 + std::max(nodes[iC].height, nodes[iE].height);
+            nodes[iB].height = 1 + std::max(nodes[iA].height, nodes[iD].height);
+        } else {
+            nodes[iB].child2 = iE;
+            nodes[iA].child1 = iD;
+            nodes[iD].parent = iA;
+            nodes[iA].box = merge(nodes[iC].box, nodes[iD].box);
+            nodes[iB].box = merge(nodes[iA].box, nodes[iE].box);
+            nodes[iA].height = 1 + std::max(nodes[iC].height, nodes[iD].height);
+            nodes[iB].height = 1 + std::max(nodes[iA].height, nodes[iE].height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+int DynamicAabbTree::validateNode(int32_t node, bool& ok) const
+{
+    const Node& n = nodes[node];
+    if (n.isLeaf()) {
+        if (n.height != 0)
+            ok = false;
+        return 0;
+    }
+
+    if (nodes[n.child1].parent != node || nodes[n.child2].parent != node)
+        ok = false;
+    if (!contains(n.box, nodes[n.child1].box) || !contains(n.box, nodes[n.child2].box))
+        ok = false;
+
+    int h1 = validateNode(n.child1, ok);
+    int h2 = validateNode(n.child2, ok);
+    if (n.height != 1 + std::max(h1, h2))
+        ok = false;
+    return n.height;
+}
+
+bool DynamicAabbTree::validate() const
+{
+    if (root == nullNode)
+        return proxies == 0;
+
+    bool ok = nodes[root].parent == nullNode;
+    validateNode(root, ok);
+    if (!ok)
+        std::cerr << "DynamicAabbTree: validation failed" << std::endl;
+    return ok;
+}
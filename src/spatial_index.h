@@ -0,0 +1,192 @@
+#pragma once
+
+#include "aabb.h"
+#include "frustum.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dynamic AABB tree (incrementally balanced BVH) over moving entities.
+//
+// Leaves store a fat AABB: the tight box grown by fatMargin and stretched along the last
+// displacement, so most moves leave the tree untouched. Insertion picks the sibling with the
+// lowest surface area cost and AVL-style rotations keep the height logarithmic. Proxies are
+// node indices and stay valid until destroyed; userData is the entity index.
+//
+// Not thread-safe for modification; queries are const and may run concurrently.
+class DynamicAabbTree
+{
+public:
+    static const int32_t nullNode = -1;
+
+    float fatMargin = 0.5f;
+    float displacementMultiplier = 2.0f;
+
+    int32_t createProxy(const Aabb& box, uint32_t userData);
+    void destroyProxy(int32_t proxy);
+
+    // Returns true if the proxy had to be reinserted (tight box left its fat box)
+    bool moveProxy(int32_t proxy, const Aabb& box, const glm::vec3& displacement);
+
+    // Batch versions. Inserting into an empty tree builds it top-down in one go, which gives a
+    // better tree than incremental insertion and is much faster for large counts.
+    void createProxies(const Aabb* boxes, const uint32_t* userData, size_t count, int32_t* outProxies);
+    size_t moveProxies(const int32_t* proxies, const Aabb* boxes, const glm::vec3* displacements, size_t count);
+
+    void clear();
+
+    const Aabb& fatAabb(int32_t proxy) const { return nodes[proxy].box; }
+    uint32_t userData(int32_t proxy) const { return nodes[proxy].userData; }
+    size_t proxyCount() const { return proxies; }
+    int height() const { return root == nullNode ? 0 : nodes[root].height; }
+
+    // Queries call callback(proxy) for every leaf whose fat AABB passes; returning false stops
+    template <typename Callback> void query(const Aabb& box, Callback&& callback) const;
+    template <typename Callback> void queryFrustum(const Frustum& frustum, Callback&& callback) const;
+    template <typename Callback> void querySphere(const glm::vec3& center, float radius, Callback&& callback) const;
+
+    // Segment from -> to swept by a sphere of the given radius (0 for a plain ray)
+    template <typename Callback> void querySegment(const glm::vec3& from, const glm::vec3& to, float radius, Callback&& callback) const;
+
+    // Broadphase: calls callback(proxyA, proxyB) once for every overlapping pair where at least
+    // one proxy was created or reinserted since the last call
+    template <typename Callback> void queryPairs(Callback&& callback);
+
+    // Checks parent links, heights and bounds; prints and returns false on corruption
+    bool validate() const;
+
+private:
+    struct Node
+    {
+        Aabb box;
+        int32_t parent; // Next free node while on the free list
+        int32_t child1;
+        int32_t child2;
+        int32_t height; // Leaf = 0, free = -1
+        uint32_t userData;
+        bool moved;
+
+        bool isLeaf() const { return child1 == nullNode; }
+    };
+
+    // Fixed traversal stack; a balanced tree over 2^32 leaves is far shallower than this, and
+    // deeper trees continue on a heap stack
+    static const int maxStackDepth = 256;
+
+    int32_t allocateNode();
+    void freeNode(int32_t node);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    int32_t balance(int32_t node);
+    int32_t buildTopDown(int32_t* leaves, size_t count);
+    Aabb fatten(const Aabb& box, const glm::vec3& displacement) const;
+    int validateNode(int32_t node, bool& ok) const;
+
+    template <typename Test, typename Callback> void traverse(Test&& test, Callback&& callback) const;
+
+    std::vector<Node> nodes;
+    int32_t root = nullNode;
+    int32_t freeList = nullNode;
+    size_t proxies = 0;
+
+    std::vector<int32_t> moveBuffer;
+    std::vector<int32_t> buildScratch;
+};
+
+template <typename Test, typename Callback>
+void DynamicAabbTree::traverse(Test&& test, Callback&& callback) const
+{
+    if (root == nullNode)
+        return;
+
+    // Fixed stack for the usual balanced tree; a degenerate one spills onto the heap
+    int32_t fixedStack[maxStackDepth];
+    std::vector<int32_t> grownStack;
+    int32_t* stack = fixedStack;
+    int capacity = maxStackDepth;
+    int count = 0;
+    stack[count++] = root;
+
+    while (count > 0) {
+        const Node& node = nodes[stack[--count]];
+        if (!test(node.box))
+            continue;
+
+        if (node.isLeaf()) {
+            if (!callback((int32_t)(&node - nodes.data())))
+                return;
+        } else {
+            if (count + 2 > capacity) {
+                if (grownStack.empty())
+                    grownStack.assign(fixedStack, fixedStack + count);
+                capacity *= 2;
+                grownStack.resize(capacity);
+                stack = grownStack.data();
+            }
+            stack[count++] = node.child1;
+            stack[count++] = node.child2;
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicAabbTree::query(const Aabb& box, Callback&& callback) const
+{
+    traverse([&box](const Aabb& nodeBox) { return overlaps(nodeBox, box); }, callback);
+}
+
+template <typename Callback>
+void DynamicAabbTree::queryFrustum(const Frustum& frustum, Callback&& callback) const
+{
+    traverse([&frustum](const Aabb& nodeBox) { return aabbInFrustum(frustum, nodeBox.min, nodeBox.max); }, callback);
+}
+
+template <typename Callback>
+void DynamicAabbTree::querySphere(const glm::vec3& center, float radius, Callback&& callback) const
+{
+    const float radiusSquared = radius * radius;
+    traverse([&center, radiusSquared](const Aabb& nodeBox) { return distanceSquared(nodeBox, center) <= radiusSquared; }, callback);
+}
+
+template <typename Callback>
+void DynamicAabbTree::querySegment(const glm::vec3& from, const glm::vec3& to, float radius, Callback&& callback) const
+{
+    glm::vec3 direction = to - from;
+    glm::vec3 invDirection;
+    for (int k = 0; k < 3; k++)
+        invDirection[k] = std::abs(direction[k]) > 1e-12f ? 1.0f / direction[k] : 1e30f;
+
+    const glm::vec3 grow(radius);
+    traverse([&](const Aabb& nodeBox) {
+        return segmentOverlaps(Aabb{ nodeBox.min - grow, nodeBox.max + grow }, from, invDirection);
+    }, callback);
+}
+
+template <typename Callback>
+void DynamicAabbTree::queryPairs(Callback&& callback)
+{
+    for (int32_t proxy : moveBuffer) {
+        if (proxy == nullNode)
+            continue;
+
+        query(nodes[proxy].box, [&](int32_t other) {
+            // Report moved/moved pairs once, from the lower index
+            if (other == proxy || (nodes[other].moved && other < proxy))
+                return true;
+            callback(proxy, other);
+            return true;
+        });
+    }
+
+    for (int32_t proxy : moveBuffer) {
+        if (proxy != nullNode)
+            nodes[proxy].moved = false;
+    }
+    moveBuffer.clear();
+}
+
+// Times the tree against brute force at 1k/10k/100k entities and prints the results
+// (run with --bench-spatial)
+void runSpatialBenchmark();
@@ -0,0 +1,114 @@
+#include "starfield.h"
+#include "shader.h"
+#include "depth.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+static const char* starfieldVertexShaderSource = R"glsl(
+    #version 330 core
+    out vec2 Ndc;
+
+    uniform float farDepth; // NDC depth of the far plane: 1, or 0 with reversed-Z
+
+    void main() {
+        // Vertices (-1,-1), (3,-1), (-1,3): one triangle covering the screen
+        vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+        Ndc = position;
+        gl_Position = vec4(position, farDepth, 1.0);
+    }
+)glsl";
+
+static const char* starfieldFragmentShaderSource = R"glsl(
+    #version 330 core
+    out vec4 FragColor;
+
+    in vec2 Ndc;
+
+    uniform mat4 inverseViewProjection; // Rotation-only view, so only the direction matters
+    uniform float density;
+    uniform float brightness;
+
+    vec3 hash33(vec3 p) {
+        uvec3 q = uvec3(ivec3(p)) * uvec3(1597334673U, 3812015801U, 2798796415U);
+        q = (q.x ^ q.y ^ q.z) * uvec3(1597334673U, 3812015801U, 2798796415U);
+        return vec3(q) * (1.0 / 4294967295.0);
+    }
+
+    // One layer of stars: every cell of a grid of the given scale may hold one star
+    vec3 starLayer(vec3 direction, float scale, float probability, float size) {
+        vec3 p = direction * scale;
+        vec3 cell = floor(p);
+        vec3 h = hash33(cell);
+        if (h.x > probability)
+            return vec3(0.0);
+
+        vec3 star = cell + 0.25 + 0.5 * hash33(cell + 17.0);
+        float d = length(p - star);
+        float intensity = smoothstep(size, 0.0, d);
+        vec3 tint = mix(vec3(0.7, 0.8, 1.0), vec3(1.0, 0.85, 0.6), h.y);
+        return tint * intensity * (0.4 + 0.6 * h.z);
+    }
+
+    void main() {
+        vec4 world = inverseViewProjection * vec4(Ndc, 1.0, 1.0);
+        vec3 direction = normalize(world.xyz / world.w);
+
+        vec3 color = vec3(0.0);
+        color += starLayer(direction, 400.0, 0.25 * density, 0.12);
+        color += starLayer(direction, 150.0, 0.10 * density, 0.08);
+        color += starLayer(direction, 60.0, 0.04 * density, 0.05) * 1.5;
+
+        // Faint band so the background isn't flat black
+        float band = exp(-abs(direction.z) * 6.0);
+        color += vec3(0.02, 0.015, 0.03) * band;
+
+        FragColor = vec4(color * brightness, 1.0);
+    }
+)glsl";
+
+bool Starfield::init()
+{
+    program = createShaderProgram(starfieldVertexShaderSource, starfieldFragmentShaderSource, "Starfield");
+    if (!program)
+        return false;
+
+    inverseViewProjectionLoc = glGetUniformLocation(program, "inverseViewProjection");
+    densityLoc = glGetUniformLocation(program, "density");
+    brightnessLoc = glGetUniformLocation(program, "brightness");
+    farDepthLoc = glGetUniformLocation(program, "farDepth");
+    glGenVertexArrays(1, &VAO);
+    return true;
+}
+
+void Starfield::destroy()
+{
+    if (program)
+        glDeleteProgram(program);
+    glDeleteVertexArrays(1, &VAO);
+    program = VAO = 0;
+}
+
+void Starfield::draw(const glm::mat4& view, const glm::mat4& projection)
+{
+    if (!program)
+        return;
+
+    // Stars are infinitely far away: drop the camera translation
+    glm::mat4 rotationOnly = glm::mat4(glm::mat3(view));
+    glm::mat4 inverseViewProjection = glm::inverse(projection * rotationOnly);
+
+    glUseProgram(program);
+    glUniformMatrix4fv(inverseViewProjectionLoc, 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+    glUniform1f(densityLoc, density);
+    glUniform1f(brightnessLoc, brightness);
+    glUniform1f(farDepthLoc, depthFar(reversedZ));
+
+    // Only where nothing was drawn: depth is still the cleared far value there
+    glDepthFunc(depthLessEqual(reversedZ));
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(depthLess(reversedZ));
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Procedural star background: one full-screen triangle whose fragment shader hashes the view
+// direction into a 3D cell grid and lights the few cells that hold a star. No per-star geometry
+// or textures, so the cost is a fixed, small amount of ALU per pixel whatever the star density.
+//
+// Drawn after the opaque pass at the far plane, so only uncovered pixels run the shader.
+class Starfield
+{
+public:
+    float density = 1.0f;    // Scales the number of stars in every layer
+    float brightness = 1.0f;
+    bool reversedZ = false; // Far plane is depth 0; see depth.h
+
+    bool init();
+    void destroy();
+    void draw(const glm::mat4& view, const glm::mat4& projection);
+
+private:
+    unsigned int program = 0;
+    unsigned int VAO = 0; // Empty; core profile needs one bound to draw
+    int inverseViewProjectionLoc = -1;
+    int densityLoc = -1;
+    int brightnessLoc = -1;
+    int farDepthLoc = -1;
+};
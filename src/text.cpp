@@ -0,0 +1,202 @@
+#include "text.h"
+#include "frame_arena.h"
+#include "shader.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+
+namespace {
+
+const char* textVertexSource = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec4 vertex; // xy position, zw texcoord
+
+    uniform mat4 projection;
+
+    out vec2 TexCoord;
+
+    void main() {
+        TexCoord = vertex.zw;
+        gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    }
+)glsl";
+
+const char* textFragmentSource = R"glsl(
+    #version 330 core
+    in vec2 TexCoord;
+    out vec4 FragColor;
+
+    uniform sampler2D glyph; // Coverage in the red channel
+    uniform vec3 textColor;
+
+    void main() {
+        FragColor = vec4(textColor, texture(glyph, TexCoord).r);
+    }
+)glsl";
+
+}
+
+bool TextRenderer::init(const char* fontPath, unsigned int pixelHeight, GpuResources& gpuResources)
+{
+    resources = &gpuResources;
+    pixelSize = pixelHeight;
+
+    FT_Library ft;
+    if (FT_Init_FreeType(&ft)) {
+        std::cerr << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        return false;
+    }
+    FT_Face face;
+    if (FT_New_Face(ft, fontPath, 0, &face)) {
+        std::cerr << "ERROR::FREETYPE: Failed to load font " << fontPath << std::endl;
+        FT_Done_FreeType(ft);
+        return false;
+    }
+    FT_Set_Pixel_Sizes(face, 0, pixelHeight);
+
+    // Glyph rows are tightly packed single bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int c = 0; c < 128; c++) {
+        if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
+            std::cerr << "ERROR::FREETYPE: Failed to load Glyph " << c << std::endl;
+            continue;
+        }
+        const FT_Bitmap& bitmap = face->glyph->bitmap;
+        Glyph& glyph = glyphs[c];
+        glyph.texture = resources->createTexture(GpuMemory_Text, "Glyph");
+        glyph.textureName = resources->get(glyph.texture);
+        glyph.size = glm::ivec2(bitmap.width, bitmap.rows);
+        glyph.bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+        glyph.advance = (unsigned int)face->glyph->advance.x;
+
+        glBindTexture(GL_TEXTURE_2D, glyph.textureName);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, bitmap.width, bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, bitmap.buffer);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        resources->setMemory(glyph.texture, (size_t)bitmap.width * bitmap.rows);
+        loaded[c] = true;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    FT_Done_Face(face);
+    FT_Done_FreeType(ft);
+
+    program = createShaderProgram(textVertexSource, textFragmentSource, "Text");
+    if (!program) {
+        destroy();
+        return false;
+    }
+    programHandle = resources->adopt<GpuResource_Program>(program, GpuMemory_Other, "Text program");
+    projectionLoc = glGetUniformLocation(program, "projection");
+    colorLoc = glGetUniformLocation(program, "textColor");
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "glyph"), 0);
+    glUseProgram(0);
+
+    vertexArray = resources->createVertexArray("Text VAO");
+    vertexBuffer = resources->createBuffer(GpuMemory_Text, "Text VBO");
+    glBindVertexArray(resources->get(vertexArray));
+    resources->bufferData(vertexBuffer, GL_ARRAY_BUFFER, sizeof(glm::vec4) * 6 * maxGlyphs, NULL, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    checkGLError("Text setup error");
+    return true;
+}
+
+void TextRenderer::destroy()
+{
+    if (!resources)
+        return;
+    for (unsigned int c = 0; c < 128; c++) {
+        if (loaded[c])
+            resources->release(glyphs[c].texture);
+        loaded[c] = false;
+    }
+    resources->release(programHandle);
+    resources->release(vertexArray);
+    resources->release(vertexBuffer);
+    program = 0;
+}
+
+float TextRenderer::width(const char* text, float scale) const
+{
+    float advance = 0.0f;
+    for (const char* c = text; *c; c++) {
+        unsigned char code = (unsigned char)*c;
+        if (code < 128 && loaded[code])
+            advance += (glyphs[code].advance >> 6) * scale;
+    }
+    return advance;
+}
+
+void TextRenderer::draw(const char* text, float x, float y, float scale, const glm::vec3& color,
+                        int screenWidth, int screenHeight, LinearArena& arena)
+{
+    if (!program)
+        return;
+
+    size_t length = 0;
+    while (text[length] && length < maxGlyphs)
+        length++;
+
+    // Lay out every glyph quad in frame memory; glyphs without a bitmap (spaces) only advance
+    glm::vec4* quads = arena.allocateArray<glm::vec4>(6 * length);
+    const Glyph** drawn = arena.allocateArray<const Glyph*>(length);
+    size_t quadCount = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char code = (unsigned char)text[i];
+        if (code >= 128 || !loaded[code])
+            continue;
+        const Glyph& glyph = glyphs[code];
+
+        float xpos = x + glyph.bearing.x * scale;
+        float ypos = y - (glyph.size.y - glyph.bearing.y) * scale;
+        float w = glyph.size.x * scale;
+        float h = glyph.size.y * scale;
+        x += (glyph.advance >> 6) * scale;
+        if (glyph.size.x == 0 || glyph.size.y == 0)
+            continue;
+
+        glm::vec4* quad = quads + 6 * quadCount;
+        quad[0] = glm::vec4(xpos,     ypos + h, 0.0f, 0.0f);
+        quad[1] = glm::vec4(xpos,     ypos,     0.0f, 1.0f);
+        quad[2] = glm::vec4(xpos + w, ypos,     1.0f, 1.0f);
+        quad[3] = glm::vec4(xpos,     ypos + h, 0.0f, 0.0f);
+        quad[4] = glm::vec4(xpos + w, ypos,     1.0f, 1.0f);
+        quad[5] = glm::vec4(xpos + w, ypos + h, 1.0f, 0.0f);
+        drawn[quadCount++] = &glyph;
+    }
+    if (quadCount == 0)
+        return;
+
+    glm::mat4 projection = glm::ortho(0.0f, (float)screenWidth, 0.0f, (float)screenHeight);
+    glUseProgram(program);
+    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3fv(colorLoc, 1, glm::value_ptr(color));
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST); // Flat overlay; z = 0 would also fail GL_GREATER
+
+    glBindVertexArray(resources->get(vertexArray));
+    glBindBuffer(GL_ARRAY_BUFFER, resources->get(vertexBuffer));
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec4) * 6 * quadCount, quads);
+    glActiveTexture(GL_TEXTURE0);
+    for (size_t i = 0; i < quadCount; i++) {
+        glBindTexture(GL_TEXTURE_2D, drawn[i]->textureName);
+        glDrawArrays(GL_TRIANGLES, (GLint)(6 * i), 6);
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "gpu_resources.h"
+
+class LinearArena;
+
+// One texture per ASCII glyph, rasterised by FreeType
+struct Glyph
+{
+    TextureHandle texture;
+    unsigned int textureName;
+    glm::ivec2 size;
+    glm::ivec2 bearing;  // Offset from the pen position to the top left of the bitmap
+    unsigned int advance; // In 1/64 pixels
+};
+
+// Screen-space text. Quads for a whole string are laid out in frame memory and uploaded with
+// one buffer update; each glyph is then one draw with its own texture.
+class TextRenderer
+{
+public:
+    static const unsigned int maxGlyphs = 128; // Per draw() call; longer strings are cut
+
+    bool init(const char* fontPath, unsigned int pixelHeight, GpuResources& resources);
+    void destroy();
+
+    // Draws with the baseline starting at (x, y), in pixels from the bottom left of a
+    // screenWidth x screenHeight viewport. Blends over what is there, without depth testing.
+    void draw(const char* text, float x, float y, float scale, const glm::vec3& color,
+              int screenWidth, int screenHeight, LinearArena& arena);
+
+    float width(const char* text, float scale) const;
+    float lineHeight(float scale) const { return pixelSize * 1.2f * scale; }
+    bool ready() const { return program != 0; }
+
+private:
+    GpuResources* resources = nullptr;
+    Glyph glyphs[128] = {};
+    bool loaded[128] = {};
+    unsigned int pixelSize = 0;
+
+    unsigned int program = 0;
+    ProgramHandle programHandle;
+    VertexArrayHandle vertexArray;
+    BufferHandle vertexBuffer;
+    int projectionLoc = -1;
+    int colorLoc = -1;
+};
@@ -0,0 +1,138 @@
+#include "texture_arrays.h"
+#include "allocation_tracker.h"
+#include "shader.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
+
+uint32_t TextureArrays::add(TextureData texture)
+{
+    AllocationScope allocationScope(AllocationTag_Textures);
+    slots.push_back(TextureSlot{ 0, 0 });
+    pendingIndex.push_back((int32_t)pending.size());
+    pendingHandles.push_back((uint32_t)(slots.size() - 1));
+    pending.push_back(std::move(texture));
+    return (uint32_t)(slots.size() - 1);
+}
+
+uint32_t TextureArrays::addTinted(uint32_t source, const glm::vec3& tint)
+{
+    AllocationScope allocationScope(AllocationTag_Textures);
+    if (source >= pendingIndex.size() || pendingIndex[source] < 0) {
+        std::cerr << "Texture arrays: can only tint textures that are not built yet" << std::endl;
+        return source;
+    }
+    TextureData copy = pending[pendingIndex[source]];
+    tintTexture(copy, tint);
+    return add(std::move(copy));
+}
+
+void TextureArrays::build()
+{
+    AllocationScope allocationScope(AllocationTag_Textures);
+    if (pending.empty())
+        return;
+
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    // Group by shape so each group can share an array; stable to keep layers in add order
+    std::vector<size_t> order(pending.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    auto shapeLess = [this](size_t a, size_t b) {
+        const TextureData& x = pending[a];
+        const TextureData& y = pending[b];
+        if (x.format != y.format) return x.format < y.format;
+        if (x.width() != y.width()) return x.width() < y.width();
+        if (x.height() != y.height()) return x.height() < y.height();
+        return x.levels.size() < y.levels.size();
+    };
+    std::stable_sort(order.begin(), order.end(), shapeLess);
+
+    for (size_t first = 0; first < order.size(); ) {
+        size_t end = first + 1;
+        while (end < order.size() && end - first < (size_t)maxLayers &&
+               !shapeLess(order[first], order[end]) && !shapeLess(order[end], order[first]))
+            end++;
+
+        const TextureData& shape = pending[order[first]];
+        const GLenum internalFormat = textureInternalFormat(shape.format);
+        const bool compressed = shape.format != TextureFormat_RGBA8;
+        const GLsizei layers = (GLsizei)(end - first);
+
+        unsigned int array;
+        glGenTextures(1, &array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)shape.levels.size() - 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        for (size_t l = 0; l < shape.levels.size(); l++) {
+            const TextureLevel& level = shape.levels[l];
+            // Allocate every layer of the level, then fill them one by one
+            if (compressed)
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, internalFormat, level.width, level.height, layers, 0,
+                                       (GLsizei)(level.size * layers), NULL);
+            else
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, internalFormat, level.width, level.height, layers, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+            for (GLsizei layer = 0; layer < layers; layer++) {
+                const TextureData& texture = pending[order[first + layer]];
+                const uint8_t* data = &texture.bytes[texture.levels[l].offset];
+                if (compressed)
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, 0, 0, layer, level.width, level.height, 1,
+                                              internalFormat, (GLsizei)level.size, data);
+                else
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, 0, 0, layer, level.width, level.height, 1,
+                                    GL_RGBA, GL_UNSIGNED_BYTE, data);
+            }
+        }
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if (GLEW_EXT_texture_filter_anisotropic)
+            glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, 8.0f);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        arrays.push_back(array);
+        if (resources) {
+            size_t bytes = 0;
+            for (const TextureLevel& level : shape.levels)
+                bytes += level.size * layers;
+            arrayHandles.push_back(resources->adopt<GpuResource_Texture>(array, GpuMemory_Textures, "Texture array"));
+            resources->setMemory(arrayHandles.back(), bytes);
+        }
+
+        for (GLsizei layer = 0; layer < layers; layer++) {
+            uint32_t handle = pendingHandles[order[first + layer]];
+            slots[handle] = TextureSlot{ array, (uint16_t)layer };
+            pendingIndex[handle] = -1;
+        }
+        std::cout << "Texture array " << shape.width() << "x" << shape.height() << ": " << layers << " layers" << std::endl;
+        first = end;
+    }
+    checkGLError("Texture array upload error");
+
+    pending.clear();
+    pendingHandles.clear();
+}
+
+void TextureArrays::destroy()
+{
+    if (resources) {
+        for (TextureHandle& handle : arrayHandles)
+            resources->release(handle);
+    } else if (!arrays.empty()) {
+        glDeleteTextures((GLsizei)arrays.size(), arrays.data());
+    }
+    arrays.clear();
+    arrayHandles.clear();
+    slots.clear();
+    pendingIndex.clear();
+    pending.clear();
+    pendingHandles.clear();
+}
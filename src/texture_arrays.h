@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "gpu_resources.h"
+#include "textures.h"
+
+// Where a texture ended up: a GL_TEXTURE_2D_ARRAY and the layer inside it
+struct TextureSlot
+{
+    unsigned int texture;
+    uint16_t layer;
+};
+
+// Packs textures that share size, format and mip count into the layers of GL_TEXTURE_2D_ARRAY
+// textures. Objects using any of them bind the array once and pick their layer per instance,
+// so a whole fleet with different liveries stays one instanced draw.
+//
+// Textures are collected with add()/addTinted() and uploaded together by build(), which sizes
+// each array exactly; arrays are immutable afterwards, so textures added later go into new ones.
+class TextureArrays
+{
+public:
+    // Accounts built arrays under GpuMemory_Textures and releases them through the registry
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    // Takes the texture; returns a handle that is valid after the next build()
+    uint32_t add(TextureData texture);
+
+    // Adds a recoloured copy of a texture that has not been built yet
+    uint32_t addTinted(uint32_t source, const glm::vec3& tint);
+
+    // Uploads everything added since the last build and frees the CPU copies
+    void build();
+    void destroy();
+
+    // texture 0 until built
+    TextureSlot slot(uint32_t handle) const { return slots[handle]; }
+    size_t arrayCount() const { return arrays.size(); }
+
+private:
+    std::vector<TextureSlot> slots;
+    std::vector<int32_t> pendingIndex; // Per handle, index into pending or -1 once built
+    std::vector<TextureData> pending;
+    std::vector<uint32_t> pendingHandles;
+    std::vector<unsigned int> arrays;
+    std::vector<TextureHandle> arrayHandles; // Parallel to arrays when a registry is set
+    GpuResources* resources = nullptr;
+};
@@ -0,0 +1,589 @@
+#include "textures.h"
+#include "allocation_tracker.h"
+#include "texture_arrays.h"
+#include "image.h"
+#include "job_system.h"
+#include "shader.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+bool decodeTexture(const std::string& path, TextureData& texture, std::string& error)
+{
+    std::vector<uint8_t> file;
+    if (!readFile(path, file)) {
+        error = "can't open file";
+        return false;
+    }
+
+    int width, height;
+    if (!decodePng(file, texture.bytes, width, height, error))
+        return false;
+
+    texture.format = TextureFormat_RGBA8;
+    texture.levels.assign(1, TextureLevel{ width, height, 0, texture.bytes.size() });
+    return true;
+}
+
+void generateMipmaps(TextureData& texture)
+{
+    if (texture.format != TextureFormat_RGBA8 || texture.levels.empty())
+        return;
+
+    texture.levels.resize(1);
+    texture.bytes.resize(texture.levels[0].size);
+
+    // Size the whole chain first so the byte vector is only grown once
+    size_t total = texture.levels[0].size;
+    for (int w = texture.width(), h = texture.height(); w > 1 || h > 1; ) {
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+        total += (size_t)w * h * 4;
+    }
+    texture.bytes.resize(total);
+
+    while (texture.levels.back().width > 1 || texture.levels.back().height > 1) {
+        const TextureLevel src = texture.levels.back();
+        TextureLevel dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.offset = src.offset + src.size;
+        dst.size = (size_t)dst.width * dst.height * 4;
+
+        const uint8_t* in = &texture.bytes[src.offset];
+        uint8_t* out = &texture.bytes[dst.offset];
+        for (int y = 0; y < dst.height; y++) {
+            // A 1-texel-wide source collapses only along the other axis
+            int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+            for (int x = 0; x < dst.width; x++) {
+                int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+                for (int c = 0; c < 4; c++) {
+                    int sum = in[((size_t)y0 * src.width + x0) * 4 + c] + in[((size_t)y0 * src.width + x1) * 4 + c] +
+                              in[((size_t)y1 * src.width + x0) * 4 + c] + in[((size_t)y1 * src.width + x1) * 4 + c];
+                    out[((size_t)y * dst.width + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+                }
+            }
+        }
+        texture.levels.push_back(dst);
+    }
+}
+
+namespace {
+
+uint16_t packRgb565(const float color[3])
+{
+    int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpackRgb565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 colour block, always in four-colour mode: endpoints at the extremes of the block's
+// principal axis, each texel takes the nearest of the four palette entries
+void encodeColorBlock(const uint8_t texels[16][4], uint8_t* out)
+{
+    float mean[3] = {};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += texels[i][c] / 16.0f;
+
+    float covariance[6] = {}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++) {
+        float r = texels[i][0] - mean[0], g = texels[i][1] - mean[1], b = texels[i][2] - mean[2];
+        covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+        covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+    }
+
+    // Power iteration for the dominant eigenvector
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+        if (length < 1e-6f)
+            break; // Flat block
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    float minT = 1e30f, maxT = -1e30f;
+    for (int i = 0; i < 16; i++) {
+        float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++) {
+        high[c] = mean[c] + axis[c] * maxT / axisLength2;
+        low[c] = mean[c] + axis[c] * minT / axisLength2;
+    }
+
+    uint16_t color0 = packRgb565(high), color1 = packRgb565(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 4; p++) {
+                int dr = texels[i][0] - palette[p][0], dg = texels[i][1] - palette[p][1], db = texels[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    out[0] = (uint8_t)(color0 & 0xFF); out[1] = (uint8_t)(color0 >> 8);
+    out[2] = (uint8_t)(color1 & 0xFF); out[3] = (uint8_t)(color1 >> 8);
+    std::memcpy(out + 4, &indices, 4); // Little endian like the format
+}
+
+// BC3 alpha block: eight-level ramp between the block's max and min alpha
+void encodeAlphaBlock(const uint8_t texels[16][4], uint8_t* out)
+{
+    int alpha0 = 0, alpha1 = 255;
+    for (int i = 0; i < 16; i++) {
+        alpha0 = std::max(alpha0, (int)texels[i][3]);
+        alpha1 = std::min(alpha1, (int)texels[i][3]);
+    }
+
+    uint64_t indices = 0;
+    if (alpha0 != alpha1) {
+        int palette[8] = { alpha0, alpha1 };
+        for (int p = 2; p < 8; p++)
+            palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 256;
+            for (int p = 0; p < 8; p++) {
+                int error = std::abs(texels[i][3] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    out[0] = (uint8_t)alpha0;
+    out[1] = (uint8_t)alpha1;
+    for (int b = 0; b < 6; b++)
+        out[2 + b] = (uint8_t)(indices >> (8 * b));
+}
+
+size_t compressedLevelSize(TextureFormat format, int width, int height)
+{
+    size_t blocks = (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4);
+    return blocks * (format == TextureFormat_BC1 ? 8 : 16);
+}
+
+}
+
+void compressTexture(TextureData& texture, JobSystem* jobs)
+{
+    if (texture.format != TextureFormat_RGBA8 || texture.levels.empty())
+        return;
+
+    bool opaque = true;
+    for (size_t i = 3; i < texture.levels[0].size && opaque; i += 4)
+        opaque = texture.bytes[i] == 255;
+    const TextureFormat format = opaque ? TextureFormat_BC1 : TextureFormat_BC3;
+    const size_t blockBytes = opaque ? 8 : 16;
+
+    std::vector<TextureLevel> levels;
+    size_t total = 0;
+    for (const TextureLevel& level : texture.levels) {
+        TextureLevel compressed = { level.width, level.height, total, compressedLevelSize(format, level.width, level.height) };
+        levels.push_back(compressed);
+        total += compressed.size;
+    }
+    std::vector<uint8_t> bytes(total);
+
+    for (size_t l = 0; l < levels.size(); l++) {
+        const TextureLevel& src = texture.levels[l];
+        const TextureLevel& dst = levels[l];
+        const uint8_t* in = &texture.bytes[src.offset];
+        uint8_t* out = &bytes[dst.offset];
+        const int blocksWide = (src.width + 3) / 4;
+        const int blocksHigh = (src.height + 3) / 4;
+
+        auto encodeRows = [&](uint32_t begin, uint32_t end) {
+            uint8_t texels[16][4];
+            for (uint32_t by = begin; by < end; by++) {
+                for (int bx = 0; bx < blocksWide; bx++) {
+                    // Partial blocks at the edges repeat the last row/column
+                    for (int i = 0; i < 16; i++) {
+                        int x = std::min(bx * 4 + (i & 3), src.width - 1);
+                        int y = std::min((int)by * 4 + (i >> 2), src.height - 1);
+                        std::memcpy(texels[i], in + ((size_t)y * src.width + x) * 4, 4);
+                    }
+                    uint8_t* block = out + ((size_t)by * blocksWide + bx) * blockBytes;
+                    if (opaque) {
+                        encodeColorBlock(texels, block);
+                    } else {
+                        encodeAlphaBlock(texels, block);
+                        encodeColorBlock(texels, block + 8);
+                    }
+                }
+            }
+        };
+
+        if (jobs)
+            jobs->parallelFor((uint32_t)blocksHigh, 8, encodeRows);
+        else
+            encodeRows(0, (uint32_t)blocksHigh);
+    }
+
+    texture.format = format;
+    texture.levels.swap(levels);
+    texture.bytes.swap(bytes);
+}
+
+void tintTexture(TextureData& texture, const glm::vec3& tint)
+{
+    if (texture.format == TextureFormat_RGBA8) {
+        for (size_t i = 0; i < texture.bytes.size(); i += 4) {
+            for (int c = 0; c < 3; c++)
+                texture.bytes[i + c] = (uint8_t)std::min(255.0f, texture.bytes[i + c] * tint[c] + 0.5f);
+        }
+        return;
+    }
+
+    // Scaling both endpoints scales every interpolated colour of the block the same way
+    const size_t blockBytes = texture.format == TextureFormat_BC1 ? 8 : 16;
+    const size_t colorOffset = texture.format == TextureFormat_BC1 ? 0 : 8;
+    for (size_t block = 0; block + blockBytes <= texture.bytes.size(); block += blockBytes) {
+        uint8_t* color = &texture.bytes[block + colorOffset];
+        uint16_t endpoints[2] = { (uint16_t)(color[0] | (color[1] << 8)), (uint16_t)(color[2] | (color[3] << 8)) };
+        for (uint16_t& endpoint : endpoints) {
+            int rgb[3];
+            unpackRgb565(endpoint, rgb);
+            float tinted[3] = { rgb[0] * tint.x, rgb[1] * tint.y, rgb[2] * tint.z };
+            endpoint = packRgb565(tinted);
+        }
+
+        // Keep four-colour mode (color0 > color1): swapping the endpoints mirrors the indices
+        uint32_t indices;
+        std::memcpy(&indices, color + 4, 4);
+        if (endpoints[0] < endpoints[1]) {
+            std::swap(endpoints[0], endpoints[1]);
+            indices ^= 0x55555555u;
+        } else if (endpoints[0] == endpoints[1]) {
+            indices = 0;
+        }
+
+        color[0] = (uint8_t)(endpoints[0] & 0xFF); color[1] = (uint8_t)(endpoints[0] >> 8);
+        color[2] = (uint8_t)(endpoints[1] & 0xFF); color[3] = (uint8_t)(endpoints[1] >> 8);
+        std::memcpy(color + 4, &indices, 4);
+    }
+}
+
+namespace {
+
+const uint8_t ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// KTX header fields after the identifier
+struct KtxHeader
+{
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+}
+
+unsigned int textureInternalFormat(TextureFormat format)
+{
+    switch (format) {
+    case TextureFormat_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureFormat_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default: return GL_RGBA8;
+    }
+}
+
+std::string textureCachePath(const std::string& sourcePath)
+{
+    return std::filesystem::path(sourcePath).replace_extension(".ktx").string();
+}
+
+bool writeTextureCache(const std::string& path, const TextureData& texture)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    const bool compressed = texture.format != TextureFormat_RGBA8;
+    KtxHeader header = {};
+    header.endianness = 0x04030201;
+    header.glType = compressed ? 0 : GL_UNSIGNED_BYTE;
+    header.glTypeSize = 1;
+    header.glFormat = compressed ? 0 : GL_RGBA;
+    header.glInternalFormat = textureInternalFormat(texture.format);
+    header.glBaseInternalFormat = texture.format == TextureFormat_BC1 ? GL_RGB : GL_RGBA;
+    header.pixelWidth = (uint32_t)texture.width();
+    header.pixelHeight = (uint32_t)texture.height();
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = (uint32_t)texture.levels.size();
+
+    file.write((const char*)ktxIdentifier, sizeof(ktxIdentifier));
+    file.write((const char*)&header, sizeof(header));
+    for (const TextureLevel& level : texture.levels) {
+        // Every level size here is a multiple of 4, so no mip padding is needed
+        uint32_t imageSize = (uint32_t)level.size;
+        file.write((const char*)&imageSize, sizeof(imageSize));
+        file.write((const char*)&texture.bytes[level.offset], level.size);
+    }
+    return (bool)file;
+}
+
+bool readTextureCache(const std::string& path, TextureData& texture)
+{
+    std::vector<uint8_t> file;
+    if (!readFile(path, file) || file.size() < sizeof(ktxIdentifier) + sizeof(KtxHeader))
+        return false;
+    if (std::memcmp(file.data(), ktxIdentifier, sizeof(ktxIdentifier)) != 0)
+        return false;
+
+    KtxHeader header;
+    std::memcpy(&header, &file[sizeof(ktxIdentifier)], sizeof(header));
+    if (header.endianness != 0x04030201 || header.pixelDepth > 1 || header.numberOfArrayElements > 1 || header.numberOfFaces != 1)
+        return false;
+
+    if (header.glInternalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        texture.format = TextureFormat_BC1;
+    else if (header.glInternalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        texture.format = TextureFormat_BC3;
+    else if (header.glInternalFormat == GL_RGBA8 && header.glType == GL_UNSIGNED_BYTE)
+        texture.format = TextureFormat_RGBA8;
+    else
+        return false;
+
+    // Level data is moved down in place so the file buffer becomes the texture's storage
+    size_t pos = sizeof(ktxIdentifier) + sizeof(KtxHeader) + header.bytesOfKeyValueData;
+    size_t write = 0;
+    texture.levels.clear();
+    uint32_t levelCount = std::max(1u, header.numberOfMipmapLevels);
+    for (uint32_t l = 0; l < levelCount; l++) {
+        if (pos + 4 > file.size())
+            return false;
+        uint32_t imageSize;
+        std::memcpy(&imageSize, &file[pos], 4);
+        pos += 4;
+        if (pos + imageSize > file.size())
+            return false;
+
+        TextureLevel level;
+        level.width = std::max(1, (int)(header.pixelWidth >> l));
+        level.height = std::max(1, (int)(header.pixelHeight >> l));
+        level.offset = write;
+        level.size = imageSize;
+        size_t expected = texture.format == TextureFormat_RGBA8 ? (size_t)level.width * level.height * 4
+                                                                : compressedLevelSize(texture.format, level.width, level.height);
+        if (imageSize != expected)
+            return false;
+
+        std::memmove(&file[write], &file[pos], imageSize);
+        texture.levels.push_back(level);
+        write += imageSize;
+        pos += (imageSize + 3) & ~3u;
+    }
+    file.resize(write);
+    texture.bytes.swap(file);
+    return true;
+}
+
+unsigned int uploadTexture(const TextureData& texture)
+{
+    if (texture.levels.empty())
+        return 0;
+
+    unsigned int id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levels.size() - 1);
+
+    GLenum internalFormat = textureInternalFormat(texture.format);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t l = 0; l < texture.levels.size(); l++) {
+        const TextureLevel& level = texture.levels[l];
+        const uint8_t* data = &texture.bytes[level.offset];
+        if (texture.format == TextureFormat_RGBA8)
+            glTexImage2D(GL_TEXTURE_2D, (GLint)l, internalFormat, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        else
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)l, internalFormat, level.width, level.height, 0, (GLsizei)level.size, data);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (GLEW_EXT_texture_filter_anisotropic)
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 8.0f);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError("Texture upload error");
+    return id;
+}
+
+// Newer cache wins; a cache without its image is used as is
+static bool cacheIsFresh(const std::string& sourcePath, const std::string& cachePath)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error))
+        return false;
+    if (!std::filesystem::exists(sourcePath, error))
+        return true;
+    return std::filesystem::last_write_time(cachePath, error) >= std::filesystem::last_write_time(sourcePath, error);
+}
+
+uint32_t TextureLoader::request(const std::string& path)
+{
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].path == path)
+            return (uint32_t)i;
+    }
+    Entry entry;
+    entry.path = path;
+    entries.push_back(entry);
+    return (uint32_t)(entries.size() - 1);
+}
+
+void TextureLoader::loadPending(JobSystem& jobs)
+{
+    AllocationScope allocationScope(AllocationTag_Textures);
+    std::vector<uint32_t> pending;
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        if (!entries[i].loaded)
+            pending.push_back(i);
+    }
+    if (pending.empty())
+        return;
+
+    const bool compress = compressionEnabled && GLEW_EXT_texture_compression_s3tc;
+
+    // Read caches or decode + mipmap, one texture per job
+    std::vector<TextureData> data(pending.size());
+    std::vector<char> fromCache(pending.size(), 0);
+    std::vector<std::string> errors(pending.size());
+    jobs.parallelFor((uint32_t)pending.size(), 1, [&](uint32_t begin, uint32_t end) {
+        AllocationScope workerScope(AllocationTag_Textures);
+        for (uint32_t i = begin; i < end; i++) {
+            const std::string& path = entries[pending[i]].path;
+            std::string cachePath = textureCachePath(path);
+            if (cacheIsFresh(path, cachePath) && readTextureCache(cachePath, data[i]) &&
+                (compress || data[i].format == TextureFormat_RGBA8)) {
+                fromCache[i] = 1;
+                continue;
+            }
+            if (decodeTexture(path, data[i], errors[i]))
+                generateMipmaps(data[i]);
+            else
+                data[i] = TextureData();
+        }
+    });
+
+    for (size_t i = 0; i < pending.size(); i++) {
+        Entry& entry = entries[pending[i]];
+        entry.loaded = true;
+        if (data[i].levels.empty()) {
+            std::cerr << "Failed to load texture " << entry.path << ": " << errors[i] << std::endl;
+            continue;
+        }
+
+        // Blocks of one texture are compressed in parallel
+        if (compress && !fromCache[i]) {
+            compressTexture(data[i], &jobs);
+            if (writeCache && !writeTextureCache(textureCachePath(entry.path), data[i]))
+                std::cerr << "Failed to write texture cache for " << entry.path << std::endl;
+        }
+
+        std::cout << "Texture " << entry.path << ": " << data[i].width() << "x" << data[i].height() << ", "
+                  << data[i].levels.size() << " levels, " << (data[i].format == TextureFormat_RGBA8 ? "RGBA8" : data[i].format == TextureFormat_BC1 ? "BC1" : "BC3")
+                  << (fromCache[i] ? " (cached)" : "") << std::endl;
+
+        if (arrays)
+            entry.arrayHandle = arrays->add(std::move(data[i]));
+        else {
+            entry.texture = uploadTexture(data[i]);
+            if (resources && entry.texture) {
+                entry.handle = resources->adopt<GpuResource_Texture>(entry.texture, GpuMemory_Textures, "Texture");
+                resources->setMemory(entry.handle, data[i].bytes.size());
+            }
+        }
+    }
+}
+
+void TextureLoader::destroy()
+{
+    for (Entry& entry : entries) {
+        if (resources && entry.handle.valid())
+            resources->release(entry.handle);
+        else if (entry.texture)
+            glDeleteTextures(1, &entry.texture);
+    }
+    entries.clear();
+}
+
+int bakeTextures(const std::vector<std::string>& paths, JobSystem& jobs)
+{
+    int failures = 0;
+    for (const std::string& path : paths) {
+        TextureData texture;
+        std::string error;
+        if (!decodeTexture(path, texture, error)) {
+            std::cerr << "  " << path << ": " << error << std::endl;
+            failures++;
+            continue;
+        }
+        generateMipmaps(texture);
+        size_t rawBytes = texture.bytes.size();
+        compressTexture(texture, &jobs);
+
+        std::string cachePath = textureCachePath(path);
+        if (!writeTextureCache(cachePath, texture)) {
+            std::cerr << "  " << cachePath << ": can't write" << std::endl;
+            failures++;
+            continue;
+        }
+        std::cout << "  " << path << " -> " << cachePath << ": " << texture.width() << "x" << texture.height() << ", "
+                  << texture.levels.size() << " levels, " << (texture.format == TextureFormat_BC1 ? "BC1" : "BC3") << ", "
+                  << rawBytes / 1024 << " KiB -> " << texture.bytes.size() / 1024 << " KiB" << std::endl;
+    }
+    return failures;
+}
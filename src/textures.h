@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gpu_resources.h"
+
+class JobSystem;
+class TextureArrays;
+
+enum TextureFormat
+{
+    TextureFormat_RGBA8,
+    TextureFormat_BC1,   // S3TC DXT1: opaque RGB, 4 bits per texel
+    TextureFormat_BC3    // S3TC DXT5: RGBA with interpolated alpha, 8 bits per texel
+};
+
+// One mip level inside TextureData::bytes
+struct TextureLevel
+{
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// A texture with its whole mip chain in one allocation, each level laid out the way
+// glTexImage2D / glCompressedTexImage2D take it
+struct TextureData
+{
+    TextureFormat format = TextureFormat_RGBA8;
+    std::vector<TextureLevel> levels;
+    std::vector<uint8_t> bytes;
+
+    int width() const { return levels.empty() ? 0 : levels[0].width; }
+    int height() const { return levels.empty() ? 0 : levels[0].height; }
+};
+
+// GL internal format of a TextureFormat
+unsigned int textureInternalFormat(TextureFormat format);
+
+// Decodes an image file into a single RGBA8 level
+bool decodeTexture(const std::string& path, TextureData& texture, std::string& error);
+
+// Box-filters an RGBA8 texture down to 1x1, replacing any existing levels below the first
+void generateMipmaps(TextureData& texture);
+
+// Block-compresses every level of an RGBA8 texture: BC1 when it is opaque, BC3 otherwise.
+// Rows of blocks are spread over the workers when jobs is given.
+void compressTexture(TextureData& texture, JobSystem* jobs);
+
+// Multiplies the colour of every level by tint (0-1 per channel). Compressed levels are tinted
+// by their block endpoints, without decoding, so cached textures can be recoloured cheaply.
+void tintTexture(TextureData& texture, const glm::vec3& tint);
+
+// Texture cache in KTX 1.1 layout (header, then each level's size and data), so stock tools
+// can inspect it. foo.png caches to foo.ktx next to it.
+std::string textureCachePath(const std::string& sourcePath);
+bool writeTextureCache(const std::string& path, const TextureData& texture);
+bool readTextureCache(const std::string& path, TextureData& texture);
+
+// Creates a mipmapped, trilinear GL texture from the levels as they are; no conversion
+unsigned int uploadTexture(const TextureData& texture);
+
+// Loads the game's textures. Each request is served from its cache file when that is newer
+// than the image; otherwise the image is decoded and mipmapped on the workers, compressed
+// and the cache written for next time. The GL thread only uploads finished levels.
+class TextureLoader
+{
+public:
+    bool compressionEnabled = true; // Block-compressed when the GL has S3TC
+    bool writeCache = true;
+
+    // With arrays set, loaded textures are added to them (uploaded by TextureArrays::build)
+    // instead of becoming standalone GL textures
+    void setTextureArrays(TextureArrays* textureArrays) { arrays = textureArrays; }
+
+    // With a registry set, standalone textures are accounted there with their level sizes
+    void setResources(GpuResources* gpuResources) { resources = gpuResources; }
+
+    uint32_t request(const std::string& path);
+
+    // Loads and uploads everything requested since the last call
+    void loadPending(JobSystem& jobs);
+
+    // GL texture of a request, 0 if it failed to load
+    unsigned int texture(uint32_t id) const { return entries[id].texture; }
+
+    // TextureArrays handle of a request, UINT32_MAX if it failed to load
+    uint32_t arrayHandle(uint32_t id) const { return entries[id].arrayHandle; }
+
+    void destroy();
+
+private:
+    struct Entry
+    {
+        std::string path;
+        unsigned int texture = 0;
+        TextureHandle handle; // Valid when a registry is set
+        uint32_t arrayHandle = UINT32_MAX;
+        bool loaded = false;
+    };
+
+    std::vector<Entry> entries;
+    TextureArrays* arrays = nullptr;
+    GpuResources* resources = nullptr;
+};
+
+// Offline step for --bake-textures: compresses every image and writes its cache. Needs no GL.
+// Returns the number of images that failed.
+int bakeTextures(const std::vector<std::string>& paths, JobSystem& jobs);